@@ -0,0 +1,243 @@
+/**
+ * AdBlocker implementation
+ */
+
+#include "AdBlocker.hpp"
+#include "FilterMatcher.hpp"
+#include "Settings.hpp"
+#include <QApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <cstring>
+
+namespace {
+
+const QStringList DEFAULT_LISTS = {
+    "https://easylist.to/easylist/easylist.txt",
+    "https://easylist.to/easylist/easyprivacy.txt"
+};
+const qint64 UPDATE_INTERVAL_MS = 4LL * 24 * 60 * 60 * 1000;
+const char* const CACHE_FILE = "filters.bin";
+
+quint32 typeOf(QWebEngineUrlRequestInfo::ResourceType type)
+{
+    switch (type) {
+    case QWebEngineUrlRequestInfo::ResourceTypeScript:
+    case QWebEngineUrlRequestInfo::ResourceTypeWorker:
+    case QWebEngineUrlRequestInfo::ResourceTypeSharedWorker:
+    case QWebEngineUrlRequestInfo::ResourceTypeServiceWorker:
+        return FilterMatcher::Script;
+    case QWebEngineUrlRequestInfo::ResourceTypeImage:
+    case QWebEngineUrlRequestInfo::ResourceTypeFavicon:
+        return FilterMatcher::Image;
+    case QWebEngineUrlRequestInfo::ResourceTypeStylesheet:
+        return FilterMatcher::Stylesheet;
+    case QWebEngineUrlRequestInfo::ResourceTypeObject:
+    case QWebEngineUrlRequestInfo::ResourceTypePluginResource:
+        return FilterMatcher::Object;
+    case QWebEngineUrlRequestInfo::ResourceTypeXhr:
+        return FilterMatcher::XmlHttpRequest;
+    case QWebEngineUrlRequestInfo::ResourceTypeSubFrame:
+        return FilterMatcher::Subdocument;
+    case QWebEngineUrlRequestInfo::ResourceTypeMedia:
+        return FilterMatcher::Media;
+    case QWebEngineUrlRequestInfo::ResourceTypeFontResource:
+        return FilterMatcher::Font;
+    case QWebEngineUrlRequestInfo::ResourceTypePing:
+    case QWebEngineUrlRequestInfo::ResourceTypeCspReport:
+        return FilterMatcher::Ping;
+    default:
+        return FilterMatcher::Other;
+    }
+}
+
+} // namespace
+
+AdBlocker* AdBlocker::instance()
+{
+    static AdBlocker* blocker = nullptr;
+    if (!blocker) blocker = new AdBlocker(qApp);
+    return blocker;
+}
+
+AdBlocker::AdBlocker(QObject* parent)
+    : QObject(parent)
+    , m_enabled(Settings::instance()->value("adblock", true).toBool())
+    , m_lists(Settings::instance()->value("adblockLists", DEFAULT_LISTS).toStringList())
+    , m_dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/adblock")
+{
+    const QStringList allowlist = Settings::instance()->value("adblockAllowlist").toStringList();
+    m_allowlist = QSet<QString>(allowlist.cbegin(), allowlist.cend());
+
+    // A map, not a parse; a stale or damaged file is rebuilt in updateLists()
+    m_matcher = FilterMatcher::open(m_dir + "/" + CACHE_FILE, listsStamp());
+
+    connect(&m_compileWatcher, &QFutureWatcher<bool>::finished, this, [this]() {
+        if (!m_compileWatcher.result()) return;
+        std::unique_ptr<FilterMatcher> matcher = FilterMatcher::open(m_dir + "/" + CACHE_FILE, listsStamp());
+        if (!matcher) return;
+        m_matcher = std::move(matcher);
+        emit filtersChanged();
+    });
+}
+
+AdBlocker::~AdBlocker()
+{
+    m_compileWatcher.waitForFinished();
+}
+
+bool AdBlocker::shouldBlock(const QWebEngineUrlRequestInfo& info) const
+{
+    if (!m_enabled || !m_matcher) return false;
+    // Never the page itself, only what it pulls in
+    const QWebEngineUrlRequestInfo::ResourceType type = info.resourceType();
+    if (type == QWebEngineUrlRequestInfo::ResourceTypeMainFrame) return false;
+
+    const QUrl url = info.requestUrl();
+    const QString scheme = url.scheme();
+    if (scheme != QLatin1String("http") && scheme != QLatin1String("https")
+        && scheme != QLatin1String("ws") && scheme != QLatin1String("wss")) {
+        return false;
+    }
+    const QUrl firstParty = info.firstPartyUrl();
+    if (isAllowlisted(firstParty.host())) return false;
+
+    const quint32 filterType = scheme.startsWith(QLatin1String("ws")) ? quint32(FilterMatcher::WebSocket) : typeOf(type);
+    return m_matcher->shouldBlock(FilterMatcher::makeRequest(url, firstParty, filterType));
+}
+
+void AdBlocker::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    Settings::instance()->setValue("adblock", enabled);
+    if (enabled) updateLists();
+}
+
+int AdBlocker::ruleCount() const
+{
+    return m_matcher ? m_matcher->ruleCount() : 0;
+}
+
+bool AdBlocker::isAllowlisted(const QString& host) const
+{
+    if (m_allowlist.isEmpty() || host.isEmpty()) return false;
+    // The host or any parent domain
+    int start = 0;
+    for (;;) {
+        if (m_allowlist.contains(host.mid(start))) return true;
+        const int dot = host.indexOf('.', start);
+        if (dot < 0) return false;
+        start = dot + 1;
+    }
+}
+
+void AdBlocker::setAllowlisted(const QString& host, bool allowed)
+{
+    if (host.isEmpty()) return;
+    if (allowed) {
+        m_allowlist.insert(host);
+    } else {
+        // Unblocking by a parent domain entry would otherwise survive
+        for (auto it = m_allowlist.begin(); it != m_allowlist.end();) {
+            const bool covers = host == *it || host.endsWith('.' + *it);
+            if (covers) it = m_allowlist.erase(it);
+            else ++it;
+        }
+    }
+    const QStringList list(m_allowlist.cbegin(), m_allowlist.cend());
+    Settings::instance()->setValue("adblockAllowlist", list);
+    emit allowlistChanged();
+}
+
+void AdBlocker::updateLists(bool force)
+{
+    if (!m_enabled || m_pendingDownloads > 0) return;
+    if (!m_network) m_network = new QNetworkAccessManager(this);
+    QDir().mkpath(m_dir);
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    m_listsChanged = false;
+    for (const QString& url : qAsConst(m_lists)) {
+        const QFileInfo info(listPath(url));
+        if (!force && info.exists() && now - info.lastModified().toMSecsSinceEpoch() < UPDATE_INTERVAL_MS) continue;
+
+        ++m_pendingDownloads;
+        QNetworkRequest request{QUrl(url)};
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+        QNetworkReply* reply = m_network->get(request);
+        connect(reply, &QNetworkReply::finished, this, [this, reply, url]() {
+            reply->deleteLater();
+            const QByteArray body = reply->readAll();
+            // Anything but a filter list (a captive portal page, say) is ignored
+            const bool isList = body.left(256).contains("[Adblock") || body.startsWith('!');
+            if (reply->error() == QNetworkReply::NoError && isList) {
+                QSaveFile file(listPath(url));
+                if (file.open(QIODevice::WriteOnly) && file.write(body) == body.size() && file.commit()) {
+                    m_listsChanged = true;
+                }
+            } else {
+                qWarning("AdBlocker: could not fetch %s", qPrintable(url));
+            }
+            if (--m_pendingDownloads == 0 && (m_listsChanged || !m_matcher)) compile();
+        });
+    }
+
+    // Lists that were already current may still need compiling (first run
+    // after an interrupted update, or a damaged cache)
+    if (m_pendingDownloads == 0 && !m_matcher) compile();
+}
+
+QString AdBlocker::listPath(const QString& url) const
+{
+    const QByteArray key = QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+    return m_dir + "/" + QString::fromLatin1(key) + ".txt";
+}
+
+quint64 AdBlocker::listsStamp() const
+{
+    // Cheap to compute at startup: names, sizes and times, no contents
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const QString& url : m_lists) {
+        const QFileInfo info(listPath(url));
+        hash.addData(url.toUtf8());
+        hash.addData(QByteArray::number(info.size()));
+        hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    }
+    quint64 stamp = 0;
+    std::memcpy(&stamp, hash.result().constData(), sizeof(stamp));
+    return stamp;
+}
+
+void AdBlocker::compile()
+{
+    if (m_compileWatcher.isRunning()) return;
+    QStringList paths;
+    for (const QString& url : qAsConst(m_lists)) {
+        if (QFileInfo::exists(listPath(url))) paths.append(listPath(url));
+    }
+    if (paths.isEmpty()) return;
+    const quint64 stamp = listsStamp();
+    const QString cachePath = m_dir + "/" + CACHE_FILE;
+
+    m_compileWatcher.setFuture(QtConcurrent::run([paths, stamp, cachePath]() {
+        QList<QByteArray> lists;
+        for (const QString& path : paths) {
+            QFile file(path);
+            if (file.open(QIODevice::ReadOnly)) lists.append(file.readAll());
+        }
+        const QByteArray blob = FilterMatcher::compile(lists, stamp);
+        // Written beside and renamed over the old file; a mapping of the old
+        // one stays valid until it is replaced in memory too
+        QSaveFile file(cachePath);
+        return file.open(QIODevice::WriteOnly) && file.write(blob) == blob.size() && file.commit();
+    }));
+}
@@ -0,0 +1,389 @@
+/**
+ * BookmarkStore implementation
+ */
+
+#include "BookmarkStore.hpp"
+#include "Settings.hpp"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QSettings>
+#include <QStandardPaths>
+#include <functional>
+
+namespace {
+
+const int SAVE_DELAY_MS = 1000;
+const int FORMAT_VERSION = 1;
+
+QJsonObject toJson(const QHash<int, BookmarkNode>& nodes, int id)
+{
+    const BookmarkNode n = nodes.value(id);
+    QJsonObject obj;
+    obj["title"] = n.title;
+    if (!n.folder) {
+        obj["url"] = n.url;
+        return obj;
+    }
+    QJsonArray children;
+    for (int child : n.children) children.append(toJson(nodes, child));
+    obj["children"] = children;
+    return obj;
+}
+
+void writeBookmarks(const QString& path, const QHash<int, BookmarkNode>& nodes)
+{
+    QJsonObject doc;
+    doc["version"] = FORMAT_VERSION;
+    doc["root"] = toJson(nodes, BookmarkStore::ROOT_ID);
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning("BookmarkStore: cannot write %s", qPrintable(path));
+        return;
+    }
+    file.write(QJsonDocument(doc).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qWarning("BookmarkStore: failed to save %s", qPrintable(path));
+    }
+}
+
+} // namespace
+
+BookmarkStore::BookmarkStore(QObject* parent)
+    : QObject(parent)
+    , m_path(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/bookmarks.json")
+    , m_worker(new QObject)
+{
+    m_thread.setObjectName("BookmarkStore");
+    m_worker->moveToThread(&m_thread);
+    m_thread.start(QThread::LowPriority);
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, [this]() {
+        // The hash is implicitly shared; serialization happens off the UI thread
+        const QHash<int, BookmarkNode> nodes = m_nodes;
+        const QString path = m_path;
+        QMetaObject::invokeMethod(m_worker, [path, nodes]() { writeBookmarks(path, nodes); });
+    });
+
+    BookmarkNode root;
+    root.id = ROOT_ID;
+    root.folder = true;
+    m_nodes.insert(ROOT_ID, root);
+}
+
+BookmarkStore::~BookmarkStore()
+{
+    flush();
+    m_thread.quit();
+    m_thread.wait();
+    delete m_worker;
+}
+
+void BookmarkStore::load()
+{
+    if (m_loaded) return;
+    m_loaded = true;
+    readFile();
+    emit reset();
+}
+
+void BookmarkStore::readFile()
+{
+    QFile file(m_path);
+    if (!file.exists()) {
+        migrateFromSettings();
+        return;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("BookmarkStore: cannot read %s", qPrintable(m_path));
+        return;
+    }
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError) {
+        qWarning("BookmarkStore: %s: %s", qPrintable(m_path), qPrintable(error.errorString()));
+        return;
+    }
+
+    // Ids aren't persisted; they're assigned fresh on every load
+    std::function<void(const QJsonArray&, int)> addChildren = [&](const QJsonArray& array, int parentId) {
+        for (const QJsonValue& value : array) {
+            const QJsonObject obj = value.toObject();
+            BookmarkNode n;
+            n.parent = parentId;
+            n.title = obj.value("title").toString();
+            if (obj.contains("children")) {
+                n.folder = true;
+                const int id = insertNode(n, -1);
+                addChildren(obj.value("children").toArray(), id);
+            } else {
+                n.url = obj.value("url").toString();
+                if (!n.url.isEmpty()) insertNode(n, -1);
+            }
+        }
+    };
+    addChildren(doc.object().value("root").toObject().value("children").toArray(), ROOT_ID);
+}
+
+void BookmarkStore::migrateFromSettings()
+{
+    // One-time import of the old flat QSettings "bookmarks" array
+    QSettings settings(Settings::ORGANIZATION, Settings::APPLICATION);
+    const int size = settings.beginReadArray("bookmarks");
+    for (int i = 0; i < size; ++i) {
+        settings.setArrayIndex(i);
+        BookmarkNode n;
+        n.title = settings.value("title").toString();
+        n.url = settings.value("url").toString();
+        if (!n.url.isEmpty()) insertNode(n, -1);
+    }
+    settings.endArray();
+    if (size > 0) {
+        // Written before the old copy goes, so a crash can't lose both
+        writeBookmarks(m_path, m_nodes);
+        settings.remove("bookmarks");
+    }
+}
+
+int BookmarkStore::addBookmark(int parentId, const QString& title, const QString& url, int index)
+{
+    if (url.isEmpty()) return -1;
+    load();
+    BookmarkNode n;
+    n.parent = parentId;
+    n.title = title;
+    n.url = url;
+    const bool first = !m_byUrl.contains(url);
+    const int id = insertNode(n, index);
+    if (id < 0) return -1;
+    scheduleSave();
+    emit nodeAdded(m_nodes.value(id).parent, id);
+    if (first) emit urlBookmarkedChanged(url, true);
+    return id;
+}
+
+int BookmarkStore::addFolder(int parentId, const QString& title, int index)
+{
+    load();
+    BookmarkNode n;
+    n.parent = parentId;
+    n.folder = true;
+    n.title = title;
+    const int id = insertNode(n, index);
+    if (id < 0) return -1;
+    scheduleSave();
+    emit nodeAdded(m_nodes.value(id).parent, id);
+    return id;
+}
+
+int BookmarkStore::insertNode(BookmarkNode node, int index)
+{
+    auto parent = m_nodes.find(node.parent < 0 ? ROOT_ID : node.parent);
+    if (parent == m_nodes.end() || !parent->folder) return -1;
+
+    node.id = m_nextId++;
+    node.parent = parent->id;
+    if (index < 0 || index > parent->children.size()) {
+        parent->children.append(node.id);
+    } else {
+        parent->children.insert(index, node.id);
+    }
+    if (!node.folder) {
+        indexUrl(node.url, node.id);
+        ++m_bookmarkCount;
+    }
+    m_nodes.insert(node.id, node);
+    return node.id;
+}
+
+void BookmarkStore::remove(int id)
+{
+    if (id == ROOT_ID || !m_nodes.contains(id)) return;
+    const int parentId = m_nodes.value(id).parent;
+    m_nodes[parentId].children.removeOne(id);
+
+    // Collect URLs first so signals fire once the tree is consistent
+    QStringList urls;
+    std::function<void(int)> collect = [&](int nodeId) {
+        const BookmarkNode& n = m_nodes[nodeId];
+        if (n.folder) {
+            for (int child : n.children) collect(child);
+        } else {
+            urls.append(n.url);
+        }
+    };
+    collect(id);
+    removeSubtree(id);
+    scheduleSave();
+
+    emit nodeRemoved(parentId, id);
+    urls.removeDuplicates();
+    for (const QString& url : urls) {
+        if (!m_byUrl.contains(url)) emit urlBookmarkedChanged(url, false);
+    }
+}
+
+void BookmarkStore::removeSubtree(int id)
+{
+    const BookmarkNode n = m_nodes.take(id);
+    if (n.folder) {
+        for (int child : n.children) removeSubtree(child);
+    } else {
+        unindexUrl(n.url, id);
+        --m_bookmarkCount;
+    }
+}
+
+void BookmarkStore::removeUrl(const QString& url)
+{
+    load();
+    // remove() may emit; take a copy since the index changes underneath
+    const QVector<int> ids = m_byUrl.value(url);
+    for (int id : ids) remove(id);
+}
+
+void BookmarkStore::setTitle(int id, const QString& title)
+{
+    auto it = m_nodes.find(id);
+    if (it == m_nodes.end() || id == ROOT_ID || it->title == title) return;
+    it->title = title;
+    scheduleSave();
+    emit nodeChanged(id);
+}
+
+bool BookmarkStore::move(int id, int newParentId, int index)
+{
+    if (id == ROOT_ID || !m_nodes.contains(id)) return false;
+    auto target = m_nodes.constFind(newParentId);
+    if (target == m_nodes.constEnd() || !target->folder) return false;
+    // A folder can't move into itself or a descendant
+    for (int p = newParentId; p >= 0; p = m_nodes.value(p).parent) {
+        if (p == id) return false;
+    }
+
+    const int oldParentId = m_nodes.value(id).parent;
+    QVector<int>& oldSiblings = m_nodes[oldParentId].children;
+    const int oldIndex = oldSiblings.indexOf(id);
+    oldSiblings.removeAt(oldIndex);
+    if (oldParentId == newParentId && index > oldIndex) --index;
+
+    QVector<int>& siblings = m_nodes[newParentId].children;
+    if (index < 0 || index > siblings.size()) {
+        siblings.append(id);
+    } else {
+        siblings.insert(index, id);
+    }
+    m_nodes[id].parent = newParentId;
+    scheduleSave();
+
+    emit nodeRemoved(oldParentId, id);
+    emit nodeAdded(newParentId, id);
+    return true;
+}
+
+void BookmarkStore::clear()
+{
+    m_loaded = true;
+    m_nodes.clear();
+    m_byUrl.clear();
+    m_bookmarkCount = 0;
+    BookmarkNode root;
+    root.id = ROOT_ID;
+    root.folder = true;
+    m_nodes.insert(ROOT_ID, root);
+    scheduleSave();
+    emit reset();
+}
+
+int BookmarkStore::insertTree(int parentId, const QVector<BookmarkNode>& nodes)
+{
+    load();
+    auto parent = m_nodes.constFind(parentId);
+    if (parent == m_nodes.constEnd() || !parent->folder) return 0;
+
+    // Decide what survives first: new URLs, then the folders holding them.
+    // Children always follow their parent, so one backwards pass suffices.
+    QVector<bool> keep(nodes.size(), false);
+    QSet<QString> seen;
+    for (int i = 0; i < nodes.size(); ++i) {
+        const BookmarkNode& n = nodes.at(i);
+        if (n.folder || n.url.isEmpty() || m_byUrl.contains(n.url) || seen.contains(n.url)) continue;
+        seen.insert(n.url);
+        keep[i] = true;
+    }
+    for (int i = nodes.size() - 1; i >= 0; --i) {
+        const int p = nodes.at(i).parent;
+        if (keep[i] && p >= 0) keep[p] = true;
+    }
+
+    QVector<int> ids(nodes.size(), -1);
+    int added = 0;
+    for (int i = 0; i < nodes.size(); ++i) {
+        if (!keep[i]) continue;
+        BookmarkNode n = nodes.at(i);
+        n.parent = n.parent >= 0 ? ids.at(n.parent) : parentId;
+        n.children.clear();
+        ids[i] = insertNode(n, -1);
+        if (!n.folder) ++added;
+    }
+    if (added == 0) return 0;
+    scheduleSave();
+    emit reset();
+    return added;
+}
+
+QList<Bookmark> BookmarkStore::bookmarks() const
+{
+    QList<Bookmark> result;
+    result.reserve(m_bookmarkCount);
+    std::function<void(int)> walk = [&](int id) {
+        const BookmarkNode& n = m_nodes.find(id).value();
+        if (n.folder) {
+            for (int child : n.children) walk(child);
+        } else {
+            result.append({n.title, n.url});
+        }
+    };
+    walk(ROOT_ID);
+    return result;
+}
+
+void BookmarkStore::flush()
+{
+    if (m_saveTimer.isActive()) {
+        m_saveTimer.stop();
+        const QHash<int, BookmarkNode> nodes = m_nodes;
+        const QString path = m_path;
+        QMetaObject::invokeMethod(m_worker, [path, nodes]() { writeBookmarks(path, nodes); });
+    }
+    // Wait for this and any earlier queued write
+    QMetaObject::invokeMethod(m_worker, []() {}, Qt::BlockingQueuedConnection);
+}
+
+void BookmarkStore::indexUrl(const QString& url, int id)
+{
+    m_byUrl[url].append(id);
+}
+
+void BookmarkStore::unindexUrl(const QString& url, int id)
+{
+    auto it = m_byUrl.find(url);
+    if (it == m_byUrl.end()) return;
+    it->removeOne(id);
+    if (it->isEmpty()) m_byUrl.erase(it);
+}
+
+void BookmarkStore::scheduleSave()
+{
+    // Coalesce bursts (imports, folder deletes) into one file write
+    if (!m_saveTimer.isActive()) m_saveTimer.start();
+}
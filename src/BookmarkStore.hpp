@@ -0,0 +1,117 @@
+/**
+ * BookmarkStore - Folder tree of bookmarks with a URL index
+ *
+ * - Nodes are kept in an id -> node hash; folders list their children in
+ *   display order, so a folder's contents are available without a scan
+ * - A URL -> node ids hash answers "is this page bookmarked" in O(1)
+ * - Saved as JSON (bookmarks.json) from a background thread, with bursts
+ *   of edits coalesced into one atomic write
+ * - Change signals name the affected folder so views refresh only that
+ * - Nothing is read until load() (called after the first window paints, or
+ *   by the first edit); until then the tree is empty and load() ends with
+ *   reset()
+ */
+
+#ifndef BOOKMARKSTORE_HPP
+#define BOOKMARKSTORE_HPP
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+struct Bookmark
+{
+    QString title;
+    QString url;
+};
+
+struct BookmarkNode
+{
+    int id = -1;
+    int parent = -1;
+    bool folder = false;
+    QString title;
+    QString url;            // empty for folders
+    QVector<int> children;  // folders only, in display order
+
+    bool isNull() const { return id < 0; }
+};
+
+class BookmarkStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int ROOT_ID = 0;
+
+    explicit BookmarkStore(QObject* parent = nullptr);
+    ~BookmarkStore();
+
+    // Reads bookmarks.json (or migrates old settings); no-op after the first call
+    void load();
+    bool isLoaded() const { return m_loaded; }
+
+    BookmarkNode node(int id) const { return m_nodes.value(id); }
+    QVector<int> children(int folderId) const { return m_nodes.value(folderId).children; }
+    int count() const { return m_bookmarkCount; }
+
+    bool isBookmarked(const QString& url) const { return m_byUrl.contains(url); }
+    QVector<int> idsForUrl(const QString& url) const { return m_byUrl.value(url); }
+
+    // index < 0 appends. Return the new node id, or -1 if parent isn't a folder.
+    int addBookmark(int parentId, const QString& title, const QString& url, int index = -1);
+    int addFolder(int parentId, const QString& title, int index = -1);
+    // Folders are removed with everything in them
+    void remove(int id);
+    void removeUrl(const QString& url);
+    void setTitle(int id, const QString& title);
+    bool move(int id, int newParentId, int index = -1);
+    void clear();
+
+    // Adds a whole subtree in one step (imports). Nodes come parent-first;
+    // each node's parent is the index of its folder within nodes, or -1 for
+    // parentId. URLs already bookmarked are skipped and folders left empty
+    // are dropped. Emits reset() once; returns the bookmarks added.
+    int insertTree(int parentId, const QVector<BookmarkNode>& nodes);
+
+    // Every bookmark, depth-first (for index rebuilds)
+    QList<Bookmark> bookmarks() const;
+
+    // Write any pending changes now
+    void flush();
+
+signals:
+    void nodeAdded(int parentId, int id);
+    void nodeRemoved(int parentId, int id);
+    void nodeChanged(int id);
+    // A URL gained its first or lost its last bookmark
+    void urlBookmarkedChanged(const QString& url, bool bookmarked);
+    // Bulk change (clear, import): re-read everything; no per-node signals
+    void reset();
+
+private:
+    void readFile();
+    void migrateFromSettings();
+    int insertNode(BookmarkNode node, int index);
+    void removeSubtree(int id);
+    void indexUrl(const QString& url, int id);
+    void unindexUrl(const QString& url, int id);
+    void scheduleSave();
+
+    QHash<int, BookmarkNode> m_nodes;
+    QHash<QString, QVector<int>> m_byUrl;
+    int m_nextId = ROOT_ID + 1;
+    bool m_loaded = false;
+    int m_bookmarkCount = 0;
+    QString m_path;
+
+    QThread m_thread;
+    QObject* m_worker;
+    QTimer m_saveTimer;
+};
+
+#endif // BOOKMARKSTORE_HPP
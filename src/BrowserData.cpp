@@ -0,0 +1,72 @@
+/**
+ * BrowserData implementation
+ */
+
+#include "BrowserData.hpp"
+#include "BookmarkStore.hpp"
+#include "HistoryStore.hpp"
+#include "OmniboxIndex.hpp"
+#include "PageTextIndex.hpp"
+#include "SessionStore.hpp"
+#include "ThumbnailCache.hpp"
+#include <QApplication>
+
+BrowserData* BrowserData::instance()
+{
+    static BrowserData* data = nullptr;
+    if (!data) data = new BrowserData(qApp);
+    return data;
+}
+
+BrowserData::BrowserData(QObject* parent)
+    : QObject(parent)
+    , m_history(new HistoryStore(this))
+    , m_omnibox(new OmniboxIndex(this))
+    , m_pageText(new PageTextIndex(this))
+    , m_bookmarks(new BookmarkStore(this))
+    , m_session(new SessionStore(this))
+    , m_thumbnails(new ThumbnailCache(this))
+{
+    // Keep the completion index in step with history
+    connect(m_history, &HistoryStore::loaded, this, [this]() {
+        m_omnibox->rebuild(m_history->snapshot(), m_bookmarks->bookmarks());
+    });
+    connect(m_history, &HistoryStore::visited, m_omnibox, &OmniboxIndex::noteVisit);
+    connect(m_history, &HistoryStore::removed, m_omnibox, &OmniboxIndex::removeHistory);
+    connect(m_history, &HistoryStore::removedMany, this, [this]() {
+        m_omnibox->rebuild(m_history->snapshot(), m_bookmarks->bookmarks());
+    });
+    connect(m_history, &HistoryStore::cleared, this, [this]() {
+        m_omnibox->rebuild({}, m_bookmarks->bookmarks());
+    });
+    connect(m_history, &HistoryStore::imported, this, [this]() {
+        m_omnibox->rebuild(m_history->snapshot(), m_bookmarks->bookmarks());
+    });
+
+    // Page text follows history: removed or expired pages leave the index too
+    connect(m_history, &HistoryStore::removed, m_pageText, &PageTextIndex::removeUrl);
+    connect(m_history, &HistoryStore::removedMany, m_pageText, &PageTextIndex::removeUrls);
+    connect(m_history, &HistoryStore::cleared, m_pageText, &PageTextIndex::clear);
+    // ...and so do their thumbnails
+    connect(m_history, &HistoryStore::removed, m_thumbnails, [this](const QString& url) {
+        m_thumbnails->remove({url});
+    });
+    connect(m_history, &HistoryStore::removedMany, m_thumbnails, &ThumbnailCache::remove);
+    connect(m_history, &HistoryStore::cleared, m_thumbnails, &ThumbnailCache::clear);
+
+    // Only a URL's first bookmark or the removal of its last one matters here
+    connect(m_bookmarks, &BookmarkStore::urlBookmarkedChanged, this, [this](const QString& url, bool bookmarked) {
+        const QVector<int> ids = m_bookmarks->idsForUrl(url);
+        const QString title = ids.isEmpty() ? QString() : m_bookmarks->node(ids.first()).title;
+        m_omnibox->setBookmarked(url, title, bookmarked);
+    });
+    connect(m_bookmarks, &BookmarkStore::reset, this, [this]() {
+        if (m_history->isLoaded()) m_omnibox->rebuild(m_history->snapshot(), m_bookmarks->bookmarks());
+    });
+}
+
+void BrowserData::loadDeferred()
+{
+    m_bookmarks->load();
+    m_history->load();
+}
@@ -0,0 +1,50 @@
+/**
+ * BrowserData - Process-wide bookmarks, history and session state
+ *
+ * Loaded once per process and shared by every MainWindow, so opening a
+ * window costs no disk I/O and windows can't overwrite each other's saves.
+ * Also keeps the completion and page-text indexes in step with the stores.
+ */
+
+#ifndef BROWSERDATA_HPP
+#define BROWSERDATA_HPP
+
+#include <QObject>
+
+class BookmarkStore;
+class HistoryStore;
+class OmniboxIndex;
+class PageTextIndex;
+class SessionStore;
+class ThumbnailCache;
+
+class BrowserData : public QObject
+{
+    Q_OBJECT
+
+public:
+    static BrowserData* instance();
+
+    HistoryStore* history() const { return m_history; }
+    OmniboxIndex* omnibox() const { return m_omnibox; }
+    PageTextIndex* pageText() const { return m_pageText; }
+    BookmarkStore* bookmarks() const { return m_bookmarks; }
+    SessionStore* session() const { return m_session; }
+    ThumbnailCache* thumbnails() const { return m_thumbnails; }
+
+    // Bookmarks and history aren't read at construction; main() calls this
+    // once the first window has painted. Earlier edits load them on demand.
+    void loadDeferred();
+
+private:
+    explicit BrowserData(QObject* parent = nullptr);
+
+    HistoryStore* m_history;
+    OmniboxIndex* m_omnibox;
+    PageTextIndex* m_pageText;
+    BookmarkStore* m_bookmarks;
+    SessionStore* m_session;
+    ThumbnailCache* m_thumbnails;
+};
+
+#endif // BROWSERDATA_HPP
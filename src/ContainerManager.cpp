@@ -0,0 +1,195 @@
+/**
+ * ContainerManager implementation
+ */
+
+#include "ContainerManager.hpp"
+#include "CookieIndex.hpp"
+#include "DownloadManager.hpp"
+#include "HttpsUpgrader.hpp"
+#include "NewTabPage.hpp"
+#include "PerformanceProfile.hpp"
+#include "Settings.hpp"
+#include <QApplication>
+#include <QDir>
+#include <QStandardPaths>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QWebEnginePage>
+#include <QWebEngineProfile>
+
+namespace {
+
+const char* const SETTING = "containers";
+const char* const OFF_THE_RECORD_PREFIX = "otr-";
+
+} // namespace
+
+ContainerManager* ContainerManager::instance()
+{
+    static ContainerManager* manager = nullptr;
+    if (!manager) manager = new ContainerManager(qApp);
+    return manager;
+}
+
+ContainerManager::ContainerManager(QObject* parent)
+    : QObject(parent)
+    , m_newTabPage(new NewTabPage(NewTabPage::TopSites, this))
+    , m_blankNewTabPage(new NewTabPage(NewTabPage::Blank, this))
+    , m_dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/containers")
+{
+    const QVariantList list = Settings::instance()->value(SETTING).toList();
+    for (const QVariant& item : list) {
+        const QVariantMap map = item.toMap();
+        Container c;
+        c.id = map.value("id").toString();
+        c.name = map.value("name").toString();
+        c.cacheMB = map.value("cacheMB").toInt();
+        if (!c.id.isEmpty()) m_containers.append(c);
+    }
+}
+
+QVector<ContainerManager::Container> ContainerManager::containers() const
+{
+    return m_containers;
+}
+
+bool ContainerManager::contains(const QString& id) const
+{
+    return !container(id).id.isEmpty();
+}
+
+ContainerManager::Container ContainerManager::container(const QString& id) const
+{
+    if (id.isEmpty()) return Container();
+    if (id.startsWith(OFF_THE_RECORD_PREFIX)) return m_offTheRecord.value(id);
+    for (const Container& c : m_containers) {
+        if (c.id == id) return c;
+    }
+    return Container();
+}
+
+QString ContainerManager::createContainer(const QString& name, int cacheMB)
+{
+    // Ids name directories on disk, so they are never reused
+    const int next = Settings::instance()->value("nextContainerId", 1).toInt();
+    Settings::instance()->setValue("nextContainerId", next + 1);
+
+    Container c;
+    c.id = QString::number(next);
+    c.name = name;
+    c.cacheMB = qMax(0, cacheMB);
+    m_containers.append(c);
+    save();
+    emit containersChanged();
+    return c.id;
+}
+
+bool ContainerManager::removeContainer(const QString& id)
+{
+    if (isInUse(id) || id.startsWith(OFF_THE_RECORD_PREFIX)) return false;
+    for (int i = 0; i < m_containers.size(); ++i) {
+        if (m_containers.at(i).id != id) continue;
+        m_containers.removeAt(i);
+        save();
+        QDir(m_dir + "/" + id).removeRecursively();
+        emit containersChanged();
+        return true;
+    }
+    return false;
+}
+
+QString ContainerManager::createOffTheRecord()
+{
+    Container c;
+    c.id = OFF_THE_RECORD_PREFIX + QString::number(m_nextOffTheRecord);
+    c.name = tr("Private %1").arg(m_nextOffTheRecord);
+    c.offTheRecord = true;
+    ++m_nextOffTheRecord;
+    m_offTheRecord.insert(c.id, c);
+    return c.id;
+}
+
+void ContainerManager::setUp(QWebEngineProfile* profile, bool offTheRecord)
+{
+    PerformanceProfile::applyTo(profile);
+    new CookieIndex(profile);
+    profile->installUrlSchemeHandler(NewTabPage::SCHEME, offTheRecord ? m_blankNewTabPage : m_newTabPage);
+    if (!offTheRecord) profile->setUrlRequestInterceptor(HttpsUpgrader::instance());
+    connect(profile, &QWebEngineProfile::downloadRequested, this, &ContainerManager::downloadRequested);
+}
+
+QWebEngineProfile* ContainerManager::acquire(const QString& id, QObject* user)
+{
+    const Container c = container(id);
+    if (c.id.isEmpty()) return QWebEngineProfile::defaultProfile();
+
+    Loaded& loaded = m_loaded[id];
+    if (!loaded.profile) {
+        if (c.offTheRecord) {
+            // No storage name: Chromium keeps cookies, storage and cache in memory
+            loaded.profile = new QWebEngineProfile(this);
+        } else {
+            loaded.profile = new QWebEngineProfile("container-" + id, this);
+            loaded.profile->setPersistentStoragePath(m_dir + "/" + id);
+            loaded.profile->setCachePath(m_dir + "/" + id + "/cache");
+        }
+        setUp(loaded.profile, c.offTheRecord);
+        if (c.cacheMB > 0) loaded.profile->setHttpCacheMaximumSize(c.cacheMB * 1024 * 1024);
+    }
+    ++loaded.users;
+    // A window's views go before its destroyed() is emitted
+    connect(user, &QObject::destroyed, this, [this, id]() { release(id); });
+    return loaded.profile;
+}
+
+void ContainerManager::release(const QString& id)
+{
+    auto it = m_loaded.find(id);
+    if (it == m_loaded.end() || --it->users > 0) return;
+    // Downloads die with their profile without finishing; it stays loaded
+    // (and is reused if a window asks for it again) until they are done
+    DownloadManager* downloads = DownloadManager::instance();
+    if (downloads->isBusy(it->profile)) {
+        connect(downloads, &DownloadManager::profileIdle, this, &ContainerManager::onProfileIdle, Qt::UniqueConnection);
+        return;
+    }
+    unload(id);
+}
+
+void ContainerManager::onProfileIdle(QWebEngineProfile* profile)
+{
+    for (auto it = m_loaded.cbegin(); it != m_loaded.cend(); ++it) {
+        if (it->profile == profile && it->users == 0) {
+            unload(it.key());
+            return;
+        }
+    }
+}
+
+void ContainerManager::unload(const QString& id)
+{
+    auto it = m_loaded.find(id);
+    if (it == m_loaded.end()) return;
+    QWebEngineProfile* profile = it->profile;
+    // Pages must go before their profile; DownloadManager parents its
+    // retry page to it
+    const QList<QWebEnginePage*> pages = profile->findChildren<QWebEnginePage*>(QString(), Qt::FindDirectChildrenOnly);
+    qDeleteAll(pages);
+    // Pages may still be on their way out through deleteLater
+    profile->deleteLater();
+    m_loaded.erase(it);
+    m_offTheRecord.remove(id);
+}
+
+void ContainerManager::save()
+{
+    QVariantList list;
+    for (const Container& c : qAsConst(m_containers)) {
+        QVariantMap map;
+        map.insert("id", c.id);
+        map.insert("name", c.name);
+        map.insert("cacheMB", c.cacheMB);
+        list.append(map);
+    }
+    Settings::instance()->setValue(SETTING, list);
+}
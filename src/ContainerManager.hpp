@@ -0,0 +1,94 @@
+/**
+ * ContainerManager - Separate cookie, storage and cache jars for windows
+ *
+ * A container is its own QWebEngineProfile, so logins, local storage and
+ * HTTP cache in one never mix with another's. Named containers keep their
+ * data under containers/<id>/ in the data directory, each with its own
+ * cache size. Off-the-record containers keep everything in memory; their
+ * profile and all it held are freed when the last window using it closes.
+ *
+ * The empty id is the default profile, which main() sets up. Other
+ * profiles are created when a window first acquires them and released
+ * once the last such window is gone and their downloads have finished.
+ * Every profile gets the browser's scheme handler, a CookieIndex and HTTPS
+ * upgrades (except off the record, where learned hosts would be written to
+ * disk), and their downloads are reported through one signal, for
+ * DownloadManager.
+ */
+
+#ifndef CONTAINERMANAGER_HPP
+#define CONTAINERMANAGER_HPP
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+class NewTabPage;
+class QWebEngineDownloadItem;
+class QWebEngineProfile;
+
+class ContainerManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ContainerManager* instance();
+
+    struct Container
+    {
+        QString id;
+        QString name;
+        int cacheMB = 0;            // 0 uses the performance profile's size
+        bool offTheRecord = false;
+    };
+
+    // Named containers in creation order; off-the-record ones aren't listed
+    QVector<Container> containers() const;
+    bool contains(const QString& id) const;
+    // A default-constructed Container for the default profile or an unknown id
+    Container container(const QString& id) const;
+
+    QString createContainer(const QString& name, int cacheMB = 0);
+    // Deletes its stored data as well; refused while a window or a
+    // download uses it
+    bool removeContainer(const QString& id);
+    // Exists until the last window that acquired it is destroyed
+    QString createOffTheRecord();
+
+    void setUp(QWebEngineProfile* profile, bool offTheRecord = false);
+
+    // The container's profile, held until user is destroyed and its
+    // downloads have finished; the default profile for the empty id or an
+    // unknown one
+    QWebEngineProfile* acquire(const QString& id, QObject* user);
+    bool isInUse(const QString& id) const { return m_loaded.contains(id); }
+
+signals:
+    void containersChanged();
+    void downloadRequested(QWebEngineDownloadItem* download);
+
+private:
+    explicit ContainerManager(QObject* parent = nullptr);
+
+    struct Loaded
+    {
+        QWebEngineProfile* profile = nullptr;
+        int users = 0;
+    };
+
+    void release(const QString& id);
+    void onProfileIdle(QWebEngineProfile* profile);
+    void unload(const QString& id);
+    void save();
+
+    QVector<Container> m_containers;
+    QHash<QString, Container> m_offTheRecord;
+    QHash<QString, Loaded> m_loaded;
+    NewTabPage* m_newTabPage;
+    NewTabPage* m_blankNewTabPage;  // for off-the-record profiles
+    QString m_dir;
+    int m_nextOffTheRecord = 1;
+};
+
+#endif // CONTAINERMANAGER_HPP
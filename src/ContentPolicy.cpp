@@ -0,0 +1,287 @@
+/**
+ * ContentPolicy implementation
+ */
+
+#include "ContentPolicy.hpp"
+#include "Settings.hpp"
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QWebEngineSettings>
+#include <QWebEngineUrlRequestInfo>
+
+namespace {
+
+const int RELOAD_DELAY_MS = 200;
+const quint32 LITE_BLOCKED = ContentPolicy::BlockFonts | ContentPolicy::BlockMedia | ContentPolicy::BlockSubframes;
+
+// "*.example.com", ".example.com" and "Example.com" all mean example.com
+QString normalizeHost(QString host)
+{
+    host = host.trimmed().toLower();
+    if (host.startsWith(QLatin1String("*."))) host.remove(0, 2);
+    while (host.startsWith('.')) host.remove(0, 1);
+    return host;
+}
+
+qint8 parseToggle(const QString& value, bool* ok)
+{
+    *ok = true;
+    if (value == QLatin1String("on") || value == QLatin1String("true") || value == QLatin1String("1")) return 1;
+    if (value == QLatin1String("off") || value == QLatin1String("false") || value == QLatin1String("0")) return 0;
+    *ok = false;
+    return -1;
+}
+
+quint32 parseBlockList(const QString& value, bool* ok)
+{
+    *ok = true;
+    quint32 blocked = 0;
+    for (const QString& name : value.split(',', Qt::SkipEmptyParts)) {
+        if (name == QLatin1String("images")) blocked |= ContentPolicy::BlockImages;
+        else if (name == QLatin1String("fonts")) blocked |= ContentPolicy::BlockFonts;
+        else if (name == QLatin1String("media")) blocked |= ContentPolicy::BlockMedia;
+        else if (name == QLatin1String("subframes")) blocked |= ContentPolicy::BlockSubframes;
+        else *ok = false;
+    }
+    return blocked;
+}
+
+QStringList tokensOf(const QString& line)
+{
+    static const QRegularExpression space("\\s+");
+    return line.trimmed().split(space, Qt::SkipEmptyParts);
+}
+
+} // namespace
+
+ContentPolicy* ContentPolicy::instance()
+{
+    static ContentPolicy* policy = nullptr;
+    if (!policy) policy = new ContentPolicy(qApp);
+    return policy;
+}
+
+ContentPolicy::ContentPolicy(QObject* parent)
+    : QObject(parent)
+    , m_path(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation)
+             + "/" + Settings::ORGANIZATION + "/content-policy.conf")
+{
+    m_nodes.append(Node());
+
+    // Editors usually save by replacing the file, which ends a watch on the
+    // file itself; the directory watch catches that. The directory also holds
+    // the settings file, whose every save must not reload the rules.
+    m_reloadTimer.setSingleShot(true);
+    m_reloadTimer.setInterval(RELOAD_DELAY_MS);
+    connect(&m_reloadTimer, &QTimer::timeout, this, [this]() {
+        if (fileChanged()) reload();
+        watch();
+    });
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, &m_reloadTimer, QOverload<>::of(&QTimer::start));
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, &m_reloadTimer, QOverload<>::of(&QTimer::start));
+
+    reload();
+    watch();
+}
+
+ContentPolicy::Policy ContentPolicy::policyFor(const QString& host) const
+{
+    Policy result;
+    auto merge = [&result](const Policy& p) {
+        if (p.javascript >= 0) result.javascript = p.javascript;
+        if (p.images >= 0) result.images = p.images;
+        if (p.plugins >= 0) result.plugins = p.plugins;
+        result.blocked |= p.blocked;
+        result.lite = result.lite || p.lite;
+    };
+
+    // Labels from the right: www.example.com visits com, example, www
+    int node = 0;
+    if (m_nodes.at(0).policy >= 0) merge(m_policies.at(m_nodes.at(0).policy));
+    int end = host.size();
+    while (end > 0) {
+        const int dot = host.lastIndexOf('.', end - 1);
+        const QString label = host.mid(dot + 1, end - dot - 1).toLower();
+        const int child = m_nodes.at(node).children.value(label, -1);
+        if (child < 0) break;
+        node = child;
+        if (m_nodes.at(node).policy >= 0) merge(m_policies.at(m_nodes.at(node).policy));
+        end = dot;
+    }
+    return result;
+}
+
+void ContentPolicy::apply(QWebEngineSettings* settings, const QString& host) const
+{
+    const Policy policy = policyFor(host);
+    auto set = [settings](QWebEngineSettings::WebAttribute attribute, qint8 value) {
+        if (value < 0) settings->resetAttribute(attribute);
+        else settings->setAttribute(attribute, value != 0);
+    };
+    set(QWebEngineSettings::JavascriptEnabled, policy.javascript);
+    set(QWebEngineSettings::AutoLoadImages, policy.images);
+    set(QWebEngineSettings::PluginsEnabled, policy.plugins);
+}
+
+bool ContentPolicy::shouldBlock(const QWebEngineUrlRequestInfo& info) const
+{
+    BlockType type;
+    switch (info.resourceType()) {
+    case QWebEngineUrlRequestInfo::ResourceTypeImage:
+    case QWebEngineUrlRequestInfo::ResourceTypeFavicon:
+        type = BlockImages;
+        break;
+    case QWebEngineUrlRequestInfo::ResourceTypeFontResource:
+        type = BlockFonts;
+        break;
+    case QWebEngineUrlRequestInfo::ResourceTypeMedia:
+        type = BlockMedia;
+        break;
+    case QWebEngineUrlRequestInfo::ResourceTypeSubFrame:
+        type = BlockSubframes;
+        break;
+    default:
+        return false;
+    }
+    return policyFor(info.firstPartyUrl().host()).blocked & type;
+}
+
+void ContentPolicy::setLite(const QString& host, bool lite)
+{
+    const QString target = normalizeHost(host);
+    if (target.isEmpty()) return;
+
+    QStringList lines;
+    QFile in(m_path);
+    if (in.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream ts(&in);
+        while (!ts.atEnd()) lines.append(ts.readLine());
+    }
+    auto lineFor = [&lines](const QString& h) {
+        for (int i = 0; i < lines.size(); ++i) {
+            const QStringList tokens = tokensOf(lines.at(i));
+            if (!tokens.isEmpty() && !tokens.first().startsWith('#') && normalizeHost(tokens.first()) == h) return i;
+        }
+        return -1;
+    };
+
+    if (lite) {
+        const int i = lineFor(target);
+        if (i < 0) lines.append(target + "  lite");
+        else if (!tokensOf(lines.at(i)).contains("lite")) lines[i] += "  lite";
+    } else {
+        // Off for this site means off for whichever line turned it on
+        QString candidate = target;
+        for (;;) {
+            const int i = lineFor(candidate);
+            QStringList tokens = i >= 0 ? tokensOf(lines.at(i)) : QStringList();
+            if (tokens.removeAll("lite") > 0) {
+                if (tokens.size() > 1) lines[i] = tokens.join("  ");
+                else lines.removeAt(i);
+                break;
+            }
+            const int dot = candidate.indexOf('.');
+            if (dot < 0) break;
+            candidate = candidate.mid(dot + 1);
+        }
+    }
+
+    QDir().mkpath(QFileInfo(m_path).path());
+    QSaveFile out(m_path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Text)) return;
+    out.write(lines.join('\n').toUtf8() + '\n');
+    if (!out.commit()) return;
+    reload();
+    watch();
+}
+
+bool ContentPolicy::fileChanged() const
+{
+    const QFileInfo info(m_path);
+    if (!info.exists()) return m_loadedSize >= 0;
+    return info.lastModified().toMSecsSinceEpoch() != m_loadedModified || info.size() != m_loadedSize;
+}
+
+void ContentPolicy::reload()
+{
+    QVector<Node> nodes(1);
+    QVector<Policy> policies;
+
+    const QFileInfo info(m_path);
+    m_loadedModified = info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+    m_loadedSize = info.exists() ? info.size() : -1;
+
+    QFile file(m_path);
+    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QTextStream ts(&file);
+        int lineNumber = 0;
+        while (!ts.atEnd()) {
+            ++lineNumber;
+            const QStringList tokens = tokensOf(ts.readLine());
+            if (tokens.isEmpty() || tokens.first().startsWith('#')) continue;
+
+            Policy policy;
+            bool valid = true;
+            for (int i = 1; i < tokens.size() && valid; ++i) {
+                const QString token = tokens.at(i).toLower();
+                if (token == QLatin1String("lite")) {
+                    policy.lite = true;
+                    policy.blocked |= LITE_BLOCKED;
+                    if (policy.plugins < 0) policy.plugins = 0;
+                    continue;
+                }
+                const int eq = token.indexOf('=');
+                const QString key = token.left(eq);
+                const QString value = eq < 0 ? QString() : token.mid(eq + 1);
+                if (key == QLatin1String("javascript")) policy.javascript = parseToggle(value, &valid);
+                else if (key == QLatin1String("images")) policy.images = parseToggle(value, &valid);
+                else if (key == QLatin1String("plugins")) policy.plugins = parseToggle(value, &valid);
+                else if (key == QLatin1String("block")) policy.blocked |= parseBlockList(value, &valid);
+                else valid = false;
+            }
+            if (!valid) {
+                qWarning("ContentPolicy: %s:%d: not understood, line ignored", qPrintable(m_path), lineNumber);
+                continue;
+            }
+
+            // Insert from the TLD inwards; "*" is the root itself
+            int node = 0;
+            const QString host = tokens.first() == QLatin1String("*") ? QString() : normalizeHost(tokens.first());
+            const QStringList labels = host.split('.', Qt::SkipEmptyParts);
+            for (auto it = labels.crbegin(); it != labels.crend(); ++it) {
+                int child = nodes.at(node).children.value(*it, -1);
+                if (child < 0) {
+                    child = nodes.size();
+                    nodes[node].children.insert(*it, child);
+                    nodes.append(Node());
+                }
+                node = child;
+            }
+            // A later line for the same host replaces an earlier one
+            if (nodes.at(node).policy >= 0) {
+                policies[nodes.at(node).policy] = policy;
+            } else {
+                nodes[node].policy = policies.size();
+                policies.append(policy);
+            }
+        }
+    }
+
+    m_nodes = nodes;
+    m_policies = policies;
+    emit policiesChanged();
+}
+
+void ContentPolicy::watch()
+{
+    const QString dir = QFileInfo(m_path).path();
+    QDir().mkpath(dir);
+    if (!m_watcher.directories().contains(dir)) m_watcher.addPath(dir);
+    if (QFile::exists(m_path) && !m_watcher.files().contains(m_path)) m_watcher.addPath(m_path);
+}
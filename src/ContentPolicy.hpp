@@ -0,0 +1,98 @@
+/**
+ * ContentPolicy - Per-site JavaScript, image and resource type rules
+ *
+ * Rules live in content-policy.conf in the config directory, one site per
+ * line, and apply to the host and all its subdomains:
+ *
+ *   # host            settings
+ *   *                 plugins=off
+ *   example.com       javascript=off
+ *   video.example.com lite
+ *   news.example.org  images=off block=fonts,media
+ *
+ * Settings are javascript, images and plugins (on/off); block= lists
+ * resource types to refuse (images, fonts, media, subframes). "lite" is
+ * block=fonts,media,subframes plugins=off. For the on/off settings the
+ * most specific line wins; block lists add up along the way.
+ * Resource types are matched against the site of the page, not the host
+ * the resource comes from.
+ *
+ * Hosts are kept in a trie of labels from the TLD inwards, so a lookup
+ * costs one hash probe per label. The file is watched and reloaded when it
+ * changes; pages pick up new rules on their next navigation.
+ */
+
+#ifndef CONTENTPOLICY_HPP
+#define CONTENTPOLICY_HPP
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QTimer>
+#include <QVector>
+
+class QWebEngineSettings;
+class QWebEngineUrlRequestInfo;
+
+class ContentPolicy : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ContentPolicy* instance();
+
+    enum BlockType : quint32 {
+        BlockImages = 1 << 0,
+        BlockFonts = 1 << 1,
+        BlockMedia = 1 << 2,
+        BlockSubframes = 1 << 3
+    };
+
+    struct Policy
+    {
+        // -1 leaves the global default alone
+        qint8 javascript = -1;
+        qint8 images = -1;
+        qint8 plugins = -1;
+        quint32 blocked = 0;
+        bool lite = false;
+    };
+
+    Policy policyFor(const QString& host) const;
+    // Called on each main-frame navigation
+    void apply(QWebEngineSettings* settings, const QString& host) const;
+    // Called from each page's request interceptor
+    bool shouldBlock(const QWebEngineUrlRequestInfo& info) const;
+
+    // Adds "lite" to the host's own line, or takes it off whichever line
+    // gives the host lite mode; the file is rewritten and reloaded
+    void setLite(const QString& host, bool lite);
+    QString path() const { return m_path; }
+
+signals:
+    void policiesChanged();
+
+private:
+    explicit ContentPolicy(QObject* parent = nullptr);
+
+    struct Node
+    {
+        QHash<QString, int> children;   // label -> node index
+        int policy = -1;                // index into m_policies
+    };
+
+    void reload();
+    void watch();
+    // Whether the file differs from the one last parsed
+    bool fileChanged() const;
+
+    QString m_path;
+    QVector<Node> m_nodes;              // [0] is the root; "*" lives there
+    QVector<Policy> m_policies;
+    qint64 m_loadedModified = -1;       // of the file last parsed, -1 if none
+    qint64 m_loadedSize = -1;
+    QFileSystemWatcher m_watcher;
+    QTimer m_reloadTimer;
+};
+
+#endif // CONTENTPOLICY_HPP
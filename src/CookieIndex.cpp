@@ -0,0 +1,139 @@
+/**
+ * CookieIndex implementation
+ */
+
+#include "CookieIndex.hpp"
+#include "BrowserData.hpp"
+#include "FilterMatcher.hpp"
+#include "HistoryStore.hpp"
+#include "StorageManager.hpp"
+#include <QTimer>
+#include <QUrl>
+#include <QWebEngineCookieStore>
+#include <QWebEngineProfile>
+#include <QtConcurrent>
+#include <algorithm>
+
+CookieIndex::CookieIndex(QWebEngineProfile* profile)
+    : QObject(profile)
+    , m_profile(profile)
+    , m_store(profile->cookieStore())
+{
+    connect(m_store, &QWebEngineCookieStore::cookieAdded, this, &CookieIndex::add);
+    connect(m_store, &QWebEngineCookieStore::cookieRemoved, this, &CookieIndex::remove);
+}
+
+CookieIndex* CookieIndex::of(QWebEngineProfile* profile)
+{
+    return profile->findChild<CookieIndex*>(QString(), Qt::FindDirectChildrenOnly);
+}
+
+void CookieIndex::load()
+{
+    // Cookies already seen are reported again and just replace themselves
+    if (m_loadRequested) return;
+    m_loadRequested = true;
+    m_store->loadAllCookies();
+}
+
+QStringList CookieIndex::sites() const
+{
+    QStringList result = m_sites.keys();
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+QVector<QNetworkCookie> CookieIndex::cookies(const QString& site) const
+{
+    const QHash<QByteArray, QNetworkCookie> bucket = m_sites.value(site);
+    return QVector<QNetworkCookie>(bucket.cbegin(), bucket.cend());
+}
+
+void CookieIndex::clearSite(const QString& site)
+{
+    const QVector<QNetworkCookie> doomed = cookies(site);
+    for (const QNetworkCookie& cookie : doomed) m_store->deleteCookie(cookie);
+    // The store confirms through cookieRemoved, but the list shouldn't wait
+    m_count -= m_sites.value(site).size();
+    m_sites.remove(site);
+    notifyChanged();
+
+    // History is shared, so the visited links worth clearing are its URLs
+    if (m_visitedToClear.isEmpty()) QTimer::singleShot(0, this, &CookieIndex::clearVisitedLinks);
+    m_visitedToClear.insert(site);
+
+    if (m_profile == QWebEngineProfile::defaultProfile()) StorageManager::instance()->clearSiteData(site);
+}
+
+void CookieIndex::clearVisitedLinks()
+{
+    const QSet<QString> sites = m_visitedToClear;
+    m_visitedToClear.clear();
+    const QVector<HistoryEntry> history = BrowserData::instance()->history()->snapshot();
+
+    auto* watcher = new QFutureWatcher<QList<QUrl>>(this);
+    connect(watcher, &QFutureWatcher<QList<QUrl>>::finished, this, [this, watcher]() {
+        const QList<QUrl> visited = watcher->result();
+        if (!visited.isEmpty()) m_profile->clearVisitedLinks(visited);
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([history, sites]() {
+        QList<QUrl> visited;
+        QHash<QString, bool> hostMatches;
+        for (const HistoryEntry& entry : history) {
+            if (entry.isNull()) continue;
+            const QString host = HistoryStore::hostOf(entry.url).toLower();
+            auto it = hostMatches.constFind(host);
+            if (it == hostMatches.constEnd()) {
+                it = hostMatches.insert(host, !host.isEmpty() && sites.contains(FilterMatcher::registrableDomain(host)));
+            }
+            if (it.value()) visited.append(QUrl(entry.url));
+        }
+        return visited;
+    }));
+}
+
+QByteArray CookieIndex::keyOf(const QNetworkCookie& cookie)
+{
+    // The identity Chromium uses: a cookie with the same three replaces it
+    return cookie.name() + '\0' + cookie.domain().toUtf8() + '\0' + cookie.path().toUtf8();
+}
+
+QString CookieIndex::siteOf(const QString& domain)
+{
+    auto it = m_siteOfDomain.constFind(domain);
+    if (it != m_siteOfDomain.constEnd()) return *it;
+    QString host = domain;
+    while (host.startsWith('.')) host.remove(0, 1);
+    const QString site = FilterMatcher::registrableDomain(host);
+    m_siteOfDomain.insert(domain, site);
+    return site;
+}
+
+void CookieIndex::add(const QNetworkCookie& cookie)
+{
+    QHash<QByteArray, QNetworkCookie>& bucket = m_sites[siteOf(cookie.domain())];
+    const int before = bucket.size();
+    bucket.insert(keyOf(cookie), cookie);
+    m_count += bucket.size() - before;
+    notifyChanged();
+}
+
+void CookieIndex::remove(const QNetworkCookie& cookie)
+{
+    auto it = m_sites.find(siteOf(cookie.domain()));
+    if (it == m_sites.end() || !it->remove(keyOf(cookie))) return;
+    --m_count;
+    if (it->isEmpty()) m_sites.erase(it);
+    notifyChanged();
+}
+
+void CookieIndex::notifyChanged()
+{
+    if (m_changePending) return;
+    m_changePending = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        m_changePending = false;
+        emit changed();
+    }, Qt::QueuedConnection);
+}
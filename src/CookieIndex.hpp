@@ -0,0 +1,73 @@
+/**
+ * CookieIndex - A profile's cookies grouped by site
+ *
+ * QWebEngineCookieStore can only be watched, not queried, so this keeps a
+ * mirror of it from cookieAdded/cookieRemoved, bucketed by registrable
+ * domain (cookies for news.example.co.uk and .example.co.uk both belong to
+ * example.co.uk). Listing sites and a site's cookies is a hash lookup, and
+ * the registrable domain of each cookie domain is worked out once.
+ *
+ * ContainerManager gives every profile one. The store only reports cookies
+ * it has loaded; load() asks for all of them the first time the full list
+ * is wanted. Changes are announced at most once per event loop pass, so a
+ * full load of tens of thousands of cookies doesn't flood the UI.
+ */
+
+#ifndef COOKIEINDEX_HPP
+#define COOKIEINDEX_HPP
+
+#include <QObject>
+#include <QHash>
+#include <QNetworkCookie>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+class QWebEngineCookieStore;
+class QWebEngineProfile;
+
+class CookieIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CookieIndex(QWebEngineProfile* profile);
+    // The one ContainerManager attached to the profile
+    static CookieIndex* of(QWebEngineProfile* profile);
+
+    void load();
+
+    int count() const { return m_count; }
+    int count(const QString& site) const { return m_sites.value(site).size(); }
+    // Sorted
+    QStringList sites() const;
+    QVector<QNetworkCookie> cookies(const QString& site) const;
+
+    // Deletes the site's cookies, its visited links and (for the default
+    // profile) schedules its stored data for removal; the HTTP cache stays.
+    // Visited links are found by a pass over history on the thread pool,
+    // one for all the sites cleared in the same event loop pass.
+    void clearSite(const QString& site);
+
+signals:
+    void changed();
+
+private:
+    static QByteArray keyOf(const QNetworkCookie& cookie);
+    QString siteOf(const QString& domain);
+    void add(const QNetworkCookie& cookie);
+    void remove(const QNetworkCookie& cookie);
+    void notifyChanged();
+    void clearVisitedLinks();
+
+    QWebEngineProfile* m_profile;
+    QWebEngineCookieStore* m_store;
+    QHash<QString, QHash<QByteArray, QNetworkCookie>> m_sites;
+    QHash<QString, QString> m_siteOfDomain;   // cookie domains only
+    QSet<QString> m_visitedToClear;           // sites
+    int m_count = 0;
+    bool m_loadRequested = false;
+    bool m_changePending = false;
+};
+
+#endif // COOKIEINDEX_HPP
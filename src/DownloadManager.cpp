@@ -0,0 +1,413 @@
+/**
+ * DownloadManager implementation
+ */
+
+#include "DownloadManager.hpp"
+#include "ContainerManager.hpp"
+#include "Settings.hpp"
+#include <QApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QWebEngineDownloadItem>
+#include <QWebEnginePage>
+#include <QWebEngineProfile>
+#include <algorithm>
+
+namespace {
+
+const int PROGRESS_INTERVAL_MS = 500;
+// Weight of the newest sample in a download's rate
+const double RATE_SMOOTHING = 0.3;
+const int DEFAULT_MAX_CONCURRENT = 3;
+const char* const RETRY_PAGE = "downloadRetryPage";
+
+bool matches(const DownloadManager::Rule& rule, const QString& mimeType, const QString& host)
+{
+    const QString& pattern = rule.pattern;
+    if (pattern.contains('/')) {
+        if (pattern.endsWith(QLatin1String("/*"))) {
+            return mimeType.startsWith(pattern.leftRef(pattern.size() - 1), Qt::CaseInsensitive);
+        }
+        return mimeType.compare(pattern, Qt::CaseInsensitive) == 0;
+    }
+    return host == pattern || host.endsWith('.' + pattern);
+}
+
+QString expandHome(const QString& path)
+{
+    if (path == QLatin1String("~") || path.startsWith(QLatin1String("~/"))) return QDir::homePath() + path.mid(1);
+    return path;
+}
+
+} // namespace
+
+DownloadManager* DownloadManager::instance()
+{
+    static DownloadManager* manager = nullptr;
+    if (!manager) manager = new DownloadManager(qApp);
+    return manager;
+}
+
+DownloadManager::DownloadManager(QObject* parent)
+    : QObject(parent)
+    , m_maxConcurrent(qMax(1, Settings::instance()->value("maxConcurrentDownloads", DEFAULT_MAX_CONCURRENT).toInt()))
+    , m_defaultDirectory(Settings::instance()->value("downloadDirectory",
+          QStandardPaths::writableLocation(QStandardPaths::DownloadLocation)).toString())
+{
+    const QVariantList rules = Settings::instance()->value("downloadRules").toList();
+    for (const QVariant& item : rules) {
+        const QVariantMap map = item.toMap();
+        const Rule rule{map.value("pattern").toString(), map.value("directory").toString()};
+        if (!rule.pattern.isEmpty() && !rule.directory.isEmpty()) m_rules.append(rule);
+    }
+
+    m_clock.start();
+    m_timer.setInterval(PROGRESS_INTERVAL_MS);
+    connect(&m_timer, &QTimer::timeout, this, &DownloadManager::tick);
+    connect(ContainerManager::instance(), &ContainerManager::downloadRequested,
+            this, &DownloadManager::onRequested);
+}
+
+qint64 DownloadManager::Entry::secondsLeft() const
+{
+    if (state != Downloading || totalBytes <= 0 || bytesPerSecond < 1) return -1;
+    return qint64((totalBytes - receivedBytes) / bytesPerSecond);
+}
+
+QVector<DownloadManager::Entry> DownloadManager::entries() const
+{
+    QVector<Entry> list;
+    list.reserve(m_jobs.size());
+    for (const Job& job : m_jobs) list.append(job.entry);
+    return list;
+}
+
+DownloadManager::Entry DownloadManager::entry(int id) const
+{
+    const Job* job = find(id);
+    return job ? job->entry : Entry();
+}
+
+DownloadManager::Stats DownloadManager::stats() const
+{
+    Stats stats;
+    for (const Job& job : m_jobs) {
+        switch (job.entry.state) {
+        case Downloading:
+            ++stats.downloading;
+            stats.bytesPerSecond += job.entry.bytesPerSecond;
+            break;
+        case Queued: ++stats.queued; break;
+        case Paused: ++stats.paused; break;
+        case Completed: ++stats.completed; break;
+        case Failed: ++stats.failed; break;
+        case Cancelled: break;
+        }
+    }
+    return stats;
+}
+
+void DownloadManager::onRequested(QWebEngineDownloadItem* item)
+{
+    const int retried = m_retries.take(item->url());
+    Job* job = retried ? find(retried) : nullptr;
+    const bool isNew = !job;
+    if (isNew) {
+        Job created;
+        created.entry.id = m_nextId++;
+        created.entry.url = item->url();
+        m_jobs.append(created);
+        job = &m_jobs.last();
+    }
+    const int id = job->entry.id;
+    job->item = item;
+    // Download items belong to the profile that started them
+    job->profile = qobject_cast<QWebEngineProfile*>(item->parent());
+    job->activeMs = 0;
+    job->entry.mimeType = item->mimeType();
+    job->entry.receivedBytes = 0;
+    job->entry.totalBytes = item->totalBytes();
+    job->entry.bytesPerSecond = 0;
+    job->entry.error.clear();
+
+    const bool requested = item->state() == QWebEngineDownloadItem::DownloadRequested;
+    if (requested) {
+        if (job->entry.path.isEmpty()) {
+            job->entry.path = reserve(directoryFor(item->mimeType(), item->url()), item->downloadFileName());
+        } else {
+            m_reserved.insert(job->entry.path);
+        }
+        const QFileInfo target(job->entry.path);
+        QDir().mkpath(target.absolutePath());
+        item->setDownloadDirectory(target.absolutePath());
+        item->setDownloadFileName(target.fileName());
+        item->accept();
+    } else {
+        // Already under way, e.g. a page saved with QWebEnginePage::save()
+        job->entry.path = QDir(item->downloadDirectory()).filePath(item->downloadFileName());
+        m_reserved.insert(job->entry.path);
+    }
+    connect(item, &QWebEngineDownloadItem::finished, this, [this, id]() { onFinished(id); });
+    connect(item, &QObject::destroyed, this, [this, id]() { onLost(id); });
+
+    if (!requested || m_running < m_maxConcurrent) {
+        start(*job);
+    } else {
+        setState(*job, Queued);
+        // Chromium only creates the transfer once this handler has returned
+        QMetaObject::invokeMethod(this, [this, id]() {
+            Job* queued = find(id);
+            if (queued && queued->entry.state != Downloading && queued->item) queued->item->pause();
+        }, Qt::QueuedConnection);
+    }
+
+    if (isNew) {
+        emit added(id);
+    } else {
+        emit stateChanged(id);
+    }
+}
+
+void DownloadManager::onFinished(int id)
+{
+    Job* job = find(id);
+    if (!job || !job->item) return;
+    QWebEngineDownloadItem* item = job->item;
+    job->entry.receivedBytes = item->receivedBytes();
+    job->entry.totalBytes = item->totalBytes();
+    m_reserved.remove(job->entry.path);
+
+    switch (item->state()) {
+    case QWebEngineDownloadItem::DownloadCompleted:
+        setState(*job, Completed);
+        job->entry.bytesPerSecond = job->activeMs > 0 ? job->entry.receivedBytes * 1000.0 / job->activeMs : 0;
+        break;
+    case QWebEngineDownloadItem::DownloadInterrupted:
+        setState(*job, Failed);
+        job->entry.error = item->interruptReasonString();
+        break;
+    default:
+        setState(*job, Cancelled);
+        break;
+    }
+    QWebEngineProfile* profile = job->profile;
+    emit stateChanged(id);
+    if (profile && !isBusy(profile)) emit profileIdle(profile);
+    pump();
+}
+
+void DownloadManager::onLost(int id)
+{
+    Job* job = find(id);
+    // Finished items go with their profile too, and a retried entry's old
+    // item is no loss while the new one lives
+    if (!job || job->item || job->entry.isFinished()) return;
+    m_reserved.remove(job->entry.path);
+    setState(*job, Failed);
+    job->entry.error = tr("Closed with its window");
+    emit stateChanged(id);
+    pump();
+}
+
+void DownloadManager::pump()
+{
+    QVector<int> started;
+    for (Job& job : m_jobs) {
+        if (m_running >= m_maxConcurrent) break;
+        // A retried entry waits here for its new item
+        if (job.entry.state != Queued || !job.item || job.item->isFinished()) continue;
+        start(job);
+        started.append(job.entry.id);
+    }
+    for (int id : qAsConst(started)) emit stateChanged(id);
+}
+
+void DownloadManager::start(Job& job)
+{
+    job.sampledBytes = job.item->receivedBytes();
+    job.sampledMs = m_clock.elapsed();
+    if (job.item->isPaused()) job.item->resume();
+    setState(job, Downloading);
+}
+
+void DownloadManager::tick()
+{
+    const qint64 now = m_clock.elapsed();
+    QVector<int> moved;
+    for (Job& job : m_jobs) {
+        if (job.entry.state != Downloading || !job.item || now <= job.sampledMs) continue;
+        // A pause that reached Chromium after a quick resume
+        if (job.item->isPaused()) job.item->resume();
+        Entry& entry = job.entry;
+        const qint64 received = job.item->receivedBytes();
+        const double rate = (received - job.sampledBytes) * 1000.0 / (now - job.sampledMs);
+        double smoothed = entry.bytesPerSecond > 0 ? entry.bytesPerSecond + RATE_SMOOTHING * (rate - entry.bytesPerSecond) : rate;
+        if (smoothed < 1) smoothed = 0;
+        job.sampledBytes = received;
+        job.sampledMs = now;
+
+        // A stalled download still moves while its rate decays
+        if (received == entry.receivedBytes && smoothed == entry.bytesPerSecond) continue;
+        entry.receivedBytes = received;
+        entry.totalBytes = job.item->totalBytes();
+        entry.bytesPerSecond = smoothed;
+        moved.append(entry.id);
+    }
+    if (!moved.isEmpty()) emit progressChanged(moved);
+}
+
+void DownloadManager::setState(Job& job, State state)
+{
+    const qint64 now = m_clock.elapsed();
+    if (job.entry.state == Downloading) {
+        --m_running;
+        job.activeMs += now - job.runningSinceMs;
+    }
+    if (state == Downloading) {
+        ++m_running;
+        job.runningSinceMs = now;
+    } else {
+        job.entry.bytesPerSecond = 0;
+    }
+    job.entry.state = state;
+
+    if (m_running > 0 && !m_timer.isActive()) {
+        m_timer.start();
+    } else if (m_running == 0) {
+        m_timer.stop();
+    }
+}
+
+void DownloadManager::pause(int id)
+{
+    Job* job = find(id);
+    if (!job || (job->entry.state != Downloading && job->entry.state != Queued)) return;
+    // A queued download is paused already
+    if (job->entry.state == Downloading && job->item) job->item->pause();
+    setState(*job, Paused);
+    emit stateChanged(id);
+    pump();
+}
+
+void DownloadManager::resume(int id)
+{
+    Job* job = find(id);
+    if (!job || job->entry.state != Paused) return;
+    setState(*job, Queued);
+    emit stateChanged(id);
+    pump();
+}
+
+void DownloadManager::retry(int id)
+{
+    Job* job = find(id);
+    if (!job || (job->entry.state != Failed && job->entry.state != Cancelled) || !job->profile) return;
+
+    QWebEngineProfile* profile = job->profile;
+    QWebEnginePage* page = profile->findChild<QWebEnginePage*>(RETRY_PAGE, Qt::FindDirectChildrenOnly);
+    if (!page) {
+        // download() is ignored by a page that has never loaded anything
+        page = new QWebEnginePage(profile, profile);
+        page->setObjectName(RETRY_PAGE);
+        page->setUrl(QUrl(QStringLiteral("about:blank")));
+    }
+    m_retries.insert(job->entry.url, id);
+    job->entry.error.clear();
+    setState(*job, Queued);
+    const QUrl url = job->entry.url;
+    const QString fileName = QFileInfo(job->entry.path).fileName();
+    emit stateChanged(id);
+    page->download(url, fileName);
+}
+
+void DownloadManager::cancel(int id)
+{
+    Job* job = find(id);
+    // The rest happens in onFinished()
+    if (job && job->item && !job->item->isFinished()) job->item->cancel();
+}
+
+void DownloadManager::clearFinished()
+{
+    m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(),
+                                [](const Job& job) { return job.entry.isFinished(); }),
+                 m_jobs.end());
+    emit finishedCleared();
+}
+
+void DownloadManager::setMaxConcurrent(int count)
+{
+    m_maxConcurrent = qMax(1, count);
+    Settings::instance()->setValue("maxConcurrentDownloads", m_maxConcurrent);
+    pump();
+}
+
+void DownloadManager::setDefaultDirectory(const QString& directory)
+{
+    if (directory.isEmpty()) return;
+    m_defaultDirectory = directory;
+    Settings::instance()->setValue("downloadDirectory", directory);
+}
+
+void DownloadManager::setRules(const QVector<Rule>& rules)
+{
+    m_rules.clear();
+    QVariantList list;
+    for (const Rule& rule : rules) {
+        if (rule.pattern.isEmpty() || rule.directory.isEmpty()) continue;
+        m_rules.append(rule);
+        QVariantMap map;
+        map.insert("pattern", rule.pattern);
+        map.insert("directory", rule.directory);
+        list.append(map);
+    }
+    Settings::instance()->setValue("downloadRules", list);
+}
+
+QString DownloadManager::directoryFor(const QString& mimeType, const QUrl& url) const
+{
+    const QString host = url.host();
+    for (const Rule& rule : m_rules) {
+        if (matches(rule, mimeType, host)) return expandHome(rule.directory);
+    }
+    return expandHome(m_defaultDirectory);
+}
+
+bool DownloadManager::isBusy(const QWebEngineProfile* profile) const
+{
+    for (const Job& job : m_jobs) {
+        if (job.profile == profile && job.item && !job.item->isFinished()) return true;
+    }
+    return false;
+}
+
+DownloadManager::Job* DownloadManager::find(int id)
+{
+    // Ids only grow, and clearing keeps the order
+    auto it = std::lower_bound(m_jobs.begin(), m_jobs.end(), id,
+                               [](const Job& job, int value) { return job.entry.id < value; });
+    return it != m_jobs.end() && it->entry.id == id ? &*it : nullptr;
+}
+
+const DownloadManager::Job* DownloadManager::find(int id) const
+{
+    auto it = std::lower_bound(m_jobs.cbegin(), m_jobs.cend(), id,
+                               [](const Job& job, int value) { return job.entry.id < value; });
+    return it != m_jobs.cend() && it->entry.id == id ? &*it : nullptr;
+}
+
+QString DownloadManager::reserve(const QString& directory, const QString& fileName)
+{
+    const QFileInfo name(fileName.isEmpty() ? QStringLiteral("download") : fileName);
+    const QString suffix = name.suffix().isEmpty() ? QString() : '.' + name.suffix();
+    const QDir dir(directory);
+    QString path = dir.filePath(name.fileName());
+    for (int n = 1; m_reserved.contains(path) || QFileInfo::exists(path); ++n) {
+        path = dir.filePath(QStringLiteral("%1 (%2)%3").arg(name.completeBaseName(), QString::number(n), suffix));
+    }
+    m_reserved.insert(path);
+    return path;
+}
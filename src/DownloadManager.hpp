@@ -0,0 +1,157 @@
+/**
+ * DownloadManager - One download queue for the whole browser
+ *
+ * Every profile's downloads reach it once, through ContainerManager,
+ * whichever window started them. Nothing prompts: a download is saved to
+ * the folder of the first matching rule, a MIME type ("application/pdf",
+ * "image/*") or a host together with its subdomains, or else the default
+ * download folder. A name that is already taken gets " (n)" appended.
+ *
+ * At most maxConcurrent() downloads transfer at once. The others are
+ * accepted and immediately paused, then resumed in arrival order as slots
+ * free up. Qt requires accepting a download from within its request
+ * signal, so a queued download has already opened its connection and
+ * holds it while paused. The limit caps bandwidth, not connections, and a
+ * server that drops idle connections makes the download restart or fail
+ * when its turn comes (Retry starts it again).
+ *
+ * Progress does not come from downloadProgress. A single timer reads the
+ * byte counts of every running download, updates its smoothed rate and
+ * emits one progressChanged for all of them. Hundreds of downloads
+ * therefore cost one UI update per tick.
+ */
+
+#ifndef DOWNLOADMANAGER_HPP
+#define DOWNLOADMANAGER_HPP
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+class QWebEngineDownloadItem;
+class QWebEngineProfile;
+
+class DownloadManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DownloadManager* instance();
+
+    enum State { Queued, Downloading, Paused, Completed, Failed, Cancelled };
+
+    struct Entry
+    {
+        int id = 0;
+        QUrl url;
+        QString path;
+        QString mimeType;
+        State state = Queued;
+        qint64 receivedBytes = 0;
+        qint64 totalBytes = -1;     // -1 if the server didn't say
+        double bytesPerSecond = 0;  // smoothed while running, the average once completed
+        QString error;
+
+        bool isFinished() const { return state == Completed || state == Failed || state == Cancelled; }
+        // -1 while the size or the rate is unknown
+        qint64 secondsLeft() const;
+    };
+
+    struct Rule
+    {
+        QString pattern;    // contains '/' for a MIME type, else a host
+        QString directory;  // a leading ~ is the home directory
+    };
+
+    struct Stats
+    {
+        int downloading = 0;
+        int queued = 0;
+        int paused = 0;
+        int completed = 0;
+        int failed = 0;
+        double bytesPerSecond = 0;
+    };
+
+    // In arrival order
+    QVector<Entry> entries() const;
+    // An entry with id 0 if there is none
+    Entry entry(int id) const;
+    Stats stats() const;
+
+    void pause(int id);
+    // Back in the queue; starts at once if a slot is free
+    void resume(int id);
+    // Downloads a failed or cancelled entry again, to the same file; not
+    // possible once its off-the-record profile is gone
+    void retry(int id);
+    void cancel(int id);
+    void clearFinished();
+
+    int maxConcurrent() const { return m_maxConcurrent; }
+    // Lowering it lets running downloads finish rather than pausing them
+    void setMaxConcurrent(int count);
+    QString defaultDirectory() const { return m_defaultDirectory; }
+    void setDefaultDirectory(const QString& directory);
+    QVector<Rule> rules() const { return m_rules; }
+    void setRules(const QVector<Rule>& rules);
+    QString directoryFor(const QString& mimeType, const QUrl& url) const;
+    // Whether profile has downloads that would die with it
+    bool isBusy(const QWebEngineProfile* profile) const;
+
+signals:
+    void added(int id);
+    void stateChanged(int id);
+    // Coalesced: once per tick, for the running downloads that moved
+    void progressChanged(const QVector<int>& ids);
+    void finishedCleared();
+    // The last unfinished download of profile has ended
+    void profileIdle(QWebEngineProfile* profile);
+
+private:
+    explicit DownloadManager(QObject* parent = nullptr);
+
+    struct Job
+    {
+        Entry entry;
+        QPointer<QWebEngineDownloadItem> item;
+        QPointer<QWebEngineProfile> profile;
+        qint64 activeMs = 0;        // time spent Downloading, for the average rate
+        qint64 runningSinceMs = 0;
+        qint64 sampledBytes = 0;
+        qint64 sampledMs = 0;
+    };
+
+    void onRequested(QWebEngineDownloadItem* item);
+    void onFinished(int id);
+    // The item was deleted without finishing, with its profile
+    void onLost(int id);
+    // Starts queued downloads while slots are free
+    void pump();
+    void start(Job& job);
+    void tick();
+    void setState(Job& job, State state);
+    Job* find(int id);
+    const Job* find(int id) const;
+    QString reserve(const QString& directory, const QString& fileName);
+
+    QVector<Job> m_jobs;
+    // Retried URLs waiting for their new download item, to the entry id
+    QHash<QUrl, int> m_retries;
+    // Target paths of unfinished downloads, which may not exist on disk yet
+    QSet<QString> m_reserved;
+    int m_nextId = 1;
+    int m_running = 0;
+    int m_maxConcurrent;
+    QString m_defaultDirectory;
+    QVector<Rule> m_rules;
+    QElapsedTimer m_clock;
+    QTimer m_timer;
+};
+
+#endif // DOWNLOADMANAGER_HPP
@@ -0,0 +1,270 @@
+/**
+ * DownloadsWindow implementation
+ */
+
+#include "DownloadsWindow.hpp"
+#include "DownloadManager.hpp"
+#include <QDesktopServices>
+#include <QFileInfo>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QTreeWidget>
+#include <QUrl>
+#include <QVBoxLayout>
+
+namespace {
+
+enum Column { ColFile, ColSize, ColSpeed, ColTimeLeft, ColStatus, ColumnCount };
+
+QString formatSeconds(qint64 seconds)
+{
+    if (seconds < 0) return QString();
+    if (seconds >= 3600) return DownloadsWindow::tr("%1 h %2 min").arg(seconds / 3600).arg(seconds % 3600 / 60);
+    if (seconds >= 60) return DownloadsWindow::tr("%1 min %2 s").arg(seconds / 60).arg(seconds % 60);
+    return DownloadsWindow::tr("%1 s").arg(seconds);
+}
+
+QString formatRate(double bytesPerSecond)
+{
+    return DownloadsWindow::tr("%1/s").arg(QLocale().formattedDataSize(qint64(bytesPerSecond)));
+}
+
+} // namespace
+
+DownloadsWindow::DownloadsWindow(QWidget* parent)
+    : QWidget(parent, Qt::Window)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(tr("Downloads"));
+    resize(760, 420);
+
+    DownloadManager* downloads = DownloadManager::instance();
+    QVBoxLayout* layout = new QVBoxLayout(this);
+
+    m_table = new QTreeWidget(this);
+    m_table->setColumnCount(ColumnCount);
+    m_table->setHeaderLabels({tr("File"), tr("Size"), tr("Speed"), tr("Time Left"), tr("Status")});
+    m_table->setRootIsDecorated(false);
+    m_table->setUniformRowHeights(true);
+    m_table->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_table->header()->setSectionResizeMode(ColFile, QHeaderView::Stretch);
+    m_table->header()->setStretchLastSection(false);
+    for (int column = ColSize; column < ColumnCount; ++column) {
+        m_table->header()->setSectionResizeMode(column, QHeaderView::ResizeToContents);
+    }
+    layout->addWidget(m_table);
+
+    QHBoxLayout* statusLayout = new QHBoxLayout;
+    m_summary = new QLabel(this);
+    m_limitSpin = new QSpinBox(this);
+    m_limitSpin->setRange(1, 20);
+    m_limitSpin->setValue(downloads->maxConcurrent());
+    m_limitSpin->setToolTip(tr("Further downloads wait, paused, until one finishes. They are already connected "
+                               "to their server, and one that drops idle connections may make them restart."));
+    statusLayout->addWidget(m_summary, 1);
+    statusLayout->addWidget(new QLabel(tr("Download at most:"), this));
+    statusLayout->addWidget(m_limitSpin);
+    statusLayout->addWidget(new QLabel(tr("at once"), this));
+    layout->addLayout(statusLayout);
+
+    QHBoxLayout* buttons = new QHBoxLayout;
+    m_pauseBtn = new QPushButton(tr("&Pause"), this);
+    m_resumeBtn = new QPushButton(tr("&Resume"), this);
+    m_retryBtn = new QPushButton(tr("Re&try"), this);
+    m_cancelBtn = new QPushButton(tr("&Cancel"), this);
+    m_folderBtn = new QPushButton(tr("Open &Folder"), this);
+    QPushButton* clearBtn = new QPushButton(tr("Clear &Finished"), this);
+    QPushButton* closeBtn = new QPushButton(tr("C&lose"), this);
+    buttons->addWidget(m_pauseBtn);
+    buttons->addWidget(m_resumeBtn);
+    buttons->addWidget(m_retryBtn);
+    buttons->addWidget(m_cancelBtn);
+    buttons->addWidget(m_folderBtn);
+    buttons->addStretch();
+    buttons->addWidget(clearBtn);
+    buttons->addWidget(closeBtn);
+    layout->addLayout(buttons);
+
+    // Nothing is drawn while hidden; showEvent() catches up in one pass
+    connect(downloads, &DownloadManager::added, this, [this](int id) {
+        if (!isVisible()) return;
+        addRow(id);
+        updateSummary();
+    });
+    connect(downloads, &DownloadManager::stateChanged, this, [this](int id) {
+        if (!isVisible()) return;
+        if (!m_items.contains(id)) addRow(id);
+        updateRows({id});
+        updateButtons();
+    });
+    connect(downloads, &DownloadManager::progressChanged, this, [this](const QVector<int>& ids) {
+        if (isVisible()) updateRows(ids);
+    });
+    connect(downloads, &DownloadManager::finishedCleared, this, [this]() {
+        if (isVisible()) rebuild();
+    });
+
+    connect(m_table, &QTreeWidget::itemSelectionChanged, this, &DownloadsWindow::updateButtons);
+    connect(m_table, &QTreeWidget::itemActivated, this, &DownloadsWindow::onActivated);
+    connect(m_limitSpin, QOverload<int>::of(&QSpinBox::valueChanged), downloads, &DownloadManager::setMaxConcurrent);
+    connect(m_pauseBtn, &QPushButton::clicked, this, &DownloadsWindow::onPause);
+    connect(m_resumeBtn, &QPushButton::clicked, this, &DownloadsWindow::onResume);
+    connect(m_retryBtn, &QPushButton::clicked, this, &DownloadsWindow::onRetry);
+    connect(m_cancelBtn, &QPushButton::clicked, this, &DownloadsWindow::onCancel);
+    connect(m_folderBtn, &QPushButton::clicked, this, &DownloadsWindow::onOpenFolder);
+    connect(clearBtn, &QPushButton::clicked, downloads, &DownloadManager::clearFinished);
+    connect(closeBtn, &QPushButton::clicked, this, &QWidget::close);
+}
+
+void DownloadsWindow::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    rebuild();
+}
+
+void DownloadsWindow::rebuild()
+{
+    m_table->clear();
+    m_items.clear();
+    for (const DownloadManager::Entry& entry : DownloadManager::instance()->entries()) {
+        addRow(entry.id);
+    }
+    updateSummary();
+    updateButtons();
+}
+
+void DownloadsWindow::addRow(int id)
+{
+    QTreeWidgetItem* item = new QTreeWidgetItem(m_table);
+    item->setData(ColFile, Qt::UserRole, id);
+    m_items.insert(id, item);
+    updateRow(item);
+}
+
+void DownloadsWindow::updateRows(const QVector<int>& ids)
+{
+    for (int id : ids) {
+        if (QTreeWidgetItem* item = m_items.value(id)) updateRow(item);
+    }
+    updateSummary();
+}
+
+void DownloadsWindow::updateRow(QTreeWidgetItem* item)
+{
+    const DownloadManager::Entry entry = DownloadManager::instance()->entry(item->data(ColFile, Qt::UserRole).toInt());
+    if (entry.id == 0) return;
+    const QLocale locale;
+
+    item->setText(ColFile, QFileInfo(entry.path).fileName());
+    item->setToolTip(ColFile, tr("%1\nfrom %2").arg(entry.path, entry.url.toDisplayString()));
+
+    const QString received = locale.formattedDataSize(entry.receivedBytes);
+    if (entry.state == DownloadManager::Completed || entry.totalBytes <= 0) {
+        item->setText(ColSize, received);
+    } else {
+        item->setText(ColSize, tr("%1 of %2").arg(received, locale.formattedDataSize(entry.totalBytes)));
+    }
+
+    if (entry.state == DownloadManager::Downloading) {
+        item->setText(ColSpeed, formatRate(entry.bytesPerSecond));
+    } else if (entry.state == DownloadManager::Completed && entry.bytesPerSecond > 0) {
+        item->setText(ColSpeed, tr("avg %1").arg(formatRate(entry.bytesPerSecond)));
+    } else {
+        item->setText(ColSpeed, QString());
+    }
+    item->setText(ColTimeLeft, formatSeconds(entry.secondsLeft()));
+
+    QString status;
+    switch (entry.state) {
+    case DownloadManager::Queued: status = tr("Queued"); break;
+    case DownloadManager::Downloading:
+        status = entry.totalBytes > 0 ? tr("%1%").arg(100 * entry.receivedBytes / entry.totalBytes)
+                                      : tr("Downloading");
+        break;
+    case DownloadManager::Paused: status = tr("Paused"); break;
+    case DownloadManager::Completed: status = tr("Done"); break;
+    case DownloadManager::Failed:
+        status = entry.error.isEmpty() ? tr("Failed") : tr("Failed: %1").arg(entry.error);
+        break;
+    case DownloadManager::Cancelled: status = tr("Cancelled"); break;
+    }
+    item->setText(ColStatus, status);
+}
+
+void DownloadsWindow::updateSummary()
+{
+    const DownloadManager::Stats stats = DownloadManager::instance()->stats();
+    QStringList parts;
+    if (stats.downloading > 0) {
+        parts.append(tr("%n downloading at %1", "", stats.downloading).arg(formatRate(stats.bytesPerSecond)));
+    }
+    if (stats.queued > 0) parts.append(tr("%n queued", "", stats.queued));
+    if (stats.paused > 0) parts.append(tr("%n paused", "", stats.paused));
+    if (stats.completed > 0) parts.append(tr("%n done", "", stats.completed));
+    if (stats.failed > 0) parts.append(tr("%n failed", "", stats.failed));
+    m_summary->setText(parts.isEmpty() ? tr("No downloads") : parts.join(QStringLiteral(", ")));
+}
+
+void DownloadsWindow::updateButtons()
+{
+    bool canPause = false, canResume = false, canRetry = false, canCancel = false;
+    DownloadManager* downloads = DownloadManager::instance();
+    const QVector<int> ids = selectedIds();
+    for (int id : ids) {
+        const DownloadManager::Entry entry = downloads->entry(id);
+        canPause |= entry.state == DownloadManager::Downloading || entry.state == DownloadManager::Queued;
+        canResume |= entry.state == DownloadManager::Paused;
+        canRetry |= entry.state == DownloadManager::Failed || entry.state == DownloadManager::Cancelled;
+        canCancel |= entry.id != 0 && !entry.isFinished();
+    }
+    m_pauseBtn->setEnabled(canPause);
+    m_resumeBtn->setEnabled(canResume);
+    m_retryBtn->setEnabled(canRetry);
+    m_cancelBtn->setEnabled(canCancel);
+    m_folderBtn->setEnabled(ids.size() == 1);
+}
+
+QVector<int> DownloadsWindow::selectedIds() const
+{
+    QVector<int> ids;
+    for (QTreeWidgetItem* item : m_table->selectedItems()) ids.append(item->data(ColFile, Qt::UserRole).toInt());
+    return ids;
+}
+
+void DownloadsWindow::onPause()
+{
+    for (int id : selectedIds()) DownloadManager::instance()->pause(id);
+}
+
+void DownloadsWindow::onResume()
+{
+    for (int id : selectedIds()) DownloadManager::instance()->resume(id);
+}
+
+void DownloadsWindow::onRetry()
+{
+    for (int id : selectedIds()) DownloadManager::instance()->retry(id);
+}
+
+void DownloadsWindow::onCancel()
+{
+    for (int id : selectedIds()) DownloadManager::instance()->cancel(id);
+}
+
+void DownloadsWindow::onOpenFolder()
+{
+    const QVector<int> ids = selectedIds();
+    if (ids.size() != 1) return;
+    const QString path = DownloadManager::instance()->entry(ids.first()).path;
+    QDesktopServices::openUrl(QUrl::fromLocalFile(QFileInfo(path).absolutePath()));
+}
+
+void DownloadsWindow::onActivated(QTreeWidgetItem* item)
+{
+    const DownloadManager::Entry entry = DownloadManager::instance()->entry(item->data(ColFile, Qt::UserRole).toInt());
+    if (entry.state == DownloadManager::Completed) QDesktopServices::openUrl(QUrl::fromLocalFile(entry.path));
+}
@@ -0,0 +1,62 @@
+/**
+ * DownloadsWindow - Progress, rate and time left of every download
+ *
+ * A non-modal window over DownloadManager, listing downloads from all
+ * windows and containers in the order they started. Rows are updated from
+ * the manager's coalesced progressChanged, and only while the window is
+ * shown. Pause, Resume, Retry and Cancel act on every selected row.
+ * Double-clicking a finished download opens it.
+ */
+
+#ifndef DOWNLOADSWINDOW_HPP
+#define DOWNLOADSWINDOW_HPP
+
+#include <QWidget>
+#include <QHash>
+#include <QVector>
+
+class QLabel;
+class QPushButton;
+class QSpinBox;
+class QTreeWidget;
+class QTreeWidgetItem;
+
+class DownloadsWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit DownloadsWindow(QWidget* parent = nullptr);
+
+protected:
+    void showEvent(QShowEvent* event) override;
+
+private slots:
+    void onPause();
+    void onResume();
+    void onRetry();
+    void onCancel();
+    void onOpenFolder();
+    void onActivated(QTreeWidgetItem* item);
+
+private:
+    void rebuild();
+    void addRow(int id);
+    void updateRows(const QVector<int>& ids);
+    void updateRow(QTreeWidgetItem* item);
+    void updateSummary();
+    void updateButtons();
+    QVector<int> selectedIds() const;
+
+    QTreeWidget* m_table;
+    QLabel* m_summary;
+    QSpinBox* m_limitSpin;
+    QPushButton* m_pauseBtn;
+    QPushButton* m_resumeBtn;
+    QPushButton* m_retryBtn;
+    QPushButton* m_cancelBtn;
+    QPushButton* m_folderBtn;
+    QHash<int, QTreeWidgetItem*> m_items;
+};
+
+#endif // DOWNLOADSWINDOW_HPP
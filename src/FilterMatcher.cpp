@@ -0,0 +1,653 @@
+/**
+ * FilterMatcher implementation
+ */
+
+#include "FilterMatcher.hpp"
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char MAGIC[8] = {'A', 'B', 'F', 'L', 'T', 'R', '0', '1'};
+const quint32 FORMAT_VERSION = 1;
+
+// Everything in the blob is native-endian and 4-byte aligned; the header
+// is 8-byte aligned for the stamp
+struct Header
+{
+    char magic[8];
+    quint32 version;
+    quint32 ruleCount;
+    quint64 stamp;
+    quint32 rulesOffset;
+    quint32 domainsOffset;
+    quint32 domainCount;
+    quint32 hostTableOffset;
+    quint32 hostTableSize;      // slots, a power of two
+    quint32 tokenTableOffset;
+    quint32 tokenTableSize;     // slots, a power of two
+    quint32 indexOffset;
+    quint32 indexCount;
+    quint32 untokenizedOffset;
+    quint32 untokenizedCount;
+    quint32 stringsOffset;
+    quint32 stringsSize;
+    quint32 totalSize;
+};
+
+enum RuleFlag : quint32 {
+    Exception = 1 << 0,
+    MatchCase = 1 << 1,
+    AnchorStart = 1 << 2,
+    AnchorEnd = 1 << 3,
+    AnchorDomain = 1 << 4,
+    ThirdParty = 1 << 5,
+    FirstParty = 1 << 6,
+    HostOnly = 1 << 7      // pattern is a bare host, from ||host^
+};
+
+struct Rule
+{
+    quint32 pattern;        // offset into strings
+    quint32 patternLength;
+    quint32 flags;
+    quint32 types;
+    quint32 domains;        // index into the domain refs
+    quint32 domainCount;
+};
+
+struct DomainRef
+{
+    quint32 name;
+    quint32 length;         // high bit set: ~domain
+};
+
+const quint32 NEGATED = 0x80000000u;
+
+struct HostSlot
+{
+    quint32 hash;
+    quint32 rule;           // rule index + 1; 0 marks an empty slot
+};
+
+struct TokenSlot
+{
+    quint32 hash;
+    quint32 start;          // into the rule index array
+    quint32 count;          // 0 marks an empty slot
+};
+
+struct ParsedRule
+{
+    QByteArray pattern;
+    quint32 flags = 0;
+    quint32 types = FilterMatcher::AllTypes;
+    QList<QPair<QByteArray, bool>> domains;     // name, negated
+};
+
+quint32 fnv1a(const char* s, int n)
+{
+    quint32 h = 2166136261u;
+    for (int i = 0; i < n; ++i) {
+        h ^= uchar(s[i]);
+        h *= 16777619u;
+    }
+    // 0 means "empty" in neither table, but keep hashes away from it anyway
+    return h ? h : 1;
+}
+
+quint32 tokenHash(const char* s, int n)
+{
+    quint32 h = 2166136261u;
+    for (int i = 0; i < n; ++i) {
+        const char c = s[i];
+        h ^= uchar(c >= 'A' && c <= 'Z' ? c + 32 : c);
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+bool isTokenChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '%';
+}
+
+// What ^ stands for: anything but a letter, digit or one of _-.%
+bool isSeparator(char c)
+{
+    return !(isTokenChar(c) || c == '_' || c == '-' || c == '.');
+}
+
+bool isHostChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '.' || c == '-';
+}
+
+quint32 tableSize(int entries)
+{
+    quint32 size = 16;
+    while (size < quint32(entries) * 2) size <<= 1;
+    return size;
+}
+
+quint32 typeFromName(const QByteArray& name)
+{
+    if (name == "script") return FilterMatcher::Script;
+    if (name == "image") return FilterMatcher::Image;
+    if (name == "stylesheet") return FilterMatcher::Stylesheet;
+    if (name == "object") return FilterMatcher::Object;
+    if (name == "xmlhttprequest") return FilterMatcher::XmlHttpRequest;
+    if (name == "subdocument") return FilterMatcher::Subdocument;
+    if (name == "media") return FilterMatcher::Media;
+    if (name == "font") return FilterMatcher::Font;
+    if (name == "ping") return FilterMatcher::Ping;
+    if (name == "websocket") return FilterMatcher::WebSocket;
+    if (name == "other") return FilterMatcher::Other;
+    return 0;
+}
+
+// False for anything this matcher can't honour; such rules are dropped
+// rather than applied more broadly than written
+bool parseOptions(const QByteArray& options, ParsedRule& rule)
+{
+    quint32 included = 0;
+    quint32 excluded = 0;
+    for (const QByteArray& raw : options.split(',')) {
+        const QByteArray option = raw.trimmed().toLower();
+        if (option == "third-party" || option == "3p") {
+            rule.flags |= ThirdParty;
+        } else if (option == "~third-party" || option == "first-party" || option == "1p") {
+            rule.flags |= FirstParty;
+        } else if (option == "match-case") {
+            rule.flags |= MatchCase;
+        } else if (option == "important") {
+            // No priorities here; treated as an ordinary rule
+        } else if (option.startsWith("domain=")) {
+            for (const QByteArray& d : option.mid(7).split('|')) {
+                const bool negated = d.startsWith('~');
+                const QByteArray name = negated ? d.mid(1) : d;
+                if (!name.isEmpty()) rule.domains.append({name, negated});
+            }
+        } else if (const quint32 type = typeFromName(option.startsWith('~') ? option.mid(1) : option)) {
+            if (option.startsWith('~')) excluded |= type;
+            else included |= type;
+        } else {
+            return false;
+        }
+    }
+    if (included) rule.types = included;
+    rule.types &= ~excluded;
+    return rule.types != 0;
+}
+
+bool parseLine(QByteArray line, ParsedRule& rule)
+{
+    line = line.trimmed();
+    if (line.isEmpty() || line.startsWith('!') || line.startsWith('[')) return false;
+    if (line.contains("##") || line.contains("#@#") || line.contains("#?#") || line.contains("#$#")) return false;
+
+    if (line.startsWith("@@")) {
+        rule.flags |= Exception;
+        line.remove(0, 2);
+    }
+    const int dollar = line.lastIndexOf('$');
+    if (dollar >= 0) {
+        if (!parseOptions(line.mid(dollar + 1), rule)) return false;
+        line.truncate(dollar);
+    }
+    if (line.size() > 2 && line.startsWith('/') && line.endsWith('/')) return false;
+
+    if (line.startsWith("||")) {
+        rule.flags |= AnchorDomain;
+        line.remove(0, 2);
+    } else if (line.startsWith('|')) {
+        rule.flags |= AnchorStart;
+        line.remove(0, 1);
+    }
+    if (line.endsWith('|')) {
+        rule.flags |= AnchorEnd;
+        line.chop(1);
+    }
+    // Leading and trailing wildcards only undo anchors
+    while (line.startsWith('*')) {
+        line.remove(0, 1);
+        rule.flags &= ~(AnchorStart | AnchorDomain);
+    }
+    while (line.endsWith('*')) {
+        line.chop(1);
+        rule.flags &= ~AnchorEnd;
+    }
+    if (line.isEmpty() && rule.domains.isEmpty()) return false;
+    if (!(rule.flags & MatchCase)) line = line.toLower();
+
+    if (rule.flags & AnchorDomain) {
+        const QByteArray host = line.endsWith('^') ? line.left(line.size() - 1) : line;
+        const bool bareHost = line.endsWith('^') && !host.isEmpty()
+            && std::all_of(host.cbegin(), host.cend(), isHostChar);
+        if (bareHost) {
+            rule.flags |= HostOnly;
+            line = host.toLower();
+        }
+    }
+    rule.pattern = line;
+    return true;
+}
+
+// Longest literal run that must appear in the URL as a whole token
+QByteArray pickToken(const ParsedRule& rule)
+{
+    static const QSet<QByteArray> common = {"http", "https", "www", "com", "js", "html"};
+    const QByteArray& p = rule.pattern;
+    QByteArray best;
+    int i = 0;
+    while (i < p.size()) {
+        if (!isTokenChar(p.at(i))) {
+            ++i;
+            continue;
+        }
+        const int start = i;
+        while (i < p.size() && isTokenChar(p.at(i))) ++i;
+        const bool startBounded = start > 0 ? p.at(start - 1) != '*'
+                                            : (rule.flags & (AnchorStart | AnchorDomain)) != 0;
+        const bool endBounded = i < p.size() ? p.at(i) != '*' : (rule.flags & AnchorEnd) != 0;
+        if (!startBounded || !endBounded) continue;
+        const QByteArray token = p.mid(start, i - start).toLower();
+        if (common.contains(token) && !best.isEmpty()) continue;
+        if (best.isEmpty() || common.contains(best) || token.size() > best.size()) best = token;
+    }
+    return best;
+}
+
+// Whether pattern matches text starting exactly at from
+bool matchAt(const char* p, int pn, const char* s, int sn, int from, bool anchorEnd)
+{
+    int pi = 0;
+    int si = from;
+    int starP = -1;
+    int starS = -1;
+    while (si <= sn) {
+        if (pi < pn) {
+            const char c = p[pi];
+            if (c == '*') {
+                starP = ++pi;
+                starS = si;
+                continue;
+            }
+            if (c == '^') {
+                if (si == sn) {
+                    ++pi;
+                    continue;
+                }
+                if (isSeparator(s[si])) {
+                    ++pi;
+                    ++si;
+                    continue;
+                }
+            } else if (si < sn && c == s[si]) {
+                ++pi;
+                ++si;
+                continue;
+            }
+        } else if (!anchorEnd || si == sn) {
+            return true;
+        }
+        if (starP < 0) return false;
+        pi = starP;
+        si = ++starS;
+    }
+    return false;
+}
+
+bool hostMatchesDomain(const QByteArray& host, const char* domain, int length)
+{
+    if (host.size() == length) return std::memcmp(host.constData(), domain, length) == 0;
+    return host.size() > length && host.at(host.size() - length - 1) == '.'
+        && std::memcmp(host.constData() + host.size() - length, domain, length) == 0;
+}
+
+template<typename T>
+const T* at(const uchar* data, quint32 offset)
+{
+    return reinterpret_cast<const T*>(data + offset);
+}
+
+} // namespace
+
+FilterMatcher::Request FilterMatcher::makeRequest(const QUrl& url, const QUrl& firstParty, quint32 type)
+{
+    Request r;
+    r.caseSensitiveUrl = url.toEncoded();
+    r.url = r.caseSensitiveUrl.toLower();
+    r.host = url.host().toLower().toUtf8();
+    r.hostStart = qMax(0, r.url.indexOf(r.host, qMax(0, r.url.indexOf("://") + 3)));
+    r.firstPartyHost = firstParty.host().toLower().toUtf8();
+    r.thirdParty = !r.firstPartyHost.isEmpty()
+        && registrableDomain(url.host()) != registrableDomain(firstParty.host());
+    r.type = type;
+    return r;
+}
+
+QString FilterMatcher::registrableDomain(const QString& host)
+{
+    // QUrl's public suffix lookup is the only one Qt 5 exposes
+QT_WARNING_PUSH
+QT_WARNING_DISABLE_DEPRECATED
+    const QString suffix = QUrl(QStringLiteral("http://") + host).topLevelDomain();
+QT_WARNING_POP
+    if (suffix.isEmpty() || suffix.size() >= host.size()) return host.toLower();
+    const int dot = host.lastIndexOf('.', host.size() - suffix.size() - 1);
+    return host.mid(dot + 1).toLower();
+}
+
+QByteArray FilterMatcher::compile(const QList<QByteArray>& lists, quint64 stamp, int* ruleCount)
+{
+    QVector<ParsedRule> rules;
+    QSet<QByteArray> seen;
+    for (const QByteArray& list : lists) {
+        for (const QByteArray& line : list.split('\n')) {
+            ParsedRule rule;
+            if (!parseLine(line, rule)) continue;
+            // The same rule often appears in several lists
+            const QByteArray key = line.trimmed();
+            if (seen.contains(key)) continue;
+            seen.insert(key);
+            rules.append(rule);
+        }
+    }
+    if (ruleCount) *ruleCount = rules.size();
+
+    QByteArray strings;
+    QHash<QByteArray, quint32> stringOffsets;
+    auto intern = [&](const QByteArray& s) -> quint32 {
+        auto it = stringOffsets.constFind(s);
+        if (it != stringOffsets.constEnd()) return *it;
+        const quint32 offset = strings.size();
+        strings.append(s);
+        stringOffsets.insert(s, offset);
+        return offset;
+    };
+
+    QVector<Rule> packed;
+    QVector<DomainRef> domains;
+    QVector<quint32> untokenized;
+    QHash<quint32, QVector<quint32>> buckets;
+    int hostRules = 0;
+    packed.reserve(rules.size());
+    for (const ParsedRule& r : qAsConst(rules)) {
+        const quint32 index = packed.size();
+        Rule rule;
+        rule.pattern = intern(r.pattern);
+        rule.patternLength = r.pattern.size();
+        rule.flags = r.flags;
+        rule.types = r.types;
+        rule.domains = domains.size();
+        rule.domainCount = r.domains.size();
+        for (const auto& d : r.domains) {
+            domains.append({intern(d.first), quint32(d.first.size()) | (d.second ? NEGATED : 0)});
+        }
+        packed.append(rule);
+
+        if (r.flags & HostOnly) {
+            ++hostRules;
+            continue;
+        }
+        const QByteArray token = pickToken(r);
+        if (token.isEmpty()) untokenized.append(index);
+        else buckets[tokenHash(token.constData(), token.size())].append(index);
+    }
+
+    const quint32 hostSize = tableSize(hostRules);
+    QVector<HostSlot> hostTable(hostSize, HostSlot{0, 0});
+    for (int i = 0; i < packed.size(); ++i) {
+        const Rule& rule = packed.at(i);
+        if (!(rule.flags & HostOnly)) continue;
+        const quint32 hash = fnv1a(strings.constData() + rule.pattern, rule.patternLength);
+        quint32 slot = hash & (hostSize - 1);
+        while (hostTable[slot].rule) slot = (slot + 1) & (hostSize - 1);
+        hostTable[slot] = {hash, quint32(i) + 1};
+    }
+
+    const quint32 tokenSize = tableSize(buckets.size());
+    QVector<TokenSlot> tokenTable(tokenSize, TokenSlot{0, 0, 0});
+    QVector<quint32> index;
+    for (auto it = buckets.cbegin(); it != buckets.cend(); ++it) {
+        quint32 slot = it.key() & (tokenSize - 1);
+        while (tokenTable[slot].count) slot = (slot + 1) & (tokenSize - 1);
+        tokenTable[slot] = {it.key(), quint32(index.size()), quint32(it.value().size())};
+        index += it.value();
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.ruleCount = packed.size();
+    header.stamp = stamp;
+    quint32 offset = sizeof(Header);
+    header.rulesOffset = offset;
+    offset += packed.size() * sizeof(Rule);
+    header.domainsOffset = offset;
+    header.domainCount = domains.size();
+    offset += domains.size() * sizeof(DomainRef);
+    header.hostTableOffset = offset;
+    header.hostTableSize = hostSize;
+    offset += hostSize * sizeof(HostSlot);
+    header.tokenTableOffset = offset;
+    header.tokenTableSize = tokenSize;
+    offset += tokenSize * sizeof(TokenSlot);
+    header.indexOffset = offset;
+    header.indexCount = index.size();
+    offset += index.size() * sizeof(quint32);
+    header.untokenizedOffset = offset;
+    header.untokenizedCount = untokenized.size();
+    offset += untokenized.size() * sizeof(quint32);
+    header.stringsOffset = offset;
+    header.stringsSize = strings.size();
+    offset += strings.size();
+    header.totalSize = offset;
+
+    QByteArray out;
+    out.reserve(offset);
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(reinterpret_cast<const char*>(packed.constData()), packed.size() * sizeof(Rule));
+    out.append(reinterpret_cast<const char*>(domains.constData()), domains.size() * sizeof(DomainRef));
+    out.append(reinterpret_cast<const char*>(hostTable.constData()), hostSize * sizeof(HostSlot));
+    out.append(reinterpret_cast<const char*>(tokenTable.constData()), tokenSize * sizeof(TokenSlot));
+    out.append(reinterpret_cast<const char*>(index.constData()), index.size() * sizeof(quint32));
+    out.append(reinterpret_cast<const char*>(untokenized.constData()), untokenized.size() * sizeof(quint32));
+    out.append(strings);
+    return out;
+}
+
+std::unique_ptr<FilterMatcher> FilterMatcher::open(const QString& path, quint64 stamp)
+{
+    std::unique_ptr<FilterMatcher> matcher(new FilterMatcher);
+    matcher->m_file.setFileName(path);
+    if (!matcher->m_file.open(QIODevice::ReadOnly)) return nullptr;
+    matcher->m_size = matcher->m_file.size();
+    if (matcher->m_size < qint64(sizeof(Header))) return nullptr;
+    matcher->m_data = matcher->m_file.map(0, matcher->m_size);
+    if (!matcher->m_data || !matcher->validate(stamp)) return nullptr;
+    return matcher;
+}
+
+FilterMatcher::~FilterMatcher()
+{
+    if (m_data) m_file.unmap(const_cast<uchar*>(m_data));
+}
+
+bool FilterMatcher::validate(quint64 stamp) const
+{
+    const Header* h = at<Header>(m_data, 0);
+    if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->version != FORMAT_VERSION) return false;
+    if (h->stamp != stamp || h->totalSize != m_size) return false;
+
+    // A truncated or foreign file must not send a lookup out of bounds
+    auto fits = [this](quint64 offset, quint64 bytes) { return offset + bytes <= quint64(m_size); };
+    if (!fits(h->rulesOffset, quint64(h->ruleCount) * sizeof(Rule))
+        || !fits(h->domainsOffset, quint64(h->domainCount) * sizeof(DomainRef))
+        || !fits(h->hostTableOffset, quint64(h->hostTableSize) * sizeof(HostSlot))
+        || !fits(h->tokenTableOffset, quint64(h->tokenTableSize) * sizeof(TokenSlot))
+        || !fits(h->indexOffset, quint64(h->indexCount) * sizeof(quint32))
+        || !fits(h->untokenizedOffset, quint64(h->untokenizedCount) * sizeof(quint32))
+        || !fits(h->stringsOffset, h->stringsSize)) {
+        return false;
+    }
+    if (!h->hostTableSize || (h->hostTableSize & (h->hostTableSize - 1))
+        || !h->tokenTableSize || (h->tokenTableSize & (h->tokenTableSize - 1))) {
+        return false;
+    }
+
+    const Rule* rules = at<Rule>(m_data, h->rulesOffset);
+    for (quint32 i = 0; i < h->ruleCount; ++i) {
+        const Rule& r = rules[i];
+        if (quint64(r.pattern) + r.patternLength > h->stringsSize) return false;
+        if (quint64(r.domains) + r.domainCount > h->domainCount) return false;
+    }
+    const DomainRef* domains = at<DomainRef>(m_data, h->domainsOffset);
+    for (quint32 i = 0; i < h->domainCount; ++i) {
+        if (quint64(domains[i].name) + (domains[i].length & ~NEGATED) > h->stringsSize) return false;
+    }
+    const HostSlot* hosts = at<HostSlot>(m_data, h->hostTableOffset);
+    for (quint32 i = 0; i < h->hostTableSize; ++i) {
+        if (hosts[i].rule > h->ruleCount) return false;
+    }
+    const TokenSlot* tokens = at<TokenSlot>(m_data, h->tokenTableOffset);
+    for (quint32 i = 0; i < h->tokenTableSize; ++i) {
+        if (quint64(tokens[i].start) + tokens[i].count > h->indexCount) return false;
+    }
+    const quint32* index = at<quint32>(m_data, h->indexOffset);
+    for (quint32 i = 0; i < h->indexCount; ++i) {
+        if (index[i] >= h->ruleCount) return false;
+    }
+    const quint32* untokenized = at<quint32>(m_data, h->untokenizedOffset);
+    for (quint32 i = 0; i < h->untokenizedCount; ++i) {
+        if (untokenized[i] >= h->ruleCount) return false;
+    }
+    return true;
+}
+
+int FilterMatcher::ruleCount() const
+{
+    return at<Header>(m_data, 0)->ruleCount;
+}
+
+bool FilterMatcher::shouldBlock(const Request& request) const
+{
+    return findRule(request, false) >= 0 && findRule(request, true) < 0;
+}
+
+int FilterMatcher::findRule(const Request& request, bool exception) const
+{
+    const Header* h = at<Header>(m_data, 0);
+    const Rule* rules = at<Rule>(m_data, h->rulesOffset);
+    const char* strings = reinterpret_cast<const char*>(m_data + h->stringsOffset);
+
+    // Host rules: one probe per suffix of the host, a.b.c -> a.b.c, b.c, c
+    const HostSlot* hosts = at<HostSlot>(m_data, h->hostTableOffset);
+    const quint32 hostMask = h->hostTableSize - 1;
+    for (int start = 0; start < request.host.size();) {
+        const char* suffix = request.host.constData() + start;
+        const int length = request.host.size() - start;
+        const quint32 hash = fnv1a(suffix, length);
+        for (quint32 slot = hash & hostMask; hosts[slot].rule; slot = (slot + 1) & hostMask) {
+            if (hosts[slot].hash != hash) continue;
+            const quint32 index = hosts[slot].rule - 1;
+            const Rule& rule = rules[index];
+            if (int(rule.patternLength) == length && std::memcmp(strings + rule.pattern, suffix, length) == 0
+                && ruleApplies(index, request, exception)) {
+                return index;
+            }
+        }
+        const int dot = request.host.indexOf('.', start);
+        if (dot < 0) break;
+        start = dot + 1;
+    }
+
+    // Token buckets for each token of the URL
+    const TokenSlot* tokens = at<TokenSlot>(m_data, h->tokenTableOffset);
+    const quint32* index = at<quint32>(m_data, h->indexOffset);
+    const quint32 tokenMask = h->tokenTableSize - 1;
+    const char* url = request.url.constData();
+    const int n = request.url.size();
+    for (int i = 0; i < n;) {
+        if (!isTokenChar(url[i])) {
+            ++i;
+            continue;
+        }
+        const int start = i;
+        while (i < n && isTokenChar(url[i])) ++i;
+        const quint32 hash = tokenHash(url + start, i - start);
+        for (quint32 slot = hash & tokenMask; tokens[slot].count; slot = (slot + 1) & tokenMask) {
+            if (tokens[slot].hash != hash) continue;
+            for (quint32 k = 0; k < tokens[slot].count; ++k) {
+                const quint32 rule = index[tokens[slot].start + k];
+                if (ruleApplies(rule, request, exception)) return rule;
+            }
+        }
+    }
+
+    const quint32* untokenized = at<quint32>(m_data, h->untokenizedOffset);
+    for (quint32 k = 0; k < h->untokenizedCount; ++k) {
+        if (ruleApplies(untokenized[k], request, exception)) return untokenized[k];
+    }
+    return -1;
+}
+
+bool FilterMatcher::ruleApplies(quint32 index, const Request& request, bool exception) const
+{
+    const Header* h = at<Header>(m_data, 0);
+    const Rule& rule = at<Rule>(m_data, h->rulesOffset)[index];
+    if (bool(rule.flags & Exception) != exception) return false;
+    if (!(rule.types & request.type)) return false;
+    if ((rule.flags & ThirdParty) && !request.thirdParty) return false;
+    if ((rule.flags & FirstParty) && request.thirdParty) return false;
+
+    const char* strings = reinterpret_cast<const char*>(m_data + h->stringsOffset);
+    if (rule.domainCount) {
+        const DomainRef* domains = at<DomainRef>(m_data, h->domainsOffset) + rule.domains;
+        bool hasIncluded = false;
+        bool included = false;
+        for (quint32 i = 0; i < rule.domainCount; ++i) {
+            const bool negated = domains[i].length & NEGATED;
+            const int length = domains[i].length & ~NEGATED;
+            const bool matches = hostMatchesDomain(request.firstPartyHost, strings + domains[i].name, length);
+            if (negated && matches) return false;
+            if (!negated) {
+                hasIncluded = true;
+                included = included || matches;
+            }
+        }
+        if (hasIncluded && !included) return false;
+    }
+
+    // Host rules were matched by the table lookup itself
+    if (rule.flags & HostOnly) return true;
+    if (!rule.patternLength) return true;
+
+    const QByteArray& url = (rule.flags & MatchCase) ? request.caseSensitiveUrl : request.url;
+    const char* p = strings + rule.pattern;
+    const int pn = rule.patternLength;
+    const bool anchorEnd = rule.flags & AnchorEnd;
+    if (rule.flags & AnchorStart) return matchAt(p, pn, url.constData(), url.size(), 0, anchorEnd);
+    if (rule.flags & AnchorDomain) {
+        // At the start of the host or of any of its labels
+        const int hostEnd = request.hostStart + request.host.size();
+        for (int i = request.hostStart; i < hostEnd; ++i) {
+            if ((i == request.hostStart || url.at(i - 1) == '.')
+                && matchAt(p, pn, url.constData(), url.size(), i, anchorEnd)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    const char first = p[0];
+    for (int i = 0; i < url.size(); ++i) {
+        // Cheap first-character filter before the full match
+        if (first != '*' && first != '^' && url.at(i) != first) continue;
+        if (matchAt(p, pn, url.constData(), url.size(), i, anchorEnd)) return true;
+    }
+    return false;
+}
@@ -0,0 +1,182 @@
+/**
+ * HistoryModel implementation
+ */
+
+#include "HistoryModel.hpp"
+#include <QDateTime>
+#include <QFont>
+#include <QLocale>
+#include <QtConcurrent>
+
+namespace {
+
+const int FETCH_BATCH = 256;
+
+qint64 dayStartOf(qint64 timestamp)
+{
+    return QDateTime::fromMSecsSinceEpoch(timestamp).date().startOfDay().toMSecsSinceEpoch();
+}
+
+} // namespace
+
+HistoryModel::HistoryModel(HistoryStore* store, QObject* parent)
+    : QAbstractListModel(parent)
+    , m_store(store)
+{
+    // Deletions elsewhere (or from our own window) refresh the view, coalesced
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setInterval(100);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &HistoryModel::refresh);
+    connect(store, &HistoryStore::removed, &m_refreshTimer, QOverload<>::of(&QTimer::start));
+    connect(store, &HistoryStore::removedMany, &m_refreshTimer, QOverload<>::of(&QTimer::start));
+    connect(store, &HistoryStore::cleared, &m_refreshTimer, QOverload<>::of(&QTimer::start));
+    connect(store, &HistoryStore::loaded, &m_refreshTimer, QOverload<>::of(&QTimer::start));
+    connect(store, &HistoryStore::imported, &m_refreshTimer, QOverload<>::of(&QTimer::start));
+
+    connect(&m_watcher, &QFutureWatcher<QVector<int>>::finished, this, [this]() {
+        if (m_watcher.future().isCanceled()) return;
+        m_matches = m_watcher.result();
+        m_filtered = true;
+        resetRows();
+        emit filteringChanged(false);
+    });
+
+    m_snapshot = m_store->snapshot();
+    resetRows();
+}
+
+int HistoryModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+QVariant HistoryModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) return QVariant();
+    const Row& row = m_rows.at(index.row());
+
+    if (row.slot < 0) {
+        switch (role) {
+        case Qt::DisplayRole: {
+            const QDate day = QDateTime::fromMSecsSinceEpoch(row.dayStart).date();
+            const QDate today = QDate::currentDate();
+            if (day == today) return tr("Today");
+            if (day == today.addDays(-1)) return tr("Yesterday");
+            return QLocale().toString(day, QLocale::LongFormat);
+        }
+        case Qt::FontRole: {
+            QFont f;
+            f.setBold(true);
+            return f;
+        }
+        case IsDayRole: return true;
+        case DayStartRole: return row.dayStart;
+        default: return QVariant();
+        }
+    }
+
+    const HistoryEntry& e = m_snapshot.at(row.slot);
+    switch (role) {
+    case Qt::DisplayRole: {
+        const QString time = QLocale().toString(QDateTime::fromMSecsSinceEpoch(e.timestamp).time(),
+                                                QLocale::ShortFormat);
+        return time + "   " + (e.title.isEmpty() ? e.url : (e.title + " \u2014 " + e.url));
+    }
+    case Qt::ToolTipRole:
+        return e.url + "\n" + tr("Visits: %1").arg(e.visitCount);
+    case UrlRole: return e.url;
+    case TimestampRole: return e.timestamp;
+    case IsDayRole: return false;
+    case DayStartRole: return row.dayStart;
+    default: return QVariant();
+    }
+}
+
+bool HistoryModel::canFetchMore(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return false;
+    return m_filtered ? m_cursor < m_matches.size() : m_cursor >= 0;
+}
+
+void HistoryModel::fetchMore(const QModelIndex& parent)
+{
+    if (parent.isValid()) return;
+    QVector<Row> batch;
+    int added = 0;
+    while (added < FETCH_BATCH && canFetchMore(parent)) {
+        const int slot = m_filtered ? m_matches.at(m_cursor++) : m_cursor--;
+        const HistoryEntry& e = m_snapshot.at(slot);
+        if (e.isNull()) continue;
+        const qint64 day = dayStartOf(e.timestamp);
+        if (day != m_lastDay) {
+            batch.append({-1, day});
+            m_lastDay = day;
+        }
+        batch.append({slot, day});
+        ++added;
+    }
+    if (batch.isEmpty()) return;
+    beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + batch.size() - 1);
+    m_rows += batch;
+    endInsertRows();
+}
+
+QStringList HistoryModel::matchesOnDay(qint64 dayStart) const
+{
+    QStringList urls;
+    if (!m_filtered) return urls;
+    for (int slot : m_matches) {
+        const HistoryEntry& e = m_snapshot.at(slot);
+        if (!e.isNull() && dayStartOf(e.timestamp) == dayStart) urls.append(e.url);
+    }
+    return urls;
+}
+
+void HistoryModel::setFilter(const QString& text)
+{
+    m_filter = text.trimmed();
+    if (m_watcher.isRunning()) m_watcher.cancel();
+
+    if (m_filter.isEmpty()) {
+        m_filtered = false;
+        m_matches.clear();
+        resetRows();
+        emit filteringChanged(false);
+        return;
+    }
+
+    const QVector<HistoryEntry> snapshot = m_snapshot;
+    const QString needle = m_filter;
+    emit filteringChanged(true);
+    m_watcher.setFuture(QtConcurrent::run([snapshot, needle]() {
+        QVector<int> matches;
+        for (int i = snapshot.size() - 1; i >= 0; --i) {
+            const HistoryEntry& e = snapshot.at(i);
+            if (e.isNull()) continue;
+            if (e.url.contains(needle, Qt::CaseInsensitive)
+                || e.title.contains(needle, Qt::CaseInsensitive)) {
+                matches.append(i);
+            }
+        }
+        return matches;
+    }));
+}
+
+void HistoryModel::refresh()
+{
+    m_snapshot = m_store->snapshot();
+    if (m_filtered || m_watcher.isRunning()) {
+        setFilter(m_filter);
+    } else {
+        resetRows();
+    }
+}
+
+void HistoryModel::resetRows()
+{
+    beginResetModel();
+    m_rows.clear();
+    m_lastDay = -1;
+    m_cursor = m_filtered ? 0 : m_snapshot.size() - 1;
+    endResetModel();
+}
@@ -0,0 +1,71 @@
+/**
+ * HistoryModel - Lazily fetched, day-grouped list model over HistoryStore
+ *
+ * Works on an implicitly shared snapshot of the store, so opening costs
+ * O(1); rows (with a header row before each new day) are materialized in
+ * batches as the view scrolls via canFetchMore/fetchMore, and labels are
+ * only formatted for rows that are actually painted. Filtering scans the
+ * snapshot on a worker thread and swaps in the matching slots.
+ */
+
+#ifndef HISTORYMODEL_HPP
+#define HISTORYMODEL_HPP
+
+#include <QAbstractListModel>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QVector>
+#include "HistoryStore.hpp"
+
+class HistoryModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        UrlRole = Qt::UserRole,
+        TimestampRole,
+        IsDayRole,
+        DayStartRole
+    };
+
+    explicit HistoryModel(HistoryStore* store, QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool canFetchMore(const QModelIndex& parent) const override;
+    void fetchMore(const QModelIndex& parent) override;
+
+    void setFilter(const QString& text);
+    bool isFiltering() const { return m_watcher.isRunning(); }
+    // Rows are a filter's matches rather than all of history
+    bool isFiltered() const { return m_filtered; }
+    // Every matching entry under a day header, fetched into rows or not
+    QStringList matchesOnDay(qint64 dayStart) const;
+
+signals:
+    void filteringChanged(bool busy);
+
+private:
+    struct Row
+    {
+        int slot;           // index into m_snapshot, or -1 for a day header
+        qint64 dayStart;
+    };
+
+    void refresh();
+    void resetRows();
+
+    HistoryStore* m_store;
+    QVector<HistoryEntry> m_snapshot;
+    QString m_filter;
+    bool m_filtered = false;
+    QVector<int> m_matches;         // matching slots, newest first
+    int m_cursor = 0;
+    qint64 m_lastDay = -1;
+    QVector<Row> m_rows;
+    QFutureWatcher<QVector<int>> m_watcher;
+    QTimer m_refreshTimer;
+};
+
+#endif // HISTORYMODEL_HPP
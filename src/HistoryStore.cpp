@@ -0,0 +1,531 @@
+/**
+ * HistoryStore implementation
+ */
+
+#include "HistoryStore.hpp"
+#include "Journal.hpp"
+#include "Settings.hpp"
+#include <QDataStream>
+#include <QDateTime>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QStringList>
+
+namespace {
+
+enum RecordType : quint8 {
+    RecordVisit = 1,
+    RecordRemove = 2,
+    RecordPrune = 3,
+    RecordRemoveRange = 4,
+    RecordRemoveHost = 5,
+    RecordImport = 6
+};
+
+const qint64 MS_PER_DAY = 24LL * 60 * 60 * 1000;
+const int COMPACT_MIN_DEAD = 4096;
+
+QByteArray encodeVisit(const QString& url, const QString& title, qint64 timestamp, int visits)
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << quint8(RecordVisit) << url << title << timestamp << qint32(visits);
+    return out;
+}
+
+QByteArray encodeRemove(const QString& url)
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << quint8(RecordRemove) << url;
+    return out;
+}
+
+QByteArray encodePrune(qint64 cutoff)
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << quint8(RecordPrune) << cutoff;
+    return out;
+}
+
+QByteArray encodeRemoveRange(qint64 from, qint64 to)
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << quint8(RecordRemoveRange) << from << to;
+    return out;
+}
+
+QByteArray encodeRemoveHost(const QString& host)
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << quint8(RecordRemoveHost) << host;
+    return out;
+}
+
+QByteArray encodeImport(const QVector<HistoryEntry>& imported)
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << quint8(RecordImport) << quint32(imported.size());
+    for (const HistoryEntry& e : imported) {
+        ds << e.url << e.title << e.timestamp << qint32(e.visitCount);
+    }
+    return out;
+}
+
+// The state operations are shared by the GUI-thread store and journal replay
+
+void visitEntry(QVector<HistoryEntry>& entries, QHash<QString, int>& index, int& dead,
+                const QString& url, const QString& title, qint64 timestamp, int visits)
+{
+    HistoryEntry e{url, title, timestamp, visits};
+    auto it = index.find(url);
+    if (it != index.end()) {
+        HistoryEntry& old = entries[it.value()];
+        e.visitCount += old.visitCount;
+        if (e.title.isEmpty()) e.title = old.title;
+        old = HistoryEntry();
+        ++dead;
+        it.value() = entries.size();
+    } else {
+        index.insert(url, entries.size());
+    }
+    entries.append(e);
+}
+
+bool removeEntry(QVector<HistoryEntry>& entries, QHash<QString, int>& index, int& dead,
+                 const QString& url)
+{
+    auto it = index.find(url);
+    if (it == index.end()) return false;
+    entries[it.value()] = HistoryEntry();
+    index.erase(it);
+    ++dead;
+    return true;
+}
+
+// Entries are in visit order, so expired ones form a prefix
+QStringList pruneEntries(QVector<HistoryEntry>& entries, QHash<QString, int>& index, int& dead,
+                         qint64 cutoff)
+{
+    QStringList pruned;
+    for (int i = 0; i < entries.size(); ++i) {
+        if (entries[i].isNull()) continue;
+        if (entries[i].timestamp >= cutoff) break;
+        pruned.append(entries[i].url);
+        index.remove(entries[i].url);
+        entries[i] = HistoryEntry();
+        ++dead;
+    }
+    return pruned;
+}
+
+QStringList removeMatching(QVector<HistoryEntry>& entries, QHash<QString, int>& index, int& dead,
+                           const std::function<bool(const HistoryEntry&)>& match)
+{
+    QStringList removed;
+    for (int i = 0; i < entries.size(); ++i) {
+        if (entries[i].isNull() || !match(entries[i])) continue;
+        removed.append(entries[i].url);
+        index.remove(entries[i].url);
+        entries[i] = HistoryEntry();
+        ++dead;
+    }
+    return removed;
+}
+
+std::function<bool(const HistoryEntry&)> inRange(qint64 from, qint64 to)
+{
+    return [from, to](const HistoryEntry& e) { return e.timestamp >= from && e.timestamp < to; };
+}
+
+std::function<bool(const HistoryEntry&)> onHost(const QString& host)
+{
+    const QString suffix = "." + host;
+    return [host, suffix](const HistoryEntry& e) {
+        const QString h = HistoryStore::hostOf(e.url);
+        return h.compare(host, Qt::CaseInsensitive) == 0 || h.endsWith(suffix, Qt::CaseInsensitive);
+    };
+}
+
+// Folds in entries from another browser (sorted oldest-first, one per URL).
+// Visit counts and times take the larger of the two sides rather than adding
+// up, so importing the same file twice changes nothing. Existing entries keep
+// their relative order; imported ones are slotted in by time in one linear
+// merge, which also compacts. Returns the number of URLs that were new.
+int mergeEntries(QVector<HistoryEntry>& entries, QHash<QString, int>& index, int& dead,
+                 const QVector<HistoryEntry>& imported)
+{
+    QVector<HistoryEntry> incoming;
+    incoming.reserve(imported.size());
+    int added = 0;
+    for (const HistoryEntry& in : imported) {
+        if (in.url.isEmpty()) continue;
+        auto it = index.constFind(in.url);
+        if (it == index.constEnd()) {
+            incoming.append(in);
+            ++added;
+            continue;
+        }
+        HistoryEntry& old = entries[it.value()];
+        if (in.timestamp > old.timestamp) {
+            // A later visit moves the entry to its new place in time
+            HistoryEntry moved = in;
+            moved.visitCount = qMax(in.visitCount, old.visitCount);
+            if (moved.title.isEmpty()) moved.title = old.title;
+            incoming.append(moved);
+            old = HistoryEntry();
+        } else {
+            old.visitCount = qMax(old.visitCount, in.visitCount);
+            if (old.title.isEmpty()) old.title = in.title;
+        }
+    }
+
+    QVector<HistoryEntry> merged;
+    merged.reserve(index.size() + added);
+    index.clear();
+    int next = 0;
+    auto take = [&](const HistoryEntry& e) {
+        index.insert(e.url, merged.size());
+        merged.append(e);
+    };
+    for (const HistoryEntry& e : qAsConst(entries)) {
+        if (e.isNull()) continue;
+        while (next < incoming.size() && incoming.at(next).timestamp < e.timestamp) {
+            take(incoming.at(next++));
+        }
+        take(e);
+    }
+    while (next < incoming.size()) take(incoming.at(next++));
+
+    entries = merged;
+    dead = 0;
+    return added;
+}
+
+void compactEntries(QVector<HistoryEntry>& entries, QHash<QString, int>& index, int& dead)
+{
+    QVector<HistoryEntry> live;
+    live.reserve(index.size());
+    index.clear();
+    index.reserve(live.capacity());
+    for (const HistoryEntry& e : qAsConst(entries)) {
+        if (e.isNull()) continue;
+        index.insert(e.url, live.size());
+        live.append(e);
+    }
+    entries = live;
+    dead = 0;
+}
+
+} // namespace
+
+HistoryStore::HistoryStore(QObject* parent)
+    : QObject(parent)
+    , m_worker(new QObject)
+    , m_journal(new Journal(QStandardPaths::writableLocation(QStandardPaths::DataLocation)
+                            + "/history.journal"))
+{
+    m_retentionDays = Settings::instance()->historyRetentionDays();
+
+    m_thread.setObjectName("HistoryStore");
+    m_worker->moveToThread(&m_thread);
+    m_thread.start(QThread::LowPriority);
+
+    m_retentionTimer.setInterval(60 * 60 * 1000);
+    connect(&m_retentionTimer, &QTimer::timeout, this, &HistoryStore::pruneExpired);
+    m_retentionTimer.start();
+}
+
+HistoryStore::~HistoryStore()
+{
+    Journal* journal = m_journal;
+    QMetaObject::invokeMethod(m_worker, [journal]() { journal->sync(); },
+                              Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+    delete m_journal;
+    delete m_worker;
+}
+
+void HistoryStore::load()
+{
+    if (m_loaded || m_loading) return;
+    m_loading = true;
+
+    Journal* journal = m_journal;
+    QMetaObject::invokeMethod(m_worker, [this, journal]() {
+        QVector<HistoryEntry> entries;
+        QHash<QString, int> index;
+        int dead = 0;
+        bool migrated = false;
+
+        if (!journal->exists()) {
+            // One-time migration from the old QSettings "history" array (newest first)
+            QSettings settings(Settings::ORGANIZATION, Settings::APPLICATION);
+            const int size = settings.beginReadArray("history");
+            QList<QByteArray> records;
+            for (int i = size - 1; i >= 0; --i) {
+                settings.setArrayIndex(i);
+                const QString url = settings.value("url").toString();
+                const QString title = settings.value("title").toString();
+                const qint64 ts = settings.value("timestamp", 0).toLongLong();
+                if (url.isEmpty()) continue;
+                records.append(encodeVisit(url, title, ts, 1));
+            }
+            settings.endArray();
+            if (size > 0) {
+                journal->rewrite(records);
+                settings.remove("history");
+                migrated = true;
+            }
+        }
+
+        const int records = journal->replay([&](const QByteArray& payload) {
+            QDataStream ds(payload);
+            quint8 type;
+            ds >> type;
+            if (type == RecordVisit) {
+                QString url, title;
+                qint64 ts;
+                qint32 visits;
+                ds >> url >> title >> ts >> visits;
+                visitEntry(entries, index, dead, url, title, ts, visits);
+            } else if (type == RecordRemove) {
+                QString url;
+                ds >> url;
+                removeEntry(entries, index, dead, url);
+            } else if (type == RecordPrune) {
+                qint64 cutoff;
+                ds >> cutoff;
+                pruneEntries(entries, index, dead, cutoff);
+            } else if (type == RecordRemoveRange) {
+                qint64 from, to;
+                ds >> from >> to;
+                removeMatching(entries, index, dead, inRange(from, to));
+            } else if (type == RecordRemoveHost) {
+                QString host;
+                ds >> host;
+                removeMatching(entries, index, dead, onHost(host));
+            } else if (type == RecordImport) {
+                quint32 count;
+                ds >> count;
+                QVector<HistoryEntry> imported;
+                imported.reserve(int(qMin<quint32>(count, 1 << 20)));
+                for (quint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+                    HistoryEntry e;
+                    qint32 visits;
+                    ds >> e.url >> e.title >> e.timestamp >> visits;
+                    e.visitCount = visits;
+                    imported.append(e);
+                }
+                mergeEntries(entries, index, dead, imported);
+            }
+        });
+        if (dead > 0) compactEntries(entries, index, dead);
+
+        QMetaObject::invokeMethod(this, [this, entries, index, dead, records, migrated]() {
+            // The old store kept the last 500 pages however old; pruning them
+            // by a default nobody chose would silently lose most of them
+            if (migrated && !Settings::instance()->value("historyRetentionDays").isValid()) {
+                m_retentionDays = 0;
+                Settings::instance()->setHistoryRetentionDays(0);
+            }
+            m_entries = entries;
+            m_index = index;
+            m_dead = dead;
+            m_journalRecords += records;
+            m_loaded = true;
+            m_loading = false;
+            const QVector<std::function<void()>> deferred = m_deferred;
+            m_deferred.clear();
+            for (const auto& fn : deferred) fn();
+            pruneExpired();
+            maybeCompact();
+            emit loaded();
+        });
+    });
+}
+
+void HistoryStore::addVisit(const QString& url, const QString& title)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    journal(encodeVisit(url, title, now, 1));
+    whenLoaded([this, url, title, now]() {
+        applyVisit(url, title, now, 1);
+        emit visited(m_entries.constLast());
+        maybeCompact();
+    });
+}
+
+void HistoryStore::remove(const QString& url)
+{
+    journal(encodeRemove(url));
+    whenLoaded([this, url]() {
+        applyRemove(url);
+    });
+}
+
+void HistoryStore::removeRange(qint64 from, qint64 to)
+{
+    journal(encodeRemoveRange(from, to));
+    whenLoaded([this, from, to]() {
+        applyBulkRemove(removeMatching(m_entries, m_index, m_dead, inRange(from, to)));
+    });
+}
+
+void HistoryStore::removeHost(const QString& host)
+{
+    if (host.isEmpty()) return;
+    journal(encodeRemoveHost(host));
+    whenLoaded([this, host]() {
+        applyBulkRemove(removeMatching(m_entries, m_index, m_dead, onHost(host)));
+    });
+}
+
+void HistoryStore::importEntries(const QVector<HistoryEntry>& entries)
+{
+    if (entries.isEmpty()) return;
+    load();
+    // One record for the whole batch, encoded on the writer thread
+    ++m_journalRecords;
+    Journal* journal = m_journal;
+    QMetaObject::invokeMethod(m_worker, [journal, entries]() {
+        journal->append(encodeImport(entries));
+        journal->sync();
+    });
+    whenLoaded([this, entries]() {
+        const int added = mergeEntries(m_entries, m_index, m_dead, entries);
+        emit imported(added);
+        pruneExpired();
+        maybeCompact();
+    });
+}
+
+QString HistoryStore::hostOf(const QString& url)
+{
+    int start = url.indexOf(QLatin1String("://"));
+    start = start < 0 ? 0 : start + 3;
+    int end = start;
+    while (end < url.size()) {
+        const QChar c = url.at(end);
+        if (c == '/' || c == ':' || c == '?' || c == '#') break;
+        ++end;
+    }
+    // Strip userinfo
+    if (end > start) {
+        const int at = url.lastIndexOf('@', end - 1);
+        if (at >= start) start = at + 1;
+    }
+    return url.mid(start, end - start);
+}
+
+void HistoryStore::clear()
+{
+    // Rewriting to an empty log actually removes the data from disk
+    m_journalRecords = 0;
+    Journal* journal = m_journal;
+    QMetaObject::invokeMethod(m_worker, [journal]() { journal->rewrite({}); });
+    whenLoaded([this]() { applyClear(); });
+}
+
+HistoryEntry HistoryStore::entry(const QString& url) const
+{
+    auto it = m_index.constFind(url);
+    return it == m_index.constEnd() ? HistoryEntry() : m_entries.at(it.value());
+}
+
+void HistoryStore::setRetentionDays(int days)
+{
+    m_retentionDays = qMax(0, days);
+    Settings::instance()->setHistoryRetentionDays(m_retentionDays);
+    if (m_loaded) pruneExpired();
+}
+
+void HistoryStore::applyVisit(const QString& url, const QString& title, qint64 timestamp, int visits)
+{
+    visitEntry(m_entries, m_index, m_dead, url, title, timestamp, visits);
+    if (m_dead > COMPACT_MIN_DEAD && m_dead > m_index.size()) compactMemory();
+}
+
+void HistoryStore::applyRemove(const QString& url)
+{
+    if (removeEntry(m_entries, m_index, m_dead, url)) {
+        emit removed(url);
+    }
+}
+
+void HistoryStore::applyClear()
+{
+    m_entries.clear();
+    m_index.clear();
+    m_dead = 0;
+    emit cleared();
+}
+
+void HistoryStore::applyPrune(qint64 cutoff)
+{
+    const QStringList pruned = pruneEntries(m_entries, m_index, m_dead, cutoff);
+    if (pruned.isEmpty()) return;
+    journal(encodePrune(cutoff));
+    applyBulkRemove(pruned);
+}
+
+void HistoryStore::applyBulkRemove(const QStringList& urls)
+{
+    if (urls.isEmpty()) return;
+    if (m_dead > COMPACT_MIN_DEAD && m_dead > m_index.size()) compactMemory();
+    emit removedMany(urls);
+    maybeCompact();
+}
+
+void HistoryStore::whenLoaded(std::function<void()> fn)
+{
+    if (m_loaded) {
+        fn();
+    } else {
+        m_deferred.append(std::move(fn));
+    }
+}
+
+void HistoryStore::journal(const QByteArray& record)
+{
+    // The replay must be queued ahead of any append, or it would see (and
+    // apply twice) records the deferred callbacks are about to apply
+    load();
+    ++m_journalRecords;
+    Journal* journal = m_journal;
+    QMetaObject::invokeMethod(m_worker, [journal, record]() { journal->append(record); });
+}
+
+void HistoryStore::pruneExpired()
+{
+    if (!m_loaded || m_retentionDays <= 0) return;
+    applyPrune(QDateTime::currentMSecsSinceEpoch() - m_retentionDays * MS_PER_DAY);
+}
+
+void HistoryStore::maybeCompact()
+{
+    // Rewrite the log once superseded records dominate it
+    if (!m_loaded || m_journalRecords < 2LL * m_index.size() + COMPACT_MIN_DEAD) return;
+    m_journalRecords = m_index.size();
+
+    const QVector<HistoryEntry> snapshot = m_entries;
+    Journal* journal = m_journal;
+    QMetaObject::invokeMethod(m_worker, [journal, snapshot]() {
+        QList<QByteArray> records;
+        records.reserve(snapshot.size());
+        for (const HistoryEntry& e : snapshot) {
+            if (!e.isNull()) records.append(encodeVisit(e.url, e.title, e.timestamp, e.visitCount));
+        }
+        journal->rewrite(records);
+    });
+}
+
+void HistoryStore::compactMemory()
+{
+    if (m_dead > 0) compactEntries(m_entries, m_index, m_dead);
+}
@@ -0,0 +1,111 @@
+/**
+ * HistoryStore - Application-wide browsing history backed by a journal
+ *
+ * - In memory: entries in visit order plus a URL -> slot hash index, so
+ *   recording a visit is O(1) regardless of history size
+ * - On disk: an append-only Journal written from a background thread; the
+ *   GUI thread never blocks on file I/O
+ * - Background compaction once the log holds mostly superseded records
+ * - Time-based retention (historyRetentionDays, 0 = keep forever)
+ */
+
+#ifndef HISTORYSTORE_HPP
+#define HISTORYSTORE_HPP
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <functional>
+
+class Journal;
+
+struct HistoryEntry
+{
+    QString url;
+    QString title;
+    qint64 timestamp = 0;   // last visit, ms since epoch
+    int visitCount = 0;
+
+    // Superseded slots in the visit-ordered vector have an empty URL
+    bool isNull() const { return url.isEmpty(); }
+};
+
+class HistoryStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HistoryStore(QObject* parent = nullptr);
+    ~HistoryStore();
+
+    // Replays the journal on the writer thread; emits loaded() when done.
+    // Called after startup, or by the first write if that comes sooner.
+    // Visits recorded before that are journaled immediately and merged in.
+    void load();
+    bool isLoaded() const { return m_loaded; }
+
+    void addVisit(const QString& url, const QString& title);
+    void remove(const QString& url);
+    // Bulk deletes: visits in [from, to) ms since epoch, or a host and its subdomains
+    void removeRange(qint64 from, qint64 to);
+    void removeHost(const QString& host);
+    void clear();
+    // Merges history from another browser, oldest-first with unique URLs.
+    // Applied and journaled as a single batch; emits imported() when done.
+    void importEntries(const QVector<HistoryEntry>& entries);
+
+    // Host part of a URL string, without parsing a QUrl
+    static QString hostOf(const QString& url);
+
+    int count() const { return m_index.size(); }
+    bool contains(const QString& url) const { return m_index.contains(url); }
+    HistoryEntry entry(const QString& url) const;
+
+    // Entries oldest-first, including null (superseded) slots. Implicitly
+    // shared, so taking a snapshot is O(1) until the store next changes.
+    QVector<HistoryEntry> snapshot() const { return m_entries; }
+
+    int retentionDays() const { return m_retentionDays; }
+    void setRetentionDays(int days);
+
+signals:
+    void loaded();
+    void visited(const HistoryEntry& entry);
+    void removed(const QString& url);
+    // Emitted instead of removed() for bulk deletes and retention pruning
+    void removedMany(const QStringList& urls);
+    void cleared();
+    void imported(int added);
+
+private:
+    void applyVisit(const QString& url, const QString& title, qint64 timestamp, int visits);
+    void applyRemove(const QString& url);
+    void applyClear();
+    void applyPrune(qint64 cutoff);
+    void applyBulkRemove(const QStringList& urls);
+    void whenLoaded(std::function<void()> fn);
+    void journal(const QByteArray& record);
+    void pruneExpired();
+    void maybeCompact();
+    void compactMemory();
+
+    QVector<HistoryEntry> m_entries;
+    QHash<QString, int> m_index;
+    int m_dead = 0;
+    qint64 m_journalRecords = 0;
+    bool m_loaded = false;
+    bool m_loading = false;
+    QVector<std::function<void()>> m_deferred;
+    int m_retentionDays;
+    QTimer m_retentionTimer;
+
+    QThread m_thread;
+    QObject* m_worker;
+    Journal* m_journal;
+};
+
+#endif // HISTORYSTORE_HPP
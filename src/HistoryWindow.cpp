@@ -0,0 +1,180 @@
+/**
+ * HistoryWindow implementation
+ */
+
+#include "HistoryWindow.hpp"
+#include "HistoryModel.hpp"
+#include "HistoryStore.hpp"
+#include "BrowserData.hpp"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QFormLayout>
+#include <QLineEdit>
+#include <QListView>
+#include <QLabel>
+#include <QPushButton>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QDateEdit>
+#include <QDateTime>
+#include <QMessageBox>
+#include <QItemSelectionModel>
+#include <QSet>
+
+HistoryWindow::HistoryWindow(QWidget* parent)
+    : QWidget(parent, Qt::Window)
+    , m_model(new HistoryModel(BrowserData::instance()->history(), this))
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(tr("History"));
+    resize(700, 520);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+
+    QHBoxLayout* filterRow = new QHBoxLayout;
+    m_filterEdit = new QLineEdit(this);
+    m_filterEdit->setPlaceholderText(tr("Search history..."));
+    m_filterEdit->setClearButtonEnabled(true);
+    m_busyLabel = new QLabel(tr("Filtering..."), this);
+    m_busyLabel->setVisible(false);
+    filterRow->addWidget(m_filterEdit);
+    filterRow->addWidget(m_busyLabel);
+    layout->addLayout(filterRow);
+
+    // Uniform item sizes let the view skip measuring rows it isn't painting
+    m_list = new QListView(this);
+    m_list->setModel(m_model);
+    m_list->setUniformItemSizes(true);
+    m_list->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_list->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    layout->addWidget(m_list);
+
+    QHBoxLayout* buttons = new QHBoxLayout;
+    m_deleteBtn = new QPushButton(tr("&Delete"), this);
+    m_deleteSiteBtn = new QPushButton(tr("Delete &Site"), this);
+    QPushButton* rangeBtn = new QPushButton(tr("Delete &Range..."), this);
+    QPushButton* closeBtn = new QPushButton(tr("&Close"), this);
+    buttons->addWidget(m_deleteBtn);
+    buttons->addWidget(m_deleteSiteBtn);
+    buttons->addWidget(rangeBtn);
+    buttons->addStretch();
+    buttons->addWidget(closeBtn);
+    layout->addLayout(buttons);
+
+    // Typing is debounced so each keystroke doesn't restart a full scan
+    m_filterTimer.setSingleShot(true);
+    m_filterTimer.setInterval(150);
+    connect(&m_filterTimer, &QTimer::timeout, this, [this]() {
+        m_model->setFilter(m_filterEdit->text());
+    });
+    connect(m_filterEdit, &QLineEdit::textChanged, &m_filterTimer, QOverload<>::of(&QTimer::start));
+    connect(m_model, &HistoryModel::filteringChanged, m_busyLabel, &QLabel::setVisible);
+
+    connect(m_list, &QListView::activated, this, &HistoryWindow::onActivated);
+    connect(m_list->selectionModel(), &QItemSelectionModel::selectionChanged, this, &HistoryWindow::updateButtons);
+    connect(m_model, &QAbstractItemModel::modelReset, this, &HistoryWindow::updateButtons);
+    connect(m_deleteBtn, &QPushButton::clicked, this, &HistoryWindow::onDeleteSelected);
+    connect(m_deleteSiteBtn, &QPushButton::clicked, this, &HistoryWindow::onDeleteSite);
+    connect(rangeBtn, &QPushButton::clicked, this, &HistoryWindow::onDeleteRange);
+    connect(closeBtn, &QPushButton::clicked, this, &QWidget::close);
+
+    updateButtons();
+    m_filterEdit->setFocus();
+}
+
+void HistoryWindow::onActivated(const QModelIndex& index)
+{
+    if (index.data(HistoryModel::IsDayRole).toBool()) return;
+    const QString url = index.data(HistoryModel::UrlRole).toString();
+    if (!url.isEmpty()) emit openUrl(url);
+}
+
+void HistoryWindow::onDeleteSelected()
+{
+    HistoryStore* store = BrowserData::instance()->history();
+    QStringList urls;
+    QSet<qint64> days;
+    for (const QModelIndex& index : m_list->selectionModel()->selectedIndexes()) {
+        if (index.data(HistoryModel::IsDayRole).toBool()) {
+            days.insert(index.data(HistoryModel::DayStartRole).toLongLong());
+        } else {
+            urls.append(index.data(HistoryModel::UrlRole).toString());
+        }
+    }
+    // A selected day header stands for every entry under it; while a
+    // filter is on, only the ones it matches, not those it hides
+    for (qint64 day : days) {
+        if (m_model->isFiltered()) {
+            urls += m_model->matchesOnDay(day);
+            continue;
+        }
+        const QDate date = QDateTime::fromMSecsSinceEpoch(day).date();
+        store->removeRange(day, date.addDays(1).startOfDay().toMSecsSinceEpoch());
+    }
+    urls.removeDuplicates();
+    for (const QString& url : urls) store->remove(url);
+}
+
+void HistoryWindow::onDeleteSite()
+{
+    QSet<QString> hosts;
+    for (const QModelIndex& index : m_list->selectionModel()->selectedIndexes()) {
+        if (index.data(HistoryModel::IsDayRole).toBool()) continue;
+        const QString host = HistoryStore::hostOf(index.data(HistoryModel::UrlRole).toString());
+        if (!host.isEmpty()) hosts.insert(host);
+    }
+    if (hosts.isEmpty()) return;
+
+    QStringList names = hosts.values();
+    names.sort();
+    if (QMessageBox::question(this, tr("Delete Site"),
+                              tr("Delete all history for %1?").arg(names.join(", ")),
+                              QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes) {
+        return;
+    }
+    HistoryStore* store = BrowserData::instance()->history();
+    for (const QString& host : names) store->removeHost(host);
+}
+
+void HistoryWindow::onDeleteRange()
+{
+    QDialog dlg(this);
+    dlg.setWindowTitle(tr("Delete Range"));
+
+    QFormLayout* form = new QFormLayout(&dlg);
+    QDateEdit* fromEdit = new QDateEdit(QDate::currentDate().addDays(-7), &dlg);
+    QDateEdit* toEdit = new QDateEdit(QDate::currentDate(), &dlg);
+    fromEdit->setCalendarPopup(true);
+    toEdit->setCalendarPopup(true);
+    form->addRow(tr("From:"), fromEdit);
+    form->addRow(tr("To:"), toEdit);
+
+    QDialogButtonBox* box = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dlg);
+    form->addRow(box);
+    connect(box, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+    connect(box, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+
+    if (dlg.exec() != QDialog::Accepted) return;
+
+    QDate from = fromEdit->date();
+    QDate to = toEdit->date();
+    if (to < from) std::swap(from, to);
+    // Both ends are inclusive days; the store takes a half-open interval
+    BrowserData::instance()->history()->removeRange(from.startOfDay().toMSecsSinceEpoch(),
+                                                    to.addDays(1).startOfDay().toMSecsSinceEpoch());
+}
+
+void HistoryWindow::updateButtons()
+{
+    bool any = false;
+    bool anyEntry = false;
+    for (const QModelIndex& index : m_list->selectionModel()->selectedIndexes()) {
+        any = true;
+        if (!index.data(HistoryModel::IsDayRole).toBool()) {
+            anyEntry = true;
+            break;
+        }
+    }
+    m_deleteBtn->setEnabled(any);
+    m_deleteSiteBtn->setEnabled(anyEntry);
+}
@@ -0,0 +1,49 @@
+/**
+ * HistoryWindow - Browsable, filterable history with bulk deletion
+ *
+ * A non-modal window over HistoryModel. Entries are grouped under day
+ * headers; selecting a header deletes that whole day, and "Delete Site"
+ * and "Delete Range" remove by host or date span as single store records.
+ */
+
+#ifndef HISTORYWINDOW_HPP
+#define HISTORYWINDOW_HPP
+
+#include <QWidget>
+#include <QTimer>
+
+class HistoryModel;
+class QLineEdit;
+class QListView;
+class QLabel;
+class QPushButton;
+
+class HistoryWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit HistoryWindow(QWidget* parent = nullptr);
+
+signals:
+    void openUrl(const QString& url);
+
+private slots:
+    void onDeleteSelected();
+    void onDeleteSite();
+    void onDeleteRange();
+    void onActivated(const QModelIndex& index);
+
+private:
+    void updateButtons();
+
+    HistoryModel* m_model;
+    QLineEdit* m_filterEdit;
+    QListView* m_list;
+    QLabel* m_busyLabel;
+    QPushButton* m_deleteBtn;
+    QPushButton* m_deleteSiteBtn;
+    QTimer m_filterTimer;
+};
+
+#endif // HISTORYWINDOW_HPP
@@ -0,0 +1,306 @@
+/**
+ * HttpsUpgrader implementation
+ */
+
+#include "HttpsUpgrader.hpp"
+#include "Settings.hpp"
+#include <QApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const char PRELOAD_MAGIC[8] = {'H', 'S', 'T', 'S', 'P', 'L', '0', '1'};
+const char* const PRELOAD_FILE = "https-preload.bin";
+const char* const OUTCOMES_FILE = "https-hosts.dat";
+const char* const DEFAULT_PRELOAD_URL =
+    "https://raw.githubusercontent.com/chromium/chromium/main/net/http/transport_security_state_static.json";
+const qint64 PRELOAD_UPDATE_MS = 30LL * 24 * 60 * 60 * 1000;
+// A host that failed over https is left alone for a week
+const qint64 FAILURE_TTL_MS = 7LL * 24 * 60 * 60 * 1000;
+// How long after an upgrade (or a plain http request) its outcome is attributed to it
+const qint64 ATTRIBUTION_MS = 60 * 1000;
+const int MAX_OUTCOMES = 20000;
+const int SAVE_DELAY_MS = 5000;
+
+quint64 hostHash(const QString& host)
+{
+    const QByteArray bytes = host.toLower().toUtf8();
+    quint64 h = 14695981039346656037ull;
+    for (const char c : bytes) {
+        h ^= uchar(c);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Sorted keys of (hash << 1 | include_subdomains), behind a small header
+QByteArray compilePreload(const QByteArray& json)
+{
+    // The source is JSON with // comment lines
+    QByteArray stripped;
+    stripped.reserve(json.size());
+    for (const QByteArray& line : json.split('\n')) {
+        if (!line.trimmed().startsWith("//")) stripped += line + '\n';
+    }
+    const QJsonArray entries = QJsonDocument::fromJson(stripped).object().value("entries").toArray();
+    if (entries.isEmpty()) return QByteArray();
+
+    std::vector<quint64> keys;
+    keys.reserve(entries.size());
+    for (const QJsonValue& value : entries) {
+        const QJsonObject entry = value.toObject();
+        if (entry.value("mode").toString() != QLatin1String("force-https")) continue;
+        const QString name = entry.value("name").toString();
+        if (name.isEmpty()) continue;
+        keys.push_back(hostHash(name) << 1 | (entry.value("include_subdomains").toBool() ? 1 : 0));
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    const quint64 count = keys.size();
+    QByteArray out;
+    out.append(PRELOAD_MAGIC, sizeof(PRELOAD_MAGIC));
+    out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.append(reinterpret_cast<const char*>(keys.data()), int(count * sizeof(quint64)));
+    return out;
+}
+
+bool isUpgradableHost(const QString& host)
+{
+    // Single-label names and addresses are local; they rarely have certificates
+    if (!host.contains('.') || host.endsWith(QLatin1String(".local"))) return false;
+    return QHostAddress(host).isNull();
+}
+
+} // namespace
+
+HttpsUpgrader* HttpsUpgrader::instance()
+{
+    static HttpsUpgrader* upgrader = nullptr;
+    if (!upgrader) upgrader = new HttpsUpgrader(qApp);
+    return upgrader;
+}
+
+HttpsUpgrader::HttpsUpgrader(QObject* parent)
+    : QWebEngineUrlRequestInterceptor(parent)
+    , m_enabled(Settings::instance()->value("httpsUpgrade", true).toBool())
+    , m_dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation))
+{
+    mapPreloadSet();
+    loadOutcomes();
+
+    m_saveTimer.setSingleShot(true);
+    m_saveTimer.setInterval(SAVE_DELAY_MS);
+    connect(&m_saveTimer, &QTimer::timeout, this, [this]() {
+        QByteArray data;
+        QDataStream ds(&data, QIODevice::WriteOnly);
+        ds << qint32(m_outcomes.size());
+        for (auto it = m_outcomes.cbegin(); it != m_outcomes.cend(); ++it) {
+            ds << it.key() << it->secure << it->at;
+        }
+        const QString path = m_dir + "/" + OUTCOMES_FILE;
+        QtConcurrent::run([path, data]() {
+            QSaveFile file(path);
+            if (file.open(QIODevice::WriteOnly) && file.write(data) == data.size()) file.commit();
+        });
+    });
+    connect(&m_compileWatcher, &QFutureWatcher<bool>::finished, this, [this]() {
+        if (m_compileWatcher.result()) mapPreloadSet();
+    });
+}
+
+HttpsUpgrader::~HttpsUpgrader()
+{
+    m_compileWatcher.waitForFinished();
+    if (m_preloadMap) m_preloadFile.unmap(const_cast<uchar*>(m_preloadMap));
+}
+
+void HttpsUpgrader::interceptRequest(QWebEngineUrlRequestInfo& info)
+{
+    if (!m_enabled) return;
+    const QUrl url = info.requestUrl();
+    const QString host = url.host().toLower();
+    const bool mainFrame = info.resourceType() == QWebEngineUrlRequestInfo::ResourceTypeMainFrame;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (url.scheme() == QLatin1String("https")) {
+        // The server sent us from http to https: remember, and skip that next time
+        if (mainFrame && now - m_plainRequests.take(host) < ATTRIBUTION_MS) {
+            m_outcomes.insert(host, {true, now});
+            scheduleSave();
+        }
+        return;
+    }
+    if (url.scheme() != QLatin1String("http") || !isUpgradableHost(host)) return;
+    // Other methods could replay a form submission to a different server
+    if (info.requestMethod() != "GET" && info.requestMethod() != "HEAD") return;
+
+    if (!shouldUpgrade(host)) {
+        if (mainFrame) {
+            if (m_plainRequests.size() > 256) m_plainRequests.clear();
+            m_plainRequests.insert(host, now);
+        }
+        return;
+    }
+    QUrl secure = url;
+    secure.setScheme(QStringLiteral("https"));
+    if (secure.port() == 80) secure.setPort(-1);
+    info.redirect(secure);
+    if (mainFrame) {
+        if (m_upgradedAt.size() > 256) m_upgradedAt.clear();
+        m_upgradedAt.insert(host, now);
+    }
+}
+
+QUrl HttpsUpgrader::fallbackFor(const QUrl& failedUrl)
+{
+    if (failedUrl.scheme() != QLatin1String("https")) return QUrl();
+    const QString host = failedUrl.host().toLower();
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - m_upgradedAt.take(host) >= ATTRIBUTION_MS) return QUrl();
+
+    m_outcomes.insert(host, {false, now});
+    scheduleSave();
+    QUrl plain = failedUrl;
+    plain.setScheme(QStringLiteral("http"));
+    return plain;
+}
+
+void HttpsUpgrader::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    Settings::instance()->setValue("httpsUpgrade", enabled);
+}
+
+void HttpsUpgrader::updatePreloadList()
+{
+    const QString binPath = m_dir + "/" + PRELOAD_FILE;
+    const qint64 age = QDateTime::currentMSecsSinceEpoch() - QFileInfo(binPath).lastModified().toMSecsSinceEpoch();
+    if (!m_enabled || (m_preload && age < PRELOAD_UPDATE_MS) || m_network) return;
+
+    m_network = new QNetworkAccessManager(this);
+    const QUrl url(Settings::instance()->value("httpsPreloadUrl", DEFAULT_PRELOAD_URL).toString());
+    QNetworkRequest request(url);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    QNetworkReply* reply = m_network->get(request);
+    connect(reply, &QNetworkReply::finished, this, [this, reply, binPath]() {
+        reply->deleteLater();
+        m_network->deleteLater();
+        m_network = nullptr;
+        if (reply->error() != QNetworkReply::NoError) {
+            qWarning("HttpsUpgrader: could not fetch the preload list: %s", qPrintable(reply->errorString()));
+            return;
+        }
+        const QByteArray json = reply->readAll();
+        // Parsing the multi-megabyte list is kept off the GUI thread; only
+        // the compiled set is kept
+        m_compileWatcher.setFuture(QtConcurrent::run([json, binPath]() {
+            const QByteArray blob = compilePreload(json);
+            if (blob.isEmpty()) return false;
+            QDir().mkpath(QFileInfo(binPath).path());
+            QSaveFile bin(binPath);
+            return bin.open(QIODevice::WriteOnly) && bin.write(blob) == blob.size() && bin.commit();
+        }));
+    });
+}
+
+bool HttpsUpgrader::shouldUpgrade(const QString& host) const
+{
+    auto it = m_outcomes.constFind(host);
+    if (it != m_outcomes.constEnd()) {
+        if (it->secure) return true;
+        if (QDateTime::currentMSecsSinceEpoch() - it->at < FAILURE_TTL_MS) return false;
+    }
+    return isPreloaded(host);
+}
+
+bool HttpsUpgrader::isPreloaded(const QString& host) const
+{
+    if (!m_preload) return false;
+    const quint64* end = m_preload + m_preloadCount;
+    // The host itself, then each parent that covers its subdomains
+    int start = 0;
+    for (bool exact = true;; exact = false) {
+        const quint64 key = hostHash(host.mid(start)) << 1;
+        const quint64* it = std::lower_bound(m_preload, end, key);
+        if (it != end && (*it | 1) == (key | 1) && (exact || (*it & 1))) return true;
+        if (it + 1 < end && *(it + 1) == (key | 1)) return true;
+        const int dot = host.indexOf('.', start);
+        if (dot < 0) return false;
+        start = dot + 1;
+    }
+}
+
+void HttpsUpgrader::mapPreloadSet()
+{
+    if (m_preloadMap) {
+        m_preloadFile.unmap(const_cast<uchar*>(m_preloadMap));
+        m_preloadMap = nullptr;
+        m_preload = nullptr;
+        m_preloadCount = 0;
+    }
+    m_preloadFile.close();
+    m_preloadFile.setFileName(m_dir + "/" + PRELOAD_FILE);
+    if (!m_preloadFile.open(QIODevice::ReadOnly)) return;
+    const qint64 size = m_preloadFile.size();
+    if (size < 16 || size % 8 != 0) return;
+    const uchar* data = m_preloadFile.map(0, size);
+    if (!data) return;
+    quint64 count;
+    std::memcpy(&count, data + 8, sizeof(count));
+    if (std::memcmp(data, PRELOAD_MAGIC, sizeof(PRELOAD_MAGIC)) != 0 || count != quint64(size - 16) / 8) {
+        m_preloadFile.unmap(const_cast<uchar*>(data));
+        return;
+    }
+    m_preloadMap = data;
+    m_preload = reinterpret_cast<const quint64*>(data + 16);
+    m_preloadCount = count;
+}
+
+void HttpsUpgrader::loadOutcomes()
+{
+    QFile file(m_dir + "/" + OUTCOMES_FILE);
+    if (!file.open(QIODevice::ReadOnly)) return;
+    QDataStream ds(&file);
+    qint32 count = 0;
+    ds >> count;
+    for (qint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+        QString host;
+        Outcome outcome;
+        ds >> host >> outcome.secure >> outcome.at;
+        if (ds.status() == QDataStream::Ok) m_outcomes.insert(host, outcome);
+    }
+}
+
+void HttpsUpgrader::scheduleSave()
+{
+    // Oldest outcomes go first once the table is full
+    if (m_outcomes.size() > MAX_OUTCOMES) {
+        QVector<qint64> times;
+        times.reserve(m_outcomes.size());
+        for (const Outcome& o : qAsConst(m_outcomes)) times.append(o.at);
+        std::nth_element(times.begin(), times.begin() + times.size() / 4, times.end());
+        const qint64 cutoff = times.at(times.size() / 4);
+        for (auto it = m_outcomes.begin(); it != m_outcomes.end();) {
+            if (it->at <= cutoff) it = m_outcomes.erase(it);
+            else ++it;
+        }
+    }
+    if (!m_saveTimer.isActive()) m_saveTimer.start();
+}
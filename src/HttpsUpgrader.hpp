@@ -0,0 +1,77 @@
+/**
+ * HttpsUpgrader - Rewrites http:// requests to https:// before they're sent
+ *
+ * Installed on the default profile, so it sees every request from every
+ * page. A host is upgraded when it is in:
+ * - the preload set: Chromium's HSTS preload list, fetched monthly and
+ *   compiled into a sorted array of 64-bit host hashes that is
+ *   memory-mapped and binary-searched (https-preload.bin)
+ * - the learned set: hosts whose server redirected http to https, so the
+ *   next visit skips that round trip
+ * If an upgraded page fails to load, MainWindow retries it over http via
+ * fallbackFor() and the host is not upgraded again for a while. Learned and
+ * failed outcomes are saved in https-hosts.dat.
+ */
+
+#ifndef HTTPSUPGRADER_HPP
+#define HTTPSUPGRADER_HPP
+
+#include <QWebEngineUrlRequestInterceptor>
+#include <QFile>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QTimer>
+#include <QUrl>
+
+class QNetworkAccessManager;
+
+class HttpsUpgrader : public QWebEngineUrlRequestInterceptor
+{
+    Q_OBJECT
+
+public:
+    static HttpsUpgrader* instance();
+    ~HttpsUpgrader();
+
+    void interceptRequest(QWebEngineUrlRequestInfo& info) override;
+
+    // For a page that failed to load: the http URL to retry with if the
+    // failure was on a connection this upgraded, otherwise an empty URL
+    QUrl fallbackFor(const QUrl& failedUrl);
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+
+    // Refreshes the preload list if it is missing or a month old
+    void updatePreloadList();
+
+private:
+    explicit HttpsUpgrader(QObject* parent = nullptr);
+
+    bool shouldUpgrade(const QString& host) const;
+    bool isPreloaded(const QString& host) const;
+    void mapPreloadSet();
+    void loadOutcomes();
+    void scheduleSave();
+
+    struct Outcome
+    {
+        bool secure = false;    // learned upgradable, or failed over https
+        qint64 at = 0;
+    };
+
+    bool m_enabled;
+    QString m_dir;
+    QFile m_preloadFile;
+    const uchar* m_preloadMap = nullptr;
+    const quint64* m_preload = nullptr;   // sorted (host hash << 1 | include subdomains)
+    qint64 m_preloadCount = 0;
+    QHash<QString, Outcome> m_outcomes;
+    QHash<QString, qint64> m_plainRequests;     // host -> when its http main frame was requested
+    QHash<QString, qint64> m_upgradedAt;        // host -> when its main frame was upgraded
+    QTimer m_saveTimer;
+    QNetworkAccessManager* m_network = nullptr;
+    QFutureWatcher<bool> m_compileWatcher;
+};
+
+#endif // HTTPSUPGRADER_HPP
@@ -0,0 +1,442 @@
+/**
+ * Importer implementation
+ */
+
+#include "Importer.hpp"
+#include "BrowserData.hpp"
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QUrl>
+#include <QtConcurrent>
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+const int CHUNK_CHARS = 256 * 1024;
+// Chrome stores times as microseconds since 1601-01-01
+const qint64 CHROME_EPOCH_OFFSET_MS = 11644473600000LL;
+
+bool isImportableUrl(const QString& url)
+{
+    const int colon = url.indexOf(':');
+    if (colon <= 0) return false;
+    const QStringRef scheme = url.leftRef(colon);
+    return scheme.compare(QLatin1String("http"), Qt::CaseInsensitive) == 0
+        || scheme.compare(QLatin1String("https"), Qt::CaseInsensitive) == 0
+        || scheme.compare(QLatin1String("ftp"), Qt::CaseInsensitive) == 0
+        || scheme.compare(QLatin1String("file"), Qt::CaseInsensitive) == 0;
+}
+
+QString decodeEntities(const QString& text)
+{
+    if (!text.contains('&')) return text;
+    QString out;
+    out.reserve(text.size());
+    int i = 0;
+    while (i < text.size()) {
+        const int amp = text.indexOf('&', i);
+        const int semi = amp < 0 ? -1 : text.indexOf(';', amp);
+        if (amp < 0 || semi < 0 || semi - amp > 10) {
+            out += text.midRef(i);
+            break;
+        }
+        out += text.midRef(i, amp - i);
+        const QStringRef name = text.midRef(amp + 1, semi - amp - 1);
+        if (name == QLatin1String("amp")) out += '&';
+        else if (name == QLatin1String("lt")) out += '<';
+        else if (name == QLatin1String("gt")) out += '>';
+        else if (name == QLatin1String("quot")) out += '"';
+        else if (name == QLatin1String("apos")) out += '\'';
+        else if (name.startsWith('#')) {
+            bool ok = false;
+            const uint code = name.startsWith(QLatin1String("#x"), Qt::CaseInsensitive)
+                ? name.mid(2).toUInt(&ok, 16) : name.mid(1).toUInt(&ok, 10);
+            if (ok) out += QString::fromUcs4(&code, 1);
+            else out += text.midRef(amp, semi - amp + 1);
+        } else {
+            out += text.midRef(amp, semi - amp + 1);
+        }
+        i = semi + 1;
+    }
+    return out;
+}
+
+// Value of NAME="..." (or '...' or unquoted) inside a tag
+QString attribute(const QStringRef& tag, QLatin1String name)
+{
+    int at = 0;
+    while ((at = tag.indexOf(name, at, Qt::CaseInsensitive)) >= 0) {
+        const int eq = at + name.size();
+        const bool boundary = at == 0 || tag.at(at - 1).isSpace();
+        at = eq;
+        if (!boundary || eq >= tag.size() || tag.at(eq) != '=') continue;
+        int start = eq + 1;
+        if (start >= tag.size()) return QString();
+        const QChar quote = tag.at(start);
+        int end;
+        if (quote == '"' || quote == '\'') {
+            ++start;
+            end = tag.indexOf(quote, start);
+            if (end < 0) end = tag.size();
+        } else {
+            end = start;
+            while (end < tag.size() && !tag.at(end).isSpace()) ++end;
+        }
+        return decodeEntities(tag.mid(start, end - start).toString());
+    }
+    return QString();
+}
+
+BookmarkNode makeFolder(int parent, const QString& title)
+{
+    BookmarkNode n;
+    n.folder = true;
+    n.parent = parent;
+    n.title = title;
+    return n;
+}
+
+BookmarkNode makeBookmark(int parent, const QString& title, const QString& url)
+{
+    BookmarkNode n;
+    n.parent = parent;
+    n.title = title.isEmpty() ? url : title;
+    n.url = url;
+    return n;
+}
+
+} // namespace
+
+Importer::Importer(QObject* parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<Result>::finished, this, [this]() {
+        if (isCanceled()) {
+            emit canceled();
+            return;
+        }
+        const Result result = m_watcher.result();
+        if (!result.error.isEmpty()) {
+            emit failed(result.error);
+            return;
+        }
+        // One batch per store; both skip what they already have
+        BrowserData* data = BrowserData::instance();
+        const int added = data->bookmarks()->insertTree(BookmarkStore::ROOT_ID, result.bookmarks);
+        data->history()->importEntries(result.history);
+        emit finished(added, result.history.size());
+    });
+}
+
+Importer::~Importer()
+{
+    cancel();
+    m_watcher.waitForFinished();
+}
+
+QString Importer::fileFilter()
+{
+    return tr("Bookmarks and history (*.html *.htm Bookmarks *.json History places.sqlite *.sqlite);;"
+              "All files (*)");
+}
+
+void Importer::start(const QString& path)
+{
+    if (isRunning()) return;
+    m_cancel = false;
+    m_lastPercent = -1;
+    m_watcher.setFuture(QtConcurrent::run([this, path]() { return run(path); }));
+}
+
+void Importer::cancel()
+{
+    m_cancel = true;
+}
+
+void Importer::reportProgress(qint64 done, qint64 total)
+{
+    const int percent = total > 0 ? int(qBound<qint64>(0, done * 100 / total, 100)) : 0;
+    // Only cross threads when the visible value changes
+    if (m_lastPercent.exchange(percent) == percent) return;
+    QMetaObject::invokeMethod(this, [this, percent]() { emit progress(percent); });
+}
+
+Importer::Result Importer::run(const QString& path)
+{
+    Result result;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = tr("Cannot open %1").arg(path);
+        return result;
+    }
+    const QByteArray head = file.peek(512);
+    file.close();
+
+    // Everything lands in one folder so an import is easy to find (or drop)
+    result.bookmarks.append(makeFolder(-1, tr("Imported from %1").arg(QFileInfo(path).fileName())));
+
+    bool ok;
+    if (head.startsWith("SQLite format 3")) {
+        ok = parseSqlite(path, result);
+    } else if (head.trimmed().startsWith('{')) {
+        ok = parseChromeBookmarks(path, result);
+    } else if (head.contains('<')) {
+        ok = parseNetscape(path, result);
+    } else {
+        result.error = tr("%1 is not a bookmarks or history file this browser can read.")
+                           .arg(QFileInfo(path).fileName());
+        ok = false;
+    }
+    if (!ok || isCanceled()) return result;
+
+    // History goes in oldest-first with one entry per URL
+    QHash<QString, int> seen;
+    QVector<HistoryEntry> unique;
+    unique.reserve(result.history.size());
+    for (const HistoryEntry& e : qAsConst(result.history)) {
+        auto it = seen.constFind(e.url);
+        if (it == seen.constEnd()) {
+            seen.insert(e.url, unique.size());
+            unique.append(e);
+            continue;
+        }
+        HistoryEntry& kept = unique[it.value()];
+        kept.visitCount = qMax(kept.visitCount, e.visitCount);
+        if (e.timestamp > kept.timestamp) {
+            kept.timestamp = e.timestamp;
+            if (!e.title.isEmpty()) kept.title = e.title;
+        }
+    }
+    std::sort(unique.begin(), unique.end(), [](const HistoryEntry& a, const HistoryEntry& b) {
+        return a.timestamp < b.timestamp;
+    });
+    result.history = unique;
+    reportProgress(1, 1);
+    return result;
+}
+
+bool Importer::parseNetscape(const QString& path, Result& result)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = tr("Cannot open %1").arg(path);
+        return false;
+    }
+    const qint64 total = file.size();
+    QTextStream in(&file);
+    in.setCodec("UTF-8");
+
+    // Folders nest as <DT><H3>title</H3><DL> ... </DL>; bookmarks are <A HREF>
+    enum Mode { Skip, LinkTitle, FolderTitle };
+    Mode mode = Skip;
+    QVector<int> folders{0};    // open <DL> stack, as indices into result.bookmarks
+    int pendingFolder = -1;     // <H3> whose <DL> hasn't opened yet
+    QString text;
+    QString href;
+    QString buf;
+    int pos = 0;
+
+    while (!isCanceled()) {
+        const int lt = buf.indexOf('<', pos);
+        const int gt = lt < 0 ? -1 : buf.indexOf('>', lt);
+        if (gt < 0) {
+            // Tag runs past the buffer: keep it and read the next chunk
+            if (mode != Skip) text += buf.midRef(pos, (lt < 0 ? buf.size() : lt) - pos);
+            buf = lt < 0 ? QString() : buf.mid(lt);
+            pos = 0;
+            if (in.atEnd()) break;
+            buf += in.read(CHUNK_CHARS);
+            reportProgress(file.pos(), total);
+            continue;
+        }
+        if (mode != Skip) text += buf.midRef(pos, lt - pos);
+        const QStringRef tag = buf.midRef(lt + 1, gt - lt - 1);
+        pos = gt + 1;
+
+        int nameEnd = 0;
+        while (nameEnd < tag.size() && !tag.at(nameEnd).isSpace()) ++nameEnd;
+        const QStringRef name = tag.left(nameEnd);
+        auto is = [&name](const char* tagName) {
+            return name.compare(QLatin1String(tagName), Qt::CaseInsensitive) == 0;
+        };
+
+        if (is("DL")) {
+            folders.append(pendingFolder >= 0 ? pendingFolder : folders.last());
+            pendingFolder = -1;
+        } else if (is("/DL")) {
+            if (folders.size() > 1) folders.removeLast();
+        } else if (is("H3")) {
+            mode = FolderTitle;
+            text.clear();
+        } else if (is("/H3") && mode == FolderTitle) {
+            pendingFolder = result.bookmarks.size();
+            result.bookmarks.append(makeFolder(folders.last(), decodeEntities(text).trimmed()));
+            mode = Skip;
+        } else if (is("A")) {
+            href = attribute(tag, QLatin1String("HREF"));
+            mode = LinkTitle;
+            text.clear();
+        } else if (is("/A") && mode == LinkTitle) {
+            if (isImportableUrl(href)) {
+                result.bookmarks.append(makeBookmark(folders.last(), decodeEntities(text).trimmed(), href));
+            }
+            mode = Skip;
+        }
+    }
+    return true;
+}
+
+bool Importer::parseChromeBookmarks(const QString& path, Result& result)
+{
+    // Qt has no incremental JSON reader; the parse itself is still off-thread
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = tr("Cannot open %1").arg(path);
+        return false;
+    }
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+    if (error.error != QJsonParseError::NoError) {
+        result.error = tr("Cannot read %1: %2").arg(QFileInfo(path).fileName(), error.errorString());
+        return false;
+    }
+    reportProgress(1, 2);
+
+    std::function<void(const QJsonArray&, int)> addChildren = [&](const QJsonArray& children, int parent) {
+        for (const QJsonValue& value : children) {
+            if (isCanceled()) return;
+            const QJsonObject node = value.toObject();
+            const QString type = node.value("type").toString();
+            if (type == "folder") {
+                const int index = result.bookmarks.size();
+                result.bookmarks.append(makeFolder(parent, node.value("name").toString()));
+                addChildren(node.value("children").toArray(), index);
+            } else if (type == "url") {
+                const QString url = node.value("url").toString();
+                if (isImportableUrl(url)) {
+                    result.bookmarks.append(makeBookmark(parent, node.value("name").toString(), url));
+                }
+            }
+        }
+    };
+
+    const QJsonObject roots = doc.object().value("roots").toObject();
+    if (roots.isEmpty()) {
+        result.error = tr("%1 is not a Chrome bookmarks file.").arg(QFileInfo(path).fileName());
+        return false;
+    }
+    for (const char* key : {"bookmark_bar", "other", "synced"}) {
+        const QJsonObject root = roots.value(key).toObject();
+        const QJsonArray children = root.value("children").toArray();
+        if (children.isEmpty()) continue;
+        const int index = result.bookmarks.size();
+        result.bookmarks.append(makeFolder(0, root.value("name").toString()));
+        addChildren(children, index);
+    }
+    return true;
+}
+
+bool Importer::parseSqlite(const QString& path, Result& result)
+{
+    // Work on a copy: the owning browser keeps its database locked while running
+    QTemporaryDir tmp;
+    const QString copy = tmp.path() + "/import.sqlite";
+    if (!tmp.isValid() || !QFile::copy(path, copy)) {
+        result.error = tr("Cannot copy %1").arg(path);
+        return false;
+    }
+    if (QFile::exists(path + "-wal")) QFile::copy(path + "-wal", copy + "-wal");
+
+    const QString connection = QString("import-%1").arg(quintptr(this));
+    bool ok = true;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connection);
+        db.setDatabaseName(copy);
+        if (!db.open()) {
+            result.error = tr("Cannot open %1 as a database").arg(QFileInfo(path).fileName());
+            ok = false;
+        }
+        const QStringList tables = ok ? db.tables() : QStringList();
+        const bool firefox = tables.contains("moz_places");
+        if (ok && !firefox && !tables.contains("urls")) {
+            result.error = tr("%1 is not a Chrome or Firefox history database.").arg(QFileInfo(path).fileName());
+            ok = false;
+        }
+
+        if (ok) {
+            QSqlQuery count(db);
+            count.exec(firefox ? "SELECT COUNT(*) FROM moz_places" : "SELECT COUNT(*) FROM urls");
+            const qint64 total = count.next() ? count.value(0).toLongLong() : 0;
+
+            // Forward-only, so rows stream from SQLite instead of being cached
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.exec(firefox
+                ? "SELECT url, title, visit_count, last_visit_date FROM moz_places"
+                  " WHERE last_visit_date IS NOT NULL AND hidden = 0"
+                : "SELECT url, title, visit_count, last_visit_time FROM urls"
+                  " WHERE hidden = 0 AND last_visit_time > 0");
+            qint64 rows = 0;
+            while (query.next() && !isCanceled()) {
+                if ((++rows & 0x3FF) == 0) reportProgress(rows, total);
+                const QString url = query.value(0).toString();
+                if (!isImportableUrl(url)) continue;
+                const qint64 micros = query.value(3).toLongLong();
+                HistoryEntry e;
+                e.url = url;
+                e.title = query.value(1).toString();
+                e.visitCount = qMax(1, query.value(2).toInt());
+                e.timestamp = firefox ? micros / 1000 : micros / 1000 - CHROME_EPOCH_OFFSET_MS;
+                result.history.append(e);
+            }
+        }
+
+        if (ok && firefox && !isCanceled()) {
+            // Bookmarks live in the same database as a parent-linked table
+            struct Row { int id; int type; QString title; QString url; QString guid; };
+            QHash<int, QVector<Row>> children;
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.exec("SELECT b.id, b.parent, b.type, b.title, p.url, b.guid FROM moz_bookmarks b"
+                       " LEFT JOIN moz_places p ON p.id = b.fk ORDER BY b.parent, b.position");
+            int rootId = -1;
+            while (query.next()) {
+                const int parent = query.value(1).toInt();
+                Row row{query.value(0).toInt(), query.value(2).toInt(), query.value(3).toString(),
+                        query.value(4).toString(), query.value(5).toString()};
+                if (parent == 0) rootId = row.id;
+                children[parent].append(row);
+            }
+
+            const QHash<QString, QString> rootNames{
+                {"menu________", tr("Bookmarks Menu")},
+                {"toolbar_____", tr("Bookmarks Toolbar")},
+                {"unfiled_____", tr("Other Bookmarks")},
+                {"mobile______", tr("Mobile Bookmarks")}};
+            std::function<void(int, int)> addChildren = [&](int placesId, int parent) {
+                for (const Row& row : children.value(placesId)) {
+                    if (row.type == 2 && row.guid != "tags________") {
+                        const int index = result.bookmarks.size();
+                        result.bookmarks.append(makeFolder(parent, rootNames.value(row.guid, row.title)));
+                        addChildren(row.id, index);
+                    } else if (row.type == 1 && isImportableUrl(row.url)) {
+                        result.bookmarks.append(makeBookmark(parent, row.title, row.url));
+                    }
+                }
+            };
+            if (rootId >= 0) addChildren(rootId, 0);
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connection);
+    return ok;
+}
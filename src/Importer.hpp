@@ -0,0 +1,69 @@
+/**
+ * Importer - Brings bookmarks and history over from other browsers
+ *
+ * Supported inputs:
+ * - Netscape bookmark HTML (exported by every major browser), read in
+ *   chunks by a small streaming tag scanner
+ * - Chrome/Chromium "Bookmarks" JSON
+ * - Chrome/Chromium "History" and Firefox "places.sqlite" databases
+ *   (a copy is read, since the owning browser may hold a lock)
+ *
+ * Parsing runs on a worker thread with progress and cancellation; nothing
+ * touches the stores until it completes, then everything is committed in
+ * one batch per store, deduplicated against what is already there.
+ */
+
+#ifndef IMPORTER_HPP
+#define IMPORTER_HPP
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include "BookmarkStore.hpp"
+#include "HistoryStore.hpp"
+
+class Importer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Importer(QObject* parent = nullptr);
+    ~Importer();
+
+    // File dialog filter covering the supported formats
+    static QString fileFilter();
+
+    void start(const QString& path);
+    void cancel();
+    bool isRunning() const { return m_watcher.isRunning(); }
+
+signals:
+    void progress(int percent);
+    void finished(int bookmarksAdded, int historyImported);
+    void failed(const QString& error);
+    void canceled();
+
+private:
+    struct Result
+    {
+        QVector<BookmarkNode> bookmarks;    // parent = index within this vector
+        QVector<HistoryEntry> history;      // oldest-first, unique URLs
+        QString error;
+    };
+
+    Result run(const QString& path);
+    void reportProgress(qint64 done, qint64 total);
+    bool isCanceled() const { return m_cancel.load(std::memory_order_relaxed); }
+
+    bool parseNetscape(const QString& path, Result& result);
+    bool parseChromeBookmarks(const QString& path, Result& result);
+    bool parseSqlite(const QString& path, Result& result);
+
+    QFutureWatcher<Result> m_watcher;
+    std::atomic<bool> m_cancel{false};
+    std::atomic<int> m_lastPercent{-1};
+};
+
+#endif // IMPORTER_HPP
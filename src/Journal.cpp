@@ -0,0 +1,160 @@
+/**
+ * Journal implementation
+ */
+
+#include "Journal.hpp"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <array>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[4] = { 'A', 'B', 'J', '1' };
+const int HEADER_SIZE = 4;
+const int FRAME_SIZE = 8;                      // quint32 length + quint32 crc
+const quint32 MAX_RECORD_SIZE = 64 * 1024 * 1024;
+
+quint32 crc32(const char* data, int len)
+{
+    static const std::array<quint32, 256> table = [] {
+        std::array<quint32, 256> t{};
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    quint32 crc = 0xFFFFFFFFu;
+    for (int i = 0; i < len; ++i) {
+        crc = table[(crc ^ static_cast<uchar>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+} // namespace
+
+Journal::Journal(const QString& path)
+    : m_path(path)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+}
+
+Journal::~Journal()
+{
+    if (m_file.isOpen()) {
+        m_file.flush();
+        m_file.close();
+    }
+}
+
+int Journal::replay(const std::function<void(const QByteArray&)>& handler)
+{
+    if (m_file.isOpen()) m_file.close();
+
+    QFile in(m_path);
+    if (!in.open(QIODevice::ReadOnly)) return 0;
+
+    if (in.read(HEADER_SIZE) != QByteArray(MAGIC, HEADER_SIZE)) {
+        // Unknown or empty file: start over rather than misinterpret it
+        in.close();
+        QFile::remove(m_path);
+        return 0;
+    }
+
+    int count = 0;
+    qint64 good = HEADER_SIZE;
+    for (;;) {
+        const QByteArray header = in.read(FRAME_SIZE);
+        if (header.size() < FRAME_SIZE) break;
+        const quint32 len = qFromLittleEndian<quint32>(header.constData());
+        const quint32 crc = qFromLittleEndian<quint32>(header.constData() + 4);
+        if (len > MAX_RECORD_SIZE) break;
+        const QByteArray payload = in.read(len);
+        if (payload.size() != static_cast<int>(len)) break;
+        if (crc32(payload.constData(), payload.size()) != crc) break;
+        handler(payload);
+        good = in.pos();
+        ++count;
+    }
+
+    // Drop a torn tail so subsequent appends start on a record boundary
+    if (good < in.size()) {
+        in.close();
+        QFile::resize(m_path, good);
+    }
+    return count;
+}
+
+bool Journal::append(const QList<QByteArray>& records)
+{
+    if (records.isEmpty()) return true;
+    if (!m_file.isOpen() && !openForAppend()) return false;
+    const QByteArray data = frame(records);
+    if (m_file.write(data) != data.size()) return false;
+    return m_file.flush();
+}
+
+bool Journal::rewrite(const QList<QByteArray>& records)
+{
+    if (m_file.isOpen()) m_file.close();
+
+    QSaveFile out(m_path);
+    if (!out.open(QIODevice::WriteOnly)) return false;
+    out.write(MAGIC, HEADER_SIZE);
+    // Write in chunks so compaction of a large log doesn't build one huge buffer
+    const int CHUNK = 4096;
+    for (int i = 0; i < records.size(); i += CHUNK) {
+        out.write(frame(records.mid(i, CHUNK)));
+    }
+    return out.commit();
+}
+
+void Journal::sync()
+{
+    if (m_file.isOpen()) {
+        m_file.flush();
+        ::fdatasync(m_file.handle());
+    }
+}
+
+bool Journal::exists() const
+{
+    return QFile::exists(m_path);
+}
+
+qint64 Journal::size() const
+{
+    return QFileInfo(m_path).size();
+}
+
+bool Journal::openForAppend()
+{
+    m_file.setFileName(m_path);
+    const bool fresh = !m_file.exists() || QFileInfo(m_path).size() < HEADER_SIZE;
+    if (!m_file.open(fresh ? QIODevice::WriteOnly | QIODevice::Truncate
+                           : QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    if (fresh) m_file.write(MAGIC, HEADER_SIZE);
+    return true;
+}
+
+QByteArray Journal::frame(const QList<QByteArray>& records)
+{
+    int total = 0;
+    for (const QByteArray& r : records) total += FRAME_SIZE + r.size();
+    QByteArray out;
+    out.reserve(total);
+    char header[FRAME_SIZE];
+    for (const QByteArray& r : records) {
+        qToLittleEndian<quint32>(static_cast<quint32>(r.size()), header);
+        qToLittleEndian<quint32>(crc32(r.constData(), r.size()), header + 4);
+        out.append(header, FRAME_SIZE);
+        out.append(r);
+    }
+    return out;
+}
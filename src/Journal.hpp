@@ -0,0 +1,51 @@
+/**
+ * Journal - Append-only, checksummed record log on disk
+ *
+ * Each record is framed as [length][crc32][payload]. Replay stops at the
+ * first torn or corrupt record (e.g. after a crash mid-write) and truncates
+ * the file there, so the log is always left in a consistent state.
+ *
+ * Not thread-safe: a Journal is owned and used by a single worker thread.
+ */
+
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <functional>
+
+class Journal
+{
+public:
+    explicit Journal(const QString& path);
+    ~Journal();
+
+    // Reads every intact record in order. Returns the number replayed.
+    int replay(const std::function<void(const QByteArray&)>& handler);
+
+    // Appends records and flushes them to the OS in one write.
+    bool append(const QList<QByteArray>& records);
+    bool append(const QByteArray& record) { return append(QList<QByteArray>{record}); }
+
+    // Atomically replaces the whole log with the given records (compaction).
+    bool rewrite(const QList<QByteArray>& records);
+
+    // Forces written data to stable storage.
+    void sync();
+
+    bool exists() const;
+    qint64 size() const;
+    QString path() const { return m_path; }
+
+private:
+    bool openForAppend();
+    static QByteArray frame(const QList<QByteArray>& records);
+
+    QString m_path;
+    QFile m_file;
+};
+
+#endif // JOURNAL_HPP
@@ -5,7 +5,33 @@
 
 #include "MainWindow.hpp"
 #include "WebView.hpp"
+#include "WebPage.hpp"
 #include "FindBar.hpp"
+#include "BrowserData.hpp"
+#include "BookmarkStore.hpp"
+#include "HistoryStore.hpp"
+#include "OmniboxIndex.hpp"
+#include "PageTextIndex.hpp"
+#include "HistoryWindow.hpp"
+#include "TaskManager.hpp"
+#include "DownloadManager.hpp"
+#include "DownloadsWindow.hpp"
+#include "Importer.hpp"
+#include "SessionStore.hpp"
+#include "TabPlaceholder.hpp"
+#include "TabLifecycleManager.hpp"
+#include "WebViewPool.hpp"
+#include "Predictor.hpp"
+#include "AdBlocker.hpp"
+#include "ContentPolicy.hpp"
+#include "HttpsUpgrader.hpp"
+#include "ContainerManager.hpp"
+#include "CookieIndex.hpp"
+#include "NewTabPage.hpp"
+#include "PerformanceProfile.hpp"
+#include "ThumbnailCache.hpp"
+#include "StorageManager.hpp"
+#include "Settings.hpp"
 #include <QWebEngineProfile>
 #include <QWebEngineHistory>
 #include <QWebEnginePage>
@@ -16,9 +42,7 @@
 #include <QStatusBar>
 #include <QFileDialog>
 #include <QFileInfo>
-#include <QStandardPaths>
 #include <QRegularExpression>
-#include <QSettings>
 #include <QVBoxLayout>
 #include <QKeySequence>
 #include <QShortcut>
@@ -32,19 +56,174 @@
 #include <QWebEngineCookieStore>
 #include <QLabel>
 #include <QComboBox>
+#include <QSpinBox>
+#include <QPlainTextEdit>
+#include <QCheckBox>
+#include <QCompleter>
+#include <QStandardItemModel>
+#include <QAbstractItemView>
+#include <QTimer>
+#include <QIcon>
+#include <QPainter>
+#include <QPixmap>
+#include <QTreeWidget>
+#include <QInputDialog>
+#include <QProgressDialog>
+#include <QDir>
+#include <QApplication>
+#include <QCloseEvent>
+#include <functional>
+
+namespace {
+
+const char* const TAB_ID_PROPERTY = "tabId";
+const int SESSION_SAVE_DELAY_MS = 1000;
+const int BACKGROUND_LOAD_SLOTS = 3;
+
+// "immediate" (default) or "onSelect"
+bool deferBackgroundTabs()
+{
+    return Settings::instance()->value("backgroundTabLoading", "immediate").toString() == "onSelect";
+}
+
+// Short enough for the tab bar
+QString tabTitle(const QString& title)
+{
+    if (title.isEmpty()) return MainWindow::tr("New Tab");
+    return title.length() > 30 ? title.left(27) + "..." : title;
+}
+
+// The new tab page leaves the address bar empty, ready for typing
+QString addressBarText(const QUrl& url)
+{
+    return url.toString() == QLatin1String(NewTabPage::URL) ? QString() : url.toString();
+}
+
+// Theme star if there is one, otherwise the glyph drawn into a pixmap
+QIcon starIcon(bool filled)
+{
+    const QString name = filled ? "starred" : "non-starred";
+    if (QIcon::hasThemeIcon(name)) return QIcon::fromTheme(name);
+    QPixmap pixmap(16, 16);
+    pixmap.fill(Qt::transparent);
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::TextAntialiasing);
+    painter.setPen(filled ? QColor(0xe0, 0xa0, 0x00) : QColor(Qt::gray));
+    painter.drawText(pixmap.rect(), Qt::AlignCenter, filled ? QStringLiteral("\u2605") : QStringLiteral("\u2606"));
+    return QIcon(pixmap);
+}
+
+// Badge with the number of requests blocked on the page; grey when the
+// site is allowlisted
+QIcon blockedIcon(int count, bool active)
+{
+    QPixmap pixmap(16, 16);
+    pixmap.fill(Qt::transparent);
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(active ? QColor(0xd0, 0x40, 0x30) : QColor(Qt::gray));
+    painter.drawRoundedRect(QRectF(0.5, 2.5, 15, 11), 3, 3);
+    QFont font = painter.font();
+    font.setPixelSize(count > 99 ? 7 : 9);
+    font.setBold(true);
+    painter.setFont(font);
+    painter.setPen(Qt::white);
+    painter.drawText(pixmap.rect(), Qt::AlignCenter, count > 99 ? QStringLiteral("99+") : QString::number(count));
+    return QIcon(pixmap);
+}
+
+QIcon pinIcon()
+{
+    if (QIcon::hasThemeIcon("pin")) return QIcon::fromTheme("pin");
+    QPixmap pixmap(16, 16);
+    pixmap.fill(Qt::transparent);
+    QPainter painter(&pixmap);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(0x40, 0x80, 0xd0));
+    painter.drawEllipse(QRectF(4, 4, 8, 8));
+    return QIcon(pixmap);
+}
+
+} // namespace
+
+MainWindow::MainWindow(const QString& urlOrSearch, const QString& container, QWidget* parent)
+    : QMainWindow(parent)
+    , m_windowId(BrowserData::instance()->session()->newWindowId())
+    , m_container(container)
+{
+    init();
+    const QString target = urlOrSearch.isEmpty() ? Settings::instance()->homePage() : urlOrSearch;
+    addTab(QUrl(validateAndNormalizeUrl(target)));
+}
+
+MainWindow::MainWindow(NoTab, const QString& container, QWidget* parent)
+    : QMainWindow(parent)
+    , m_windowId(BrowserData::instance()->session()->newWindowId())
+    , m_container(container)
+{
+    init();
+}
 
-MainWindow::MainWindow(QWidget* parent)
+MainWindow::MainWindow(const WindowState& state, const QString& urlOrSearch, QWidget* parent)
     : QMainWindow(parent)
+    , m_windowId(state.id)
+    , m_container(state.container)
+{
+    init();
+    restoreGeometry(state.geometry);
+
+    // Placeholders only; signals are held so none of them becomes current
+    // (and loads) on the way in
+    SessionStore* session = BrowserData::instance()->session();
+    m_tabWidget->blockSignals(true);
+    for (int tabId : state.tabs) addPlaceholderTab(tabId, session->tab(tabId));
+    m_tabWidget->setCurrentIndex(state.current);
+    m_tabWidget->blockSignals(false);
+    if (urlOrSearch.isEmpty()) {
+        onTabChanged(m_tabWidget->currentIndex());
+    } else {
+        openInNewTab(urlOrSearch);
+    }
+}
+
+MainWindow* MainWindow::restoreSession(const QString& urlOrSearch)
 {
-    setWindowTitle("Arch Browser");
+    const QVector<WindowState> windows = BrowserData::instance()->session()->windows();
+    MainWindow* last = nullptr;
+    for (int i = 0; i < windows.size(); ++i) {
+        last = new MainWindow(windows.at(i), i == windows.size() - 1 ? urlOrSearch : QString());
+        last->show();
+    }
+    return last;
+}
+
+void MainWindow::init()
+{
+    // Held for as long as this window exists; a container removed since the
+    // session was saved falls back to the default profile
+    ContainerManager* containers = ContainerManager::instance();
+    if (!containers->contains(m_container)) m_container.clear();
+    m_profile = containers->acquire(m_container, this);
+    const ContainerManager::Container container = containers->container(m_container);
+    m_offTheRecord = container.offTheRecord;
+    setWindowTitle(container.name.isEmpty() ? QString("Arch Browser") : tr("Arch Browser \u2014 %1").arg(container.name));
+    setAttribute(Qt::WA_DeleteOnClose);
     resize(1200, 800);
 
     // Menu bar
     QMenuBar* menuBar = this->menuBar();
     QMenu* fileMenu = menuBar->addMenu(tr("&File"));
     fileMenu->addAction(tr("New &Window"), this, &MainWindow::onNewWindow, QKeySequence::New);
+    fileMenu->addAction(tr("New &Off-the-Record Window"), this, &MainWindow::onNewOffTheRecordWindow,
+                        QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_N));
+    QMenu* containerMenu = fileMenu->addMenu(tr("New Window in &Container"));
+    connect(containerMenu, &QMenu::aboutToShow, this, [this, containerMenu]() { populateContainerMenu(containerMenu); });
     QAction* newTabAction = fileMenu->addAction(tr("New &Tab"), this, &MainWindow::onNewTab, QKeySequence(Qt::CTRL | Qt::Key_T));
     fileMenu->addSeparator();
+    fileMenu->addAction(tr("&Import Bookmarks and History..."), this, &MainWindow::onImport);
+    fileMenu->addSeparator();
     fileMenu->addAction(tr("E&xit"), this, &QWidget::close, QKeySequence::Quit);
 
     QMenu* editMenu = menuBar->addMenu(tr("&Edit"));
@@ -52,7 +231,24 @@ MainWindow::MainWindow(QWidget* parent)
     editMenu->addAction(tr("Zoom &In"), this, &MainWindow::onZoomIn, QKeySequence::ZoomIn);
     editMenu->addAction(tr("Zoom &Out"), this, &MainWindow::onZoomOut, QKeySequence::ZoomOut);
     editMenu->addAction(tr("Zoom &Reset"), this, &MainWindow::onZoomReset, QKeySequence(Qt::CTRL | Qt::Key_0));
+    QAction* liteAction = editMenu->addAction(tr("&Lite Mode for This Site"));
+    liteAction->setCheckable(true);
+    connect(liteAction, &QAction::triggered, this, [this](bool on) {
+        WebView* view = currentWebView();
+        if (!view || view->url().host().isEmpty()) return;
+        ContentPolicy::instance()->setLite(view->url().host(), on);
+        // Settings are applied per navigation
+        view->reload();
+    });
+    connect(editMenu, &QMenu::aboutToShow, this, [this, liteAction]() {
+        WebView* view = currentWebView();
+        const QString host = view ? view->url().host() : QString();
+        liteAction->setEnabled(!host.isEmpty());
+        liteAction->setChecked(!host.isEmpty() && ContentPolicy::instance()->policyFor(host).lite);
+    });
     editMenu->addSeparator();
+    editMenu->addAction(tr("&Downloads"), this, &MainWindow::onShowDownloads, QKeySequence(Qt::CTRL | Qt::Key_J));
+    editMenu->addAction(tr("&Task Manager"), this, &MainWindow::onShowTaskManager, QKeySequence(Qt::SHIFT | Qt::Key_Escape));
     editMenu->addAction(tr("&Settings..."), this, &MainWindow::onOpenSettings, QKeySequence(Qt::CTRL | Qt::Key_Comma));
 
     m_bookmarksMenu = menuBar->addMenu(tr("&Bookmarks"));
@@ -64,12 +260,31 @@ MainWindow::MainWindow(QWidget* parent)
 
     QMenu* historyMenu = menuBar->addMenu(tr("&History"));
     historyMenu->addAction(tr("Show &History"), this, &MainWindow::onShowHistory, QKeySequence(Qt::CTRL | Qt::Key_H));
+    historyMenu->addAction(tr("&Search Page Contents..."), this, &MainWindow::onSearchPageContents, QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_H));
     historyMenu->addAction(tr("Reopen Closed &Tab"), this, &MainWindow::onReopenClosedTab, QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_T));
     historyMenu->addAction(tr("&Clear History"), this, &MainWindow::onClearHistory);
 
-    loadBookmarks();
-    loadHistory();
-    rebuildBookmarksMenu();
+    // Bookmarks and history are loaded once per process and shared by all windows.
+    // Folder menus are filled when opened; edits only mark the folder stale.
+    BookmarkStore* bookmarks = BrowserData::instance()->bookmarks();
+    connect(bookmarks, &BookmarkStore::nodeAdded, this, &MainWindow::markBookmarkFolderStale);
+    connect(bookmarks, &BookmarkStore::nodeRemoved, this, &MainWindow::markBookmarkFolderStale);
+    connect(bookmarks, &BookmarkStore::nodeChanged, this, [this](int id) {
+        markBookmarkFolderStale(BrowserData::instance()->bookmarks()->node(id).parent);
+    });
+    connect(bookmarks, &BookmarkStore::reset, this, [this]() {
+        markBookmarkFolderStale(BookmarkStore::ROOT_ID);
+        updateBookmarkStar();
+    });
+    connect(bookmarks, &BookmarkStore::urlBookmarkedChanged, this, &MainWindow::updateBookmarkStar);
+    connect(m_bookmarksMenu, &QMenu::aboutToShow, this, [this]() {
+        // Normally loaded by now; if not, this marks the menu stale
+        BrowserData::instance()->bookmarks()->load();
+        if (m_staleBookmarkMenus.contains(BookmarkStore::ROOT_ID)) {
+            populateBookmarkMenu(m_bookmarksMenu, BookmarkStore::ROOT_ID);
+        }
+    });
+    m_staleBookmarkMenus.insert(BookmarkStore::ROOT_ID);
 
     // Toolbar
     m_toolbar = addToolBar(tr("Navigation"));
@@ -107,6 +322,46 @@ MainWindow::MainWindow(QWidget* parent)
     connect(m_addressBar, &QLineEdit::returnPressed, this, &MainWindow::onAddressBarReturnPressed);
     m_toolbar->addWidget(m_addressBar);
 
+    // Star: shows whether the current page is bookmarked, click to toggle
+    m_starOn = starIcon(true);
+    m_starOff = starIcon(false);
+    m_bookmarkStar = new QAction(m_starOff, tr("Bookmark this page"), this);
+    m_addressBar->addAction(m_bookmarkStar, QLineEdit::TrailingPosition);
+    connect(m_bookmarkStar, &QAction::triggered, this, [this]() {
+        WebView* view = currentWebView();
+        if (!view) return;
+        if (BrowserData::instance()->bookmarks()->isBookmarked(view->url().toString())) {
+            onRemoveBookmark();
+        } else {
+            onAddBookmark();
+        }
+    });
+
+    // Blocked requests on the current page; click to allow or block the site
+    m_adBlockAction = new QAction(this);
+    m_adBlockAction->setVisible(false);
+    m_addressBar->addAction(m_adBlockAction, QLineEdit::TrailingPosition);
+    connect(m_adBlockAction, &QAction::triggered, this, [this]() {
+        WebView* view = currentWebView();
+        if (!view || view->url().host().isEmpty()) return;
+        AdBlocker* blocker = AdBlocker::instance();
+        const QString host = view->url().host();
+        blocker->setAllowlisted(host, !blocker->isAllowlisted(host));
+        view->reload();
+    });
+    connect(AdBlocker::instance(), &AdBlocker::allowlistChanged, this, &MainWindow::updateAdBlockAction);
+
+    // Completion popup: rows are ranked by OmniboxIndex, not filtered by QCompleter
+    m_completionModel = new QStandardItemModel(this);
+    m_completer = new QCompleter(m_completionModel, this);
+    m_completer->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    m_completer->setCompletionRole(Qt::UserRole);
+    m_completer->setMaxVisibleItems(MAX_COMPLETIONS);
+    m_addressBar->setCompleter(m_completer);
+    connect(m_addressBar, &QLineEdit::textEdited, this, &MainWindow::onAddressBarEdited);
+    connect(m_completer, QOverload<const QModelIndex&>::of(&QCompleter::activated),
+            this, &MainWindow::onCompletionActivated);
+
     QAction* goAction = m_toolbar->addAction(tr("Go"));
     connect(goAction, &QAction::triggered, this, &MainWindow::onGoClicked);
 
@@ -131,6 +386,9 @@ MainWindow::MainWindow(QWidget* parent)
     m_tabWidget->setDocumentMode(true);
     connect(m_tabWidget, &QTabWidget::tabCloseRequested, this, &MainWindow::onCloseTab);
     connect(m_tabWidget, &QTabWidget::currentChanged, this, &MainWindow::onTabChanged);
+    m_tabWidget->tabBar()->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(m_tabWidget->tabBar(), &QTabBar::customContextMenuRequested,
+            this, &MainWindow::onTabContextMenu);
     centralLayout->addWidget(m_tabWidget);
 
     m_findBar = new FindBar(this);
@@ -149,17 +407,62 @@ MainWindow::MainWindow(QWidget* parent)
     auto* shortcutAddressBar = new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_L), this);
     connect(shortcutAddressBar, &QShortcut::activated, this, [this]() { m_addressBar->setFocus(); m_addressBar->selectAll(); });
 
-    // Add first tab
-    addTab(QUrl("https://google.com"));
-
-    // Connect download handler once (default profile is shared across all tabs)
-    connect(QWebEngineProfile::defaultProfile(), &QWebEngineProfile::downloadRequested,
-            this, &MainWindow::onDownloadRequested);
+    // Session state is written shortly after changes settle, not per event
+    m_sessionTimer.setSingleShot(true);
+    m_sessionTimer.setInterval(SESSION_SAVE_DELAY_MS);
+    connect(&m_sessionTimer, &QTimer::timeout, this, &MainWindow::saveSession);
+
+    connect(TabLifecycleManager::instance(), &TabLifecycleManager::discardRequested,
+            this, &MainWindow::discardTab);
+
+    // DownloadManager handles every window's downloads; only the window
+    // in front mentions them
+    DownloadManager* downloads = DownloadManager::instance();
+    connect(downloads, &DownloadManager::added, this, [this, downloads](int id) {
+        if (!isActiveWindow()) return;
+        const QString name = QFileInfo(downloads->entry(id).path).fileName();
+        statusBar()->showMessage(tr("Downloading %1 (Ctrl+J to show downloads)").arg(name), 3000);
+    });
+    connect(downloads, &DownloadManager::stateChanged, this, [this, downloads](int id) {
+        if (!isActiveWindow()) return;
+        const DownloadManager::Entry entry = downloads->entry(id);
+        const QString name = QFileInfo(entry.path).fileName();
+        if (entry.state == DownloadManager::Completed) {
+            statusBar()->showMessage(tr("Download finished: %1").arg(name), 3000);
+        } else if (entry.state == DownloadManager::Failed) {
+            statusBar()->showMessage(tr("Download failed: %1").arg(name), 3000);
+        }
+    });
 
 }
 
 MainWindow::~MainWindow()
 {
+    // Tab views are deleted after our members; their destroyed() must not
+    // reach startBackgroundLoad's handler by then
+    for (QWebEngineView* view : findChildren<QWebEngineView*>()) {
+        disconnect(view, &QObject::destroyed, this, nullptr);
+    }
+}
+
+void MainWindow::closeEvent(QCloseEvent* event)
+{
+    m_windowDirty = true;
+    saveSession();
+    // Closing the last window quits the browser: keep it for next start.
+    // Closing one of several means the user is done with it.
+    for (QWidget* w : QApplication::topLevelWidgets()) {
+        if (w != this && w->isVisible() && qobject_cast<MainWindow*>(w)) {
+            BrowserData::instance()->session()->removeWindow(m_windowId);
+            break;
+        }
+    }
+    QMainWindow::closeEvent(event);
+}
+
+void MainWindow::openInNewTab(const QString& urlOrSearch)
+{
+    addTab(QUrl(validateAndNormalizeUrl(urlOrSearch)));
 }
 
 void MainWindow::navigateTo(const QString& urlOrSearch)
@@ -167,57 +470,168 @@ void MainWindow::navigateTo(const QString& urlOrSearch)
     WebView* view = currentWebView();
     if (view) {
         QString url = validateAndNormalizeUrl(urlOrSearch);
+        // A prerendered page may only replace a tab with no page to go back
+        // to; prerenders live in the default profile
+        const bool empty = view->history()->count() == 0 || view->url() == QUrl(QStringLiteral("about:blank"))
+                           || view->url() == QUrl(NewTabPage::URL);
+        if (m_container.isEmpty() && empty && adoptPrerender(m_tabWidget->currentIndex(), QUrl(url))) {
+            return;
+        }
         view->setUrl(QUrl(url));
-        m_addressBar->setText(url);
+        m_addressBar->setText(addressBarText(QUrl(url)));
     }
 }
 
+bool MainWindow::adoptPrerender(int index, const QUrl& url)
+{
+    const Predictor::Prerender prerender = Predictor::instance()->take(url);
+    if (!prerender.view) return false;
+
+    QWidget* old = m_tabWidget->widget(index);
+    WebView* view = setUpWebView(prerender.view, tabIdOf(old));
+    view->setProperty(TabLifecycleManager::PINNED_PROPERTY, old->property(TabLifecycleManager::PINNED_PROPERTY));
+    replaceTabWidget(index, view);
+    old->deleteLater();
+    m_tabWidget->setTabText(index, tabTitle(view->title()));
+    if (m_tabWidget->currentIndex() == index) onTabChanged(index);
+    markTabDirty(view);
+    // Its load finished while nobody was listening
+    if (prerender.loaded) {
+        onPageLoadedForHistory(view->url(), view->title());
+        indexPageText(view);
+        BrowserData::instance()->thumbnails()->capture(view);
+    }
+    return true;
+}
+
 void MainWindow::onNewWindow()
 {
     MainWindow* win = new MainWindow();
     win->show();
 }
 
+void MainWindow::onNewOffTheRecordWindow()
+{
+    MainWindow* win = new MainWindow(QString(), ContainerManager::instance()->createOffTheRecord());
+    win->show();
+}
+
+void MainWindow::populateContainerMenu(QMenu* menu)
+{
+    menu->clear();
+    ContainerManager* containers = ContainerManager::instance();
+    for (const ContainerManager::Container& c : containers->containers()) {
+        const QString id = c.id;
+        menu->addAction(c.name, this, [id]() {
+            MainWindow* win = new MainWindow(QString(), id);
+            win->show();
+        });
+    }
+    if (!containers->containers().isEmpty()) menu->addSeparator();
+
+    menu->addAction(tr("&New Container..."), this, [this]() {
+        bool ok = false;
+        const QString name = QInputDialog::getText(this, tr("New Container"), tr("Name:"),
+                                                   QLineEdit::Normal, QString(), &ok).trimmed();
+        if (!ok || name.isEmpty()) return;
+        const int cacheMB = QInputDialog::getInt(this, tr("New Container"),
+                                                 tr("Disk cache size in MB (0 for automatic):"), 0, 0, 10240, 64, &ok);
+        if (!ok) return;
+        MainWindow* win = new MainWindow(QString(), ContainerManager::instance()->createContainer(name, cacheMB));
+        win->show();
+    });
+
+    // Only containers with no open window; their profile must be unloaded
+    QStringList removable;
+    QStringList removableIds;
+    for (const ContainerManager::Container& c : containers->containers()) {
+        if (containers->isInUse(c.id)) continue;
+        removable.append(c.name);
+        removableIds.append(c.id);
+    }
+    QAction* removeAction = menu->addAction(tr("&Remove Container..."), this, [this, removable, removableIds]() {
+        bool ok = false;
+        const QString name = QInputDialog::getItem(this, tr("Remove Container"), tr("Container:"),
+                                                   removable, 0, false, &ok);
+        if (!ok) return;
+        if (QMessageBox::question(this, tr("Remove Container"),
+                                  tr("Delete %1 with its cookies, site data and cache?").arg(name)) != QMessageBox::Yes) {
+            return;
+        }
+        ContainerManager::instance()->removeContainer(removableIds.value(removable.indexOf(name)));
+    });
+    removeAction->setEnabled(!removable.isEmpty());
+}
+
 void MainWindow::onNewTab()
 {
-    addTab(QUrl("https://google.com"));
+    if (!Settings::instance()->newTabPage()) {
+        openInNewTab(Settings::instance()->homePage());
+        return;
+    }
+    addTab(QUrl(NewTabPage::URL));
+    m_addressBar->setFocus();
 }
 
 void MainWindow::onCloseTab(int index)
 {
     if (m_tabWidget->count() > 1) {
         QWidget* w = m_tabWidget->widget(index);
-        if (WebView* view = qobject_cast<WebView*>(w)) {
-            const QUrl url = view->url();
-            if (!url.isEmpty() && url.toString() != "about:blank") {
-                m_closedTabs.prepend(url);
-                const int MAX_CLOSED_TABS = 10;
-                while (m_closedTabs.size() > MAX_CLOSED_TABS) {
-                    m_closedTabs.removeLast();
-                }
-            }
+        SessionStore* session = BrowserData::instance()->session();
+        const TabState state = tabStateOf(w);
+        if (!m_offTheRecord && !state.url.isEmpty() && state.url.toString() != "about:blank") {
+            session->pushClosedTab(state);
         }
+        const int tabId = tabIdOf(w);
+        session->removeTab(tabId);
+        m_dirtyTabs.remove(tabId);
         m_tabWidget->removeTab(index);
         w->deleteLater();
+        markWindowDirty();
     }
 }
 
 void MainWindow::onTabChanged(int index)
 {
     if (index >= 0) {
+        materializeTab(index);
+        markWindowDirty();
         WebView* view = currentWebView();
         if (view) {
-            m_addressBar->setText(view->url().toString());
+            TabLifecycleManager::instance()->noteActivated(view);
+            m_addressBar->setText(addressBarText(view->url()));
             m_findBar->setWebView(view);
             updateNavigationButtons();
+            updateBookmarkStar();
+            updateAdBlockAction();
         }
     }
 }
 
+void MainWindow::onTabContextMenu(const QPoint& pos)
+{
+    const int index = m_tabWidget->tabBar()->tabAt(pos);
+    if (index < 0) return;
+    const bool pinned = m_tabWidget->widget(index)->property(TabLifecycleManager::PINNED_PROPERTY).toBool();
+
+    QMenu menu(this);
+    QAction* pinAction = menu.addAction(pinned ? tr("Unpin Tab") : tr("Pin Tab"));
+    QAction* closeAction = menu.addAction(tr("Close Tab"));
+    closeAction->setEnabled(m_tabWidget->count() > 1);
+    QAction* chosen = menu.exec(m_tabWidget->tabBar()->mapToGlobal(pos));
+    if (chosen == pinAction) {
+        setTabPinned(index, !pinned);
+    } else if (chosen == closeAction) {
+        onCloseTab(index);
+    }
+}
+
 void MainWindow::onCurrentViewUrlChanged(const QUrl& url)
 {
     if (sender() == currentWebView()) {
-        m_addressBar->setText(url.toString());
+        m_addressBar->setText(addressBarText(url));
+        updateBookmarkStar();
+        updateAdBlockAction();
     }
 }
 
@@ -227,11 +641,7 @@ void MainWindow::onCurrentViewTitleChanged(const QString& title)
     if (view) {
         int idx = m_tabWidget->indexOf(view);
         if (idx >= 0) {
-            QString tabTitle = title.isEmpty() ? tr("New Tab") : title;
-            if (tabTitle.length() > 30) {
-                tabTitle = tabTitle.left(27) + "...";
-            }
-            m_tabWidget->setTabText(idx, tabTitle);
+            m_tabWidget->setTabText(idx, tabTitle(title));
         }
     }
 }
@@ -251,12 +661,46 @@ void MainWindow::onGoClicked()
 
 void MainWindow::onAddressBarReturnPressed()
 {
+    // Choosing a completion already navigated
+    if (m_completionActivated) return;
     QString input = m_addressBar->text().trimmed();
     if (!input.isEmpty()) {
         navigateTo(input);
     }
 }
 
+void MainWindow::onAddressBarEdited(const QString& text)
+{
+    const QVector<OmniboxIndex::Match> matches =
+        BrowserData::instance()->omnibox()->query(text, MAX_COMPLETIONS);
+    if (m_container.isEmpty()) Predictor::instance()->predictTyped(text, matches);
+    m_completionModel->clear();
+    for (const OmniboxIndex::Match& m : matches) {
+        QStandardItem* item = new QStandardItem(
+            m.title.isEmpty() ? m.url : (m.title + " \u2014 " + m.url));
+        item->setData(m.url, Qt::UserRole);
+        if (m.bookmarked) item->setIcon(QIcon::fromTheme("bookmark-new"));
+        m_completionModel->appendRow(item);
+    }
+    if (matches.isEmpty()) {
+        m_completer->popup()->hide();
+    } else {
+        m_completer->complete();
+    }
+}
+
+void MainWindow::onCompletionActivated(const QModelIndex& index)
+{
+    const QString url = index.data(Qt::UserRole).toString();
+    if (url.isEmpty()) return;
+    // The popup may also forward Return to the line edit; navigate only once
+    m_completionActivated = true;
+    QTimer::singleShot(0, this, [this, url]() {
+        m_completionActivated = false;
+        navigateTo(url);
+    });
+}
+
 void MainWindow::onBackClicked()
 {
     WebView* view = currentWebView();
@@ -291,9 +735,7 @@ void MainWindow::onStopClicked()
 
 void MainWindow::onHomeClicked()
 {
-    QSettings settings("ArchBrowser", "arch-browser");
-    QString home = settings.value("homePage", "https://google.com").toString();
-    navigateTo(home);
+    navigateTo(Settings::instance()->homePage());
 }
 
 void MainWindow::onFindInPage()
@@ -334,10 +776,13 @@ void MainWindow::onAddBookmark()
     if (!view) return;
     QUrl url = view->url();
     if (url.isEmpty() || url.scheme().isEmpty()) return;
+    BookmarkStore* store = BrowserData::instance()->bookmarks();
+    if (store->isBookmarked(url.toString())) {
+        statusBar()->showMessage(tr("Already bookmarked"), 2000);
+        return;
+    }
     QString title = view->title().isEmpty() ? url.host() : view->title();
-    m_bookmarks.append({title, url.toString()});
-    saveBookmarks();
-    rebuildBookmarksMenu();
+    store->addBookmark(BookmarkStore::ROOT_ID, title, url.toString());
     statusBar()->showMessage(tr("Bookmarked: %1").arg(title), 2000);
 }
 
@@ -347,61 +792,178 @@ void MainWindow::onRemoveBookmark()
     if (!view) return;
     QString url = view->url().toString();
     if (url.isEmpty()) return;
-    for (int i = 0; i < m_bookmarks.size(); ++i) {
-        if (m_bookmarks[i].url == url) {
-            m_bookmarks.removeAt(i);
-            saveBookmarks();
-            rebuildBookmarksMenu();
-            statusBar()->showMessage(tr("Bookmark removed"), 2000);
-            return;
-        }
+    BookmarkStore* store = BrowserData::instance()->bookmarks();
+    if (store->isBookmarked(url)) {
+        store->removeUrl(url);
+        statusBar()->showMessage(tr("Bookmark removed"), 2000);
+        return;
     }
     statusBar()->showMessage(tr("Current page is not bookmarked"), 2000);
 }
 
 void MainWindow::onManageBookmarks()
 {
+    BookmarkStore* store = BrowserData::instance()->bookmarks();
+    store->load();
     QDialog dlg(this);
     dlg.setWindowTitle(tr("Manage Bookmarks"));
-    dlg.setMinimumSize(450, 300);
+    dlg.setMinimumSize(550, 400);
 
     QVBoxLayout* layout = new QVBoxLayout(&dlg);
-    QListWidget* list = new QListWidget(&dlg);
-    for (int i = 0; i < m_bookmarks.size(); ++i) {
-        QListWidgetItem* item = new QListWidgetItem(
-            m_bookmarks[i].title + " \u2014 " + m_bookmarks[i].url);
-        item->setData(Qt::UserRole, i);
-        list->addItem(item);
-    }
+    QTreeWidget* tree = new QTreeWidget(&dlg);
+    tree->setHeaderLabels({tr("Title"), tr("URL")});
+    tree->setUniformRowHeights(true);
+    tree->setColumnWidth(0, 240);
+
+    // Folder contents are only turned into items when the folder is expanded
+    const int idRole = Qt::UserRole;
+    const int filledRole = Qt::UserRole + 1;
+    auto makeItem = [store, idRole](int id) {
+        const BookmarkNode n = store->node(id);
+        QTreeWidgetItem* item = new QTreeWidgetItem({n.title, n.url});
+        item->setData(0, idRole, id);
+        if (n.folder) {
+            item->setIcon(0, QIcon::fromTheme("folder"));
+            item->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+        }
+        return item;
+    };
+    auto fill = [&](QTreeWidgetItem* parent) {
+        const int folderId = parent ? parent->data(0, idRole).toInt() : BookmarkStore::ROOT_ID;
+        QList<QTreeWidgetItem*> items;
+        for (int id : store->children(folderId)) items.append(makeItem(id));
+        if (parent) {
+            parent->addChildren(items);
+            parent->setData(0, filledRole, true);
+        } else {
+            tree->addTopLevelItems(items);
+        }
+    };
+    fill(nullptr);
+    connect(tree, &QTreeWidget::itemExpanded, &dlg, [&](QTreeWidgetItem* item) {
+        if (!item->data(0, filledRole).toBool()) fill(item);
+    });
+
+    // New items go into the selected folder, or next to the selected bookmark
+    auto targetFolder = [&]() -> QTreeWidgetItem* {
+        QTreeWidgetItem* cur = tree->currentItem();
+        if (!cur) return nullptr;
+        if (store->node(cur->data(0, idRole).toInt()).folder) return cur;
+        return cur->parent();
+    };
 
     QHBoxLayout* btnLayout = new QHBoxLayout();
+    QPushButton* folderBtn = new QPushButton(tr("New &Folder..."), &dlg);
+    QPushButton* renameBtn = new QPushButton(tr("&Rename..."), &dlg);
+    QPushButton* moveBtn = new QPushButton(tr("&Move To..."), &dlg);
     QPushButton* deleteBtn = new QPushButton(tr("&Delete"), &dlg);
     QPushButton* closeBtn = new QPushButton(tr("&Close"), &dlg);
     closeBtn->setDefault(true);
+    btnLayout->addWidget(folderBtn);
+    btnLayout->addWidget(renameBtn);
+    btnLayout->addWidget(moveBtn);
     btnLayout->addWidget(deleteBtn);
     btnLayout->addStretch();
     btnLayout->addWidget(closeBtn);
 
-    layout->addWidget(list);
+    layout->addWidget(tree);
     layout->addLayout(btnLayout);
 
-    connect(deleteBtn, &QPushButton::clicked, &dlg, [&]() {
-        QListWidgetItem* cur = list->currentItem();
+    connect(folderBtn, &QPushButton::clicked, &dlg, [&]() {
+        const QString name = QInputDialog::getText(&dlg, tr("New Folder"), tr("Folder name:"));
+        if (name.trimmed().isEmpty()) return;
+        QTreeWidgetItem* parent = targetFolder();
+        const int parentId = parent ? parent->data(0, idRole).toInt() : BookmarkStore::ROOT_ID;
+        const int id = store->addFolder(parentId, name.trimmed());
+        if (id < 0) return;
+        if (!parent) {
+            tree->addTopLevelItem(makeItem(id));
+        } else if (parent->data(0, filledRole).toBool()) {
+            parent->addChild(makeItem(id));
+        }
+    });
+    connect(renameBtn, &QPushButton::clicked, &dlg, [&]() {
+        QTreeWidgetItem* cur = tree->currentItem();
         if (!cur) return;
-        int idx = cur->data(Qt::UserRole).toInt();
-        m_bookmarks.removeAt(idx);
-        delete list->takeItem(list->row(cur));
-        saveBookmarks();
-        rebuildBookmarksMenu();
-        for (int i = 0; i < list->count(); ++i) {
-            list->item(i)->setData(Qt::UserRole, i);
+        bool ok = false;
+        const QString name = QInputDialog::getText(&dlg, tr("Rename"), tr("Title:"),
+                                                   QLineEdit::Normal, cur->text(0), &ok);
+        if (!ok) return;
+        store->setTitle(cur->data(0, idRole).toInt(), name);
+        cur->setText(0, name);
+    });
+    connect(moveBtn, &QPushButton::clicked, &dlg, [&]() {
+        QTreeWidgetItem* cur = tree->currentItem();
+        if (!cur) return;
+        // Folders are few even when bookmarks aren't, so list them all
+        QStringList paths{tr("Bookmarks")};
+        QVector<int> ids{BookmarkStore::ROOT_ID};
+        std::function<void(int, const QString&)> walk = [&](int folderId, const QString& prefix) {
+            for (int id : store->children(folderId)) {
+                const BookmarkNode n = store->node(id);
+                if (!n.folder) continue;
+                paths.append(prefix + "/" + n.title);
+                ids.append(id);
+                walk(id, paths.last());
+            }
+        };
+        walk(BookmarkStore::ROOT_ID, paths.first());
+        bool ok = false;
+        const QString choice = QInputDialog::getItem(&dlg, tr("Move To"), tr("Folder:"), paths, 0, false, &ok);
+        if (!ok) return;
+        if (!store->move(cur->data(0, idRole).toInt(), ids.at(paths.indexOf(choice)))) {
+            QMessageBox::warning(&dlg, tr("Move To"), tr("A folder can't be moved into itself."));
+            return;
         }
+        tree->clear();
+        fill(nullptr);
+    });
+    connect(deleteBtn, &QPushButton::clicked, &dlg, [&]() {
+        QTreeWidgetItem* cur = tree->currentItem();
+        if (!cur) return;
+        store->remove(cur->data(0, idRole).toInt());
+        delete cur;
     });
     connect(closeBtn, &QPushButton::clicked, &dlg, &QDialog::accept);
 
     dlg.exec();
 }
 
+void MainWindow::onImport()
+{
+    const QString path = QFileDialog::getOpenFileName(this, tr("Import Bookmarks and History"),
+                                                      QDir::homePath(), Importer::fileFilter());
+    if (path.isEmpty()) return;
+
+    // Non-modal: browsing continues while the file is parsed in the background
+    Importer* importer = new Importer(this);
+    QProgressDialog* progress = new QProgressDialog(tr("Importing %1...").arg(QFileInfo(path).fileName()),
+                                                    tr("Cancel"), 0, 100, this);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+    progress->setMinimumDuration(300);
+    connect(importer, &Importer::progress, progress, &QProgressDialog::setValue);
+    connect(progress, &QProgressDialog::canceled, importer, &Importer::cancel);
+
+    auto done = [importer, progress]() {
+        progress->deleteLater();
+        importer->deleteLater();
+    };
+    connect(importer, &Importer::finished, this, [this, done](int bookmarks, int history) {
+        done();
+        statusBar()->showMessage(tr("Imported %1 bookmarks and %2 history entries").arg(bookmarks).arg(history), 5000);
+    });
+    connect(importer, &Importer::failed, this, [this, done](const QString& error) {
+        done();
+        QMessageBox::warning(this, tr("Import"), error);
+    });
+    connect(importer, &Importer::canceled, this, [this, done]() {
+        done();
+        statusBar()->showMessage(tr("Import canceled"), 3000);
+    });
+    importer->start(path);
+}
+
 void MainWindow::onBookmarkTriggered(QAction* action)
 {
     QString url = action->data().toString();
@@ -414,74 +976,95 @@ void MainWindow::onPageLoadedForHistory(const QUrl& url, const QString& title)
 {
     QString urlStr = url.toString();
     if (urlStr.isEmpty() || urlStr == "about:blank" || url.scheme() == "data") return;
+    if (url.scheme() == NewTabPage::SCHEME) return;
     addToHistory(urlStr, title.isEmpty() ? url.host() : title);
 }
 
 void MainWindow::addToHistory(const QString& url, const QString& title)
 {
-    // Remove existing entry for same URL (we'll add at front)
-    for (int i = 0; i < m_history.size(); ++i) {
-        if (m_history[i].url == url) {
-            m_history.removeAt(i);
-            break;
-        }
-    }
-    m_history.prepend({url, title, QDateTime::currentMSecsSinceEpoch()});
-    const int MAX_HISTORY = 500;
-    while (m_history.size() > MAX_HISTORY) m_history.removeLast();
-    saveHistory();
+    BrowserData::instance()->history()->addVisit(url, title);
 }
 
-void MainWindow::loadHistory()
+void MainWindow::indexPageText(WebView* view)
 {
-    m_history.clear();
-    QSettings settings("ArchBrowser", "arch-browser");
-    int size = settings.beginReadArray("history");
-    for (int i = 0; i < size; ++i) {
-        settings.setArrayIndex(i);
-        m_history.append({
-            settings.value("url").toString(),
-            settings.value("title").toString(),
-            settings.value("timestamp", 0).toLongLong()
-        });
-    }
-    settings.endArray();
+    const QUrl url = view->url();
+    if (url.scheme() != "http" && url.scheme() != "https") return;
+    PageTextIndex* index = BrowserData::instance()->pageText();
+    if (!index->isEnabled()) return;
+    // Text extraction is asynchronous; tokenizing happens on the index thread
+    const QString urlStr = url.toString();
+    const QString title = view->title();
+    view->page()->toPlainText([urlStr, title](const QString& text) {
+        BrowserData::instance()->pageText()->addPage(urlStr, title, text);
+    });
 }
 
-void MainWindow::saveHistory()
+void MainWindow::onShowHistory()
 {
-    QSettings settings("ArchBrowser", "arch-browser");
-    settings.beginWriteArray("history");
-    for (int i = 0; i < m_history.size(); ++i) {
-        settings.setArrayIndex(i);
-        settings.setValue("url", m_history[i].url);
-        settings.setValue("title", m_history[i].title);
-        settings.setValue("timestamp", m_history[i].timestamp);
+    // One history window per browser window; reopening just raises it
+    if (!m_historyWindow) {
+        m_historyWindow = new HistoryWindow(this);
+        connect(m_historyWindow, &HistoryWindow::openUrl, this, &MainWindow::navigateTo);
     }
-    settings.endArray();
+    m_historyWindow->show();
+    m_historyWindow->raise();
+    m_historyWindow->activateWindow();
 }
 
-void MainWindow::onShowHistory()
+void MainWindow::onShowTaskManager()
+{
+    if (!m_taskManager) m_taskManager = new TaskManager(this);
+    m_taskManager->show();
+    m_taskManager->raise();
+    m_taskManager->activateWindow();
+}
+
+void MainWindow::onShowDownloads()
+{
+    if (!m_downloadsWindow) m_downloadsWindow = new DownloadsWindow(this);
+    m_downloadsWindow->show();
+    m_downloadsWindow->raise();
+    m_downloadsWindow->activateWindow();
+}
+
+void MainWindow::onSearchPageContents()
 {
     QDialog dlg(this);
-    dlg.setWindowTitle(tr("History"));
-    dlg.setMinimumSize(500, 400);
+    dlg.setWindowTitle(tr("Search Page Contents"));
+    dlg.setMinimumSize(550, 400);
 
     QVBoxLayout* layout = new QVBoxLayout(&dlg);
+    QLineEdit* queryEdit = new QLineEdit(&dlg);
+    queryEdit->setPlaceholderText(tr("Words from pages you visited..."));
+    queryEdit->setClearButtonEnabled(true);
     QListWidget* list = new QListWidget(&dlg);
-    for (const HistoryEntry& e : m_history) {
-        QString timeStr = QLocale().toString(QDateTime::fromMSecsSinceEpoch(e.timestamp), QLocale::ShortFormat);
-        QListWidgetItem* item = new QListWidgetItem(e.title.isEmpty() ? e.url : (e.title + " \u2014 " + e.url));
-        item->setData(Qt::UserRole, e.url);
-        item->setToolTip(e.url + "\n" + timeStr);
-        list->addItem(item);
-    }
-
     QPushButton* closeBtn = new QPushButton(tr("&Close"), &dlg);
-    closeBtn->setDefault(true);
+    layout->addWidget(queryEdit);
     layout->addWidget(list);
     layout->addWidget(closeBtn, 0, Qt::AlignRight);
 
+    PageTextIndex* index = BrowserData::instance()->pageText();
+    int pendingRequest = 0;
+    QTimer debounce;
+    debounce.setSingleShot(true);
+    debounce.setInterval(150);
+    connect(queryEdit, &QLineEdit::textChanged, &debounce, QOverload<>::of(&QTimer::start));
+    connect(&debounce, &QTimer::timeout, &dlg, [&]() {
+        pendingRequest = index->search(queryEdit->text());
+    });
+    connect(index, &PageTextIndex::searchFinished, &dlg,
+            [&](int requestId, const QVector<PageTextResult>& results) {
+        if (requestId != pendingRequest) return;
+        list->clear();
+        for (const PageTextResult& r : results) {
+            const QString timeStr = QLocale().toString(QDateTime::fromMSecsSinceEpoch(r.timestamp), QLocale::ShortFormat);
+            QListWidgetItem* item = new QListWidgetItem(
+                (r.title.isEmpty() ? r.url : r.title) + " \u2014 " + timeStr);
+            item->setData(Qt::UserRole, r.url);
+            item->setToolTip(r.url);
+            list->addItem(item);
+        }
+    });
     connect(list, &QListWidget::itemDoubleClicked, &dlg, [this, &dlg](QListWidgetItem* item) {
         QString url = item->data(Qt::UserRole).toString();
         if (!url.isEmpty()) navigateTo(url);
@@ -494,20 +1077,130 @@ void MainWindow::onShowHistory()
 
 void MainWindow::onClearHistory()
 {
-    m_history.clear();
-    saveHistory();
+    BrowserData::instance()->history()->clear();
     statusBar()->showMessage(tr("History cleared"), 2000);
 }
 
+void MainWindow::onManageCookies()
+{
+    CookieIndex* cookies = CookieIndex::of(m_profile);
+    if (!cookies) return;
+    cookies->load();
+
+    QDialog dlg(this);
+    const QString container = ContainerManager::instance()->container(m_container).name;
+    dlg.setWindowTitle(container.isEmpty() ? tr("Cookies and Site Data")
+                                           : tr("Cookies and Site Data \u2014 %1").arg(container));
+    dlg.setMinimumSize(500, 420);
+
+    QVBoxLayout* layout = new QVBoxLayout(&dlg);
+    QLineEdit* filterEdit = new QLineEdit(&dlg);
+    filterEdit->setPlaceholderText(tr("Filter sites..."));
+    filterEdit->setClearButtonEnabled(true);
+    QTreeWidget* tree = new QTreeWidget(&dlg);
+    tree->setColumnCount(3);
+    tree->setHeaderLabels({tr("Site"), tr("Cookies"), tr("Stored data")});
+    tree->setRootIsDecorated(false);
+    tree->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    tree->setSortingEnabled(true);
+    tree->sortByColumn(0, Qt::AscendingOrder);
+    QLabel* summary = new QLabel(&dlg);
+    summary->setEnabled(false);
+    QHBoxLayout* buttons = new QHBoxLayout();
+    QPushButton* removeBtn = new QPushButton(tr("&Remove Selected"), &dlg);
+    QPushButton* closeBtn = new QPushButton(tr("&Close"), &dlg);
+    buttons->addWidget(summary, 1);
+    buttons->addWidget(removeBtn);
+    buttons->addWidget(closeBtn);
+    layout->addWidget(filterEdit);
+    layout->addWidget(tree);
+    layout->addLayout(buttons);
+
+    // Sizes come from the last storage scan, which covers the default profile
+    // only; sites already waiting to be cleared are left out
+    const bool clearsStorage = m_profile == QWebEngineProfile::defaultProfile();
+    QHash<QString, qint64> stored;
+    if (clearsStorage) {
+        const QStringList pending = StorageManager::instance()->sitesToClear();
+        for (const StorageManager::SiteUsage& usage : StorageManager::instance()->report().sites) {
+            if (usage.siteData() > 0 && !pending.contains(usage.site)) stored.insert(usage.site, usage.siteData());
+        }
+    } else {
+        tree->setColumnHidden(2, true);
+    }
+    // Rebuilt in one go; a full cookie load arrives in many small batches
+    QTimer rebuild;
+    rebuild.setSingleShot(true);
+    rebuild.setInterval(200);
+    auto populate = [&]() {
+        const QString filter = filterEdit->text().trimmed();
+        tree->setUpdatesEnabled(false);
+        tree->setSortingEnabled(false);
+        tree->clear();
+        QList<QTreeWidgetItem*> items;
+        // Sites with stored data but no cookies are listed too
+        QStringList sites = cookies->sites();
+        for (auto it = stored.cbegin(); it != stored.cend(); ++it) {
+            if (cookies->count(it.key()) == 0) sites.append(it.key());
+        }
+        for (const QString& site : qAsConst(sites)) {
+            if (!filter.isEmpty() && !site.contains(filter, Qt::CaseInsensitive)) continue;
+            QTreeWidgetItem* item = new QTreeWidgetItem({site, QString::number(cookies->count(site)),
+                                                         stored.contains(site) ? QLocale().formattedDataSize(stored.value(site)) : QString()});
+            item->setData(1, Qt::DisplayRole, cookies->count(site));   // sorts as a number
+            items.append(item);
+        }
+        tree->addTopLevelItems(items);
+        tree->setSortingEnabled(true);
+        tree->setUpdatesEnabled(true);
+        summary->setText(tr("%n cookie(s)", "", cookies->count()));
+    };
+    populate();
+    connect(cookies, &CookieIndex::changed, &rebuild, QOverload<>::of(&QTimer::start));
+    connect(filterEdit, &QLineEdit::textChanged, &rebuild, QOverload<>::of(&QTimer::start));
+    connect(&rebuild, &QTimer::timeout, &dlg, populate);
+    connect(removeBtn, &QPushButton::clicked, &dlg, [&]() {
+        const QList<QTreeWidgetItem*> selected = tree->selectedItems();
+        if (selected.isEmpty()) return;
+        // Only the default profile's storage can be cleared, and only while
+        // nothing has its files open, i.e. at the next start
+        QString question;
+        if (clearsStorage) {
+            question = selected.size() == 1
+                ? tr("Delete the cookies of %1 now and its stored data at the next start? Cached pages are kept.")
+                      .arg(selected.first()->text(0))
+                : tr("Delete the cookies of %n site(s) now and their stored data at the next start? "
+                     "Cached pages are kept.", "", selected.size());
+        } else {
+            question = selected.size() == 1
+                ? tr("Delete the cookies of %1? Data it stored in this container is kept.").arg(selected.first()->text(0))
+                : tr("Delete the cookies of %n site(s)? Data they stored in this container is kept.", "",
+                     selected.size());
+        }
+        if (QMessageBox::question(&dlg, tr("Remove Site Data"), question) != QMessageBox::Yes) return;
+        for (QTreeWidgetItem* item : selected) {
+            cookies->clearSite(item->text(0));
+            stored.remove(item->text(0));
+        }
+        rebuild.start();
+        statusBar()->showMessage(clearsStorage ? tr("Cookies removed; stored site data is cleared at the next start")
+                                               : tr("Cookies removed"), 3000);
+    });
+    connect(closeBtn, &QPushButton::clicked, &dlg, &QDialog::accept);
+
+    dlg.exec();
+}
+
 void MainWindow::onReopenClosedTab()
 {
-    if (m_closedTabs.isEmpty()) {
+    SessionStore* session = BrowserData::instance()->session();
+    if (!session->hasClosedTabs()) {
         statusBar()->showMessage(tr("No recently closed tabs"), 2000);
         return;
     }
 
-    const QUrl url = m_closedTabs.takeFirst();
-    addTab(url);
+    // Comes back with its back/forward list, not just the last URL
+    addRestoredTab(session->takeClosedTab());
 }
 
 void MainWindow::onOpenSettings()
@@ -526,8 +1219,7 @@ void MainWindow::onOpenSettings()
     searchCombo->addItem(tr("Google"), "google");
     searchCombo->addItem(tr("Brave Search"), "brave");
 
-    QSettings settings("ArchBrowser", "arch-browser");
-    const QString currentEngine = settings.value("searchEngine", "duckduckgo").toString();
+    const QString currentEngine = Settings::instance()->searchEngine();
     int searchIdx = searchCombo->findData(currentEngine);
     if (searchIdx < 0) searchIdx = 0;
     searchCombo->setCurrentIndex(searchIdx);
@@ -535,15 +1227,277 @@ void MainWindow::onOpenSettings()
     searchLayout->addWidget(searchLabel);
     searchLayout->addWidget(searchCombo);
 
+    QGroupBox* startupGroup = new QGroupBox(tr("Startup"), &dlg);
+    QVBoxLayout* startupLayout = new QVBoxLayout(startupGroup);
+    QCheckBox* restoreCheck = new QCheckBox(tr("Reopen windows and tabs from last time"), startupGroup);
+    restoreCheck->setChecked(Settings::instance()->restoreSession());
+    startupLayout->addWidget(restoreCheck);
+    QCheckBox* newTabCheck = new QCheckBox(tr("Show top sites in new tabs"), startupGroup);
+    newTabCheck->setChecked(Settings::instance()->newTabPage());
+    startupLayout->addWidget(newTabCheck);
+
+    QGroupBox* performanceGroup = new QGroupBox(tr("Performance"), &dlg);
+    QVBoxLayout* performanceLayout = new QVBoxLayout(performanceGroup);
+    QHBoxLayout* profileLayout = new QHBoxLayout();
+    QComboBox* profileCombo = new QComboBox(performanceGroup);
+    for (int kind = 0; kind < PerformanceProfile::KindCount; ++kind) {
+        profileCombo->addItem(PerformanceProfile::name(PerformanceProfile::Kind(kind)), kind);
+        const QByteArray flags = PerformanceProfile::engineFlags(PerformanceProfile::Kind(kind));
+        profileCombo->setItemData(kind, flags.isEmpty() ? tr("Engine defaults") : QString::fromLatin1(flags), Qt::ToolTipRole);
+    }
+    profileCombo->setCurrentIndex(PerformanceProfile::selected());
+    profileLayout->addWidget(new QLabel(tr("Performance profile:"), performanceGroup));
+    profileLayout->addWidget(profileCombo);
+    profileLayout->addStretch();
+    QLabel* profileNote = new QLabel(performanceGroup);
+    profileNote->setEnabled(false);
+    profileNote->setWordWrap(true);
+    auto updateProfileNote = [profileNote]() {
+        // One line per measured profile, the active one marked
+        QStringList lines;
+        if (PerformanceProfile::selected() != PerformanceProfile::active()) {
+            lines.append(tr("Restart the browser to switch from %1.")
+                             .arg(PerformanceProfile::name(PerformanceProfile::active())));
+        }
+        for (int kind = 0; kind < PerformanceProfile::KindCount; ++kind) {
+            const PerformanceProfile::Measurement m = PerformanceProfile::measurement(PerformanceProfile::Kind(kind));
+            if (m.runs == 0) continue;
+            lines.append(tr("%1%2: starts in %3 ms, uses about %4 (%n run(s))", "", m.runs)
+                             .arg(PerformanceProfile::name(PerformanceProfile::Kind(kind)))
+                             .arg(kind == PerformanceProfile::active() ? tr(" (active)") : QString())
+                             .arg(m.startupMs)
+                             .arg(QLocale().formattedDataSize(m.memoryBytes)));
+        }
+        if (lines.isEmpty()) lines.append(tr("Startup time and memory use are measured a minute after each start."));
+        profileNote->setText(lines.join('\n'));
+    };
+    updateProfileNote();
+    performanceLayout->addLayout(profileLayout);
+    performanceLayout->addWidget(profileNote);
+
+    TabLifecycleManager* lifecycle = TabLifecycleManager::instance();
+    QGroupBox* tabsGroup = new QGroupBox(tr("Background Tabs"), &dlg);
+    QVBoxLayout* tabsLayout = new QVBoxLayout(tabsGroup);
+    QHBoxLayout* freezeLayout = new QHBoxLayout();
+    QSpinBox* freezeSpin = new QSpinBox(tabsGroup);
+    freezeSpin->setRange(0, 240);
+    freezeSpin->setSuffix(tr(" min"));
+    freezeSpin->setSpecialValueText(tr("Never"));
+    freezeSpin->setValue(lifecycle->freezeAfterMinutes());
+    freezeLayout->addWidget(new QLabel(tr("Pause background tabs after:"), tabsGroup));
+    freezeLayout->addWidget(freezeSpin);
+    freezeLayout->addStretch();
+    QHBoxLayout* discardLayout = new QHBoxLayout();
+    QSpinBox* discardSpin = new QSpinBox(tabsGroup);
+    discardSpin->setRange(0, 50);
+    discardSpin->setSuffix(tr(" %"));
+    discardSpin->setSpecialValueText(tr("Never"));
+    discardSpin->setValue(lifecycle->discardBelowPercent());
+    discardLayout->addWidget(new QLabel(tr("Unload background tabs when free memory is below:"), tabsGroup));
+    discardLayout->addWidget(discardSpin);
+    discardLayout->addStretch();
+    QLabel* lifecycleStats = new QLabel(tabsGroup);
+    lifecycleStats->setEnabled(false);
+    auto updateLifecycleStats = [lifecycle, lifecycleStats]() {
+        const TabLifecycleManager::Stats stats = lifecycle->stats();
+        lifecycleStats->setText(tr("Paused %1 tabs, unloaded %2, about %3 reclaimed")
+                                    .arg(stats.frozen).arg(stats.discarded)
+                                    .arg(QLocale().formattedDataSize(stats.reclaimedBytes)));
+    };
+    updateLifecycleStats();
+    connect(lifecycle, &TabLifecycleManager::statsChanged, lifecycleStats, updateLifecycleStats);
+    QHBoxLayout* poolLayout = new QHBoxLayout();
+    QSpinBox* poolSpin = new QSpinBox(tabsGroup);
+    poolSpin->setRange(0, 4);
+    poolSpin->setSpecialValueText(tr("None"));
+    poolSpin->setValue(WebViewPool::instance()->size());
+    poolSpin->setToolTip(tr("Each spare costs a renderer process; fewer are kept when memory is low"));
+    poolLayout->addWidget(new QLabel(tr("Spare pages kept ready for new tabs:"), tabsGroup));
+    poolLayout->addWidget(poolSpin);
+    poolLayout->addStretch();
+    QHBoxLayout* linkTabsLayout = new QHBoxLayout();
+    QComboBox* linkTabsCombo = new QComboBox(tabsGroup);
+    linkTabsCombo->addItem(tr("Load right away, a few at a time"), "immediate");
+    linkTabsCombo->addItem(tr("Load when first shown"), "onSelect");
+    linkTabsCombo->setCurrentIndex(deferBackgroundTabs() ? 1 : 0);
+    linkTabsLayout->addWidget(new QLabel(tr("Links opened in background tabs:"), tabsGroup));
+    linkTabsLayout->addWidget(linkTabsCombo);
+    linkTabsLayout->addStretch();
+    tabsLayout->addLayout(linkTabsLayout);
+    tabsLayout->addLayout(poolLayout);
+    tabsLayout->addLayout(freezeLayout);
+    tabsLayout->addLayout(discardLayout);
+    tabsLayout->addWidget(new QLabel(tr("Pinned tabs and tabs playing audio are always kept."), tabsGroup));
+    tabsLayout->addWidget(lifecycleStats);
+
+    Predictor* predictor = Predictor::instance();
+    QGroupBox* preloadGroup = new QGroupBox(tr("Preloading"), &dlg);
+    QVBoxLayout* preloadLayout = new QVBoxLayout(preloadGroup);
+    QCheckBox* preconnectCheck = new QCheckBox(tr("Connect early to sites you're likely to open"), preloadGroup);
+    preconnectCheck->setChecked(predictor->preconnectEnabled());
+    QCheckBox* prerenderCheck = new QCheckBox(tr("Load the page you're likely typing in the background"), preloadGroup);
+    prerenderCheck->setChecked(predictor->prerenderEnabled());
+    prerenderCheck->setToolTip(tr("Uses it only in an empty tab; skipped when memory is low or on a mobile connection"));
+    QHBoxLayout* prerenderLayout = new QHBoxLayout();
+    QSpinBox* prerenderCountSpin = new QSpinBox(preloadGroup);
+    prerenderCountSpin->setRange(1, 3);
+    prerenderCountSpin->setValue(predictor->maxPrerenders());
+    QSpinBox* prerenderMemorySpin = new QSpinBox(preloadGroup);
+    prerenderMemorySpin->setRange(64, 2048);
+    prerenderMemorySpin->setSingleStep(64);
+    prerenderMemorySpin->setSuffix(tr(" MB"));
+    prerenderMemorySpin->setValue(predictor->memoryCapMB());
+    prerenderLayout->addWidget(new QLabel(tr("At most:"), preloadGroup));
+    prerenderLayout->addWidget(prerenderCountSpin);
+    prerenderLayout->addWidget(new QLabel(tr("pages, using up to:"), preloadGroup));
+    prerenderLayout->addWidget(prerenderMemorySpin);
+    prerenderLayout->addStretch();
+    QLabel* preloadStats = new QLabel(preloadGroup);
+    preloadStats->setEnabled(false);
+    auto updatePreloadStats = [predictor, preloadStats]() {
+        const Predictor::Stats stats = predictor->stats();
+        preloadStats->setText(tr("%1 early connections; %2 pages preloaded: %3 shown instantly, "
+                                 "%4 loaded faster, %5 unused")
+                                  .arg(stats.preconnects).arg(stats.prerenders).arg(stats.hits)
+                                  .arg(stats.warmHits).arg(stats.misses));
+    };
+    updatePreloadStats();
+    connect(predictor, &Predictor::statsChanged, preloadStats, updatePreloadStats);
+    preloadLayout->addWidget(preconnectCheck);
+    preloadLayout->addWidget(prerenderCheck);
+    preloadLayout->addLayout(prerenderLayout);
+    preloadLayout->addWidget(preloadStats);
+
+    QGroupBox* downloadsGroup = new QGroupBox(tr("Downloads"), &dlg);
+    QVBoxLayout* downloadsLayout = new QVBoxLayout(downloadsGroup);
+    DownloadManager* downloads = DownloadManager::instance();
+    QHBoxLayout* folderLayout = new QHBoxLayout();
+    QLineEdit* folderEdit = new QLineEdit(downloads->defaultDirectory(), downloadsGroup);
+    QPushButton* browseFolderBtn = new QPushButton(tr("Browse..."), downloadsGroup);
+    folderLayout->addWidget(new QLabel(tr("Save downloads to:"), downloadsGroup));
+    folderLayout->addWidget(folderEdit, 1);
+    folderLayout->addWidget(browseFolderBtn);
+    downloadsLayout->addLayout(folderLayout);
+    downloadsLayout->addWidget(new QLabel(tr("Folders by type or site, one per line: a MIME type or host, then the folder"),
+                                          downloadsGroup));
+    QPlainTextEdit* rulesEdit = new QPlainTextEdit(downloadsGroup);
+    rulesEdit->setPlaceholderText("application/pdf ~/Documents\nimage/* ~/Pictures\nexample.com ~/Work");
+    rulesEdit->setMaximumHeight(80);
+    QStringList ruleLines;
+    for (const DownloadManager::Rule& rule : downloads->rules()) ruleLines.append(rule.pattern + ' ' + rule.directory);
+    rulesEdit->setPlainText(ruleLines.join('\n'));
+    downloadsLayout->addWidget(rulesEdit);
+
     QGroupBox* privacyGroup = new QGroupBox(tr("Privacy"), &dlg);
     QVBoxLayout* privacyLayout = new QVBoxLayout(privacyGroup);
     QPushButton* clearHistoryBtn = new QPushButton(tr("Clear Browsing History"), privacyGroup);
     QPushButton* clearCookiesBtn = new QPushButton(tr("Clear Cookies + Saved Session"), privacyGroup);
+    QPushButton* manageCookiesBtn = new QPushButton(tr("Cookies and Site Data by Site..."), privacyGroup);
     QPushButton* clearCacheBtn = new QPushButton(tr("Clear Cache"), privacyGroup);
+    QHBoxLayout* retentionLayout = new QHBoxLayout();
+    QSpinBox* retentionSpin = new QSpinBox(privacyGroup);
+    retentionSpin->setRange(0, 3650);
+    retentionSpin->setSuffix(tr(" days"));
+    retentionSpin->setSpecialValueText(tr("Forever"));
+    retentionSpin->setValue(BrowserData::instance()->history()->retentionDays());
+    // Shortening it deletes history for good; "365" mustn't pass through 3
+    retentionSpin->setKeyboardTracking(false);
+    retentionSpin->setToolTip(tr("History older than this is deleted"));
+    retentionLayout->addWidget(new QLabel(tr("Keep browsing history for:"), privacyGroup));
+    retentionLayout->addWidget(retentionSpin);
+    retentionLayout->addStretch();
+    privacyLayout->addLayout(retentionLayout);
+    QCheckBox* adBlockCheck = new QCheckBox(tr("Block ads and trackers"), privacyGroup);
+    adBlockCheck->setChecked(AdBlocker::instance()->isEnabled());
+    privacyLayout->addWidget(adBlockCheck);
+    QHBoxLayout* filterLayout = new QHBoxLayout();
+    QLabel* filterStatus = new QLabel(privacyGroup);
+    filterStatus->setEnabled(false);
+    auto updateFilterStatus = [filterStatus]() {
+        const int rules = AdBlocker::instance()->ruleCount();
+        filterStatus->setText(rules > 0 ? tr("%1 filter rules loaded").arg(rules) : tr("Filter lists not downloaded yet"));
+    };
+    updateFilterStatus();
+    connect(AdBlocker::instance(), &AdBlocker::filtersChanged, filterStatus, updateFilterStatus);
+    QPushButton* updateFiltersBtn = new QPushButton(tr("Update Filter Lists"), privacyGroup);
+    filterLayout->addWidget(filterStatus);
+    filterLayout->addStretch();
+    filterLayout->addWidget(updateFiltersBtn);
+    privacyLayout->addLayout(filterLayout);
+    QCheckBox* httpsCheck = new QCheckBox(tr("Use HTTPS for sites known to support it"), privacyGroup);
+    httpsCheck->setChecked(HttpsUpgrader::instance()->isEnabled());
+    privacyLayout->addWidget(httpsCheck);
+    QCheckBox* pageTextCheck = new QCheckBox(tr("Index text of visited pages for history search"), privacyGroup);
+    pageTextCheck->setChecked(BrowserData::instance()->pageText()->isEnabled());
+    privacyLayout->addWidget(pageTextCheck);
     privacyLayout->addWidget(clearHistoryBtn);
     privacyLayout->addWidget(clearCookiesBtn);
+    privacyLayout->addWidget(manageCookiesBtn);
     privacyLayout->addWidget(clearCacheBtn);
 
+    StorageManager* storage = StorageManager::instance();
+    QHBoxLayout* siteQuotaLayout = new QHBoxLayout();
+    QSpinBox* siteQuotaSpin = new QSpinBox(privacyGroup);
+    siteQuotaSpin->setRange(0, 102400);
+    siteQuotaSpin->setSingleStep(256);
+    siteQuotaSpin->setSuffix(tr(" MB"));
+    siteQuotaSpin->setSpecialValueText(tr("Unlimited"));
+    siteQuotaSpin->setValue(storage->siteDataQuotaMB());
+    siteQuotaSpin->setToolTip(tr("Data of the least recently used sites is cleared at the next start"));
+    QSpinBox* cacheQuotaSpin = new QSpinBox(privacyGroup);
+    cacheQuotaSpin->setRange(0, 102400);
+    cacheQuotaSpin->setSingleStep(256);
+    cacheQuotaSpin->setSuffix(tr(" MB"));
+    cacheQuotaSpin->setSpecialValueText(tr("Automatic"));
+    cacheQuotaSpin->setValue(storage->httpCacheQuotaMB());
+    siteQuotaLayout->addWidget(new QLabel(tr("Limit site data to:"), privacyGroup));
+    siteQuotaLayout->addWidget(siteQuotaSpin);
+    siteQuotaLayout->addWidget(new QLabel(tr("and cache to:"), privacyGroup));
+    siteQuotaLayout->addWidget(cacheQuotaSpin);
+    siteQuotaLayout->addStretch();
+    QHBoxLayout* storageLayout = new QHBoxLayout();
+    QLabel* storageStatus = new QLabel(privacyGroup);
+    storageStatus->setEnabled(false);
+    storageStatus->setWordWrap(true);
+    auto updateStorageStatus = [storage, storageStatus]() {
+        if (storage->isScanning()) {
+            storageStatus->setText(tr("Measuring storage..."));
+            return;
+        }
+        const StorageManager::Report report = storage->report();
+        if (report.scannedAt == 0) {
+            storageStatus->setText(tr("Storage not measured yet"));
+            return;
+        }
+        const QLocale locale;
+        QStringList lines;
+        lines.append(tr("%1 in use: %2 site databases, %3 service worker caches, %4 local storage, "
+                        "%5 HTTP cache, %6 other")
+                         .arg(locale.formattedDataSize(report.total()))
+                         .arg(locale.formattedDataSize(report.totals[StorageManager::IndexedDb]))
+                         .arg(locale.formattedDataSize(report.totals[StorageManager::CacheStorage]))
+                         .arg(locale.formattedDataSize(report.totals[StorageManager::LocalStorage]))
+                         .arg(locale.formattedDataSize(report.totals[StorageManager::HttpCache]))
+                         .arg(locale.formattedDataSize(report.totals[StorageManager::Other])));
+        for (int i = 0; i < qMin(5, report.sites.size()); ++i) {
+            const StorageManager::SiteUsage& site = report.sites.at(i);
+            lines.append(tr("%1: %2 (%3 cache)").arg(site.site, locale.formattedDataSize(site.total()),
+                                                       locale.formattedDataSize(site.bytes[StorageManager::HttpCache])));
+        }
+        if (report.sitesToEvict > 0) {
+            lines.append(tr("Data of %n least recently used site(s) (%1) will be cleared at the next start.",
+                            "", report.sitesToEvict).arg(locale.formattedDataSize(report.bytesToEvict)));
+        }
+        storageStatus->setText(lines.join('\n'));
+    };
+    updateStorageStatus();
+    connect(storage, &StorageManager::scanFinished, storageStatus, updateStorageStatus);
+    QPushButton* analyzeStorageBtn = new QPushButton(tr("Measure Storage"), privacyGroup);
+    storageLayout->addWidget(storageStatus, 1);
+    storageLayout->addWidget(analyzeStorageBtn, 0, Qt::AlignTop);
+    privacyLayout->addLayout(siteQuotaLayout);
+    privacyLayout->addLayout(storageLayout);
+
     QGroupBox* dataGroup = new QGroupBox(tr("Data"), &dlg);
     QVBoxLayout* dataLayout = new QVBoxLayout(dataGroup);
     QPushButton* clearBookmarksBtn = new QPushButton(tr("Clear All Bookmarks"), dataGroup);
@@ -555,6 +1509,11 @@ void MainWindow::onOpenSettings()
     closeBtn->setDefault(true);
 
     root->addWidget(searchGroup);
+    root->addWidget(startupGroup);
+    root->addWidget(performanceGroup);
+    root->addWidget(tabsGroup);
+    root->addWidget(preloadGroup);
+    root->addWidget(downloadsGroup);
     root->addWidget(privacyGroup);
     root->addWidget(dataGroup);
     root->addStretch();
@@ -567,45 +1526,135 @@ void MainWindow::onOpenSettings()
         }
     });
 
+    // Only this window's container; the others keep their logins
     connect(clearCookiesBtn, &QPushButton::clicked, this, [this]() {
-        if (QMessageBox::question(this, tr("Clear Cookies and Session"),
-                                  tr("Delete all cookies and session data?")) == QMessageBox::Yes) {
-            QWebEngineProfile* profile = QWebEngineProfile::defaultProfile();
+        const QString name = ContainerManager::instance()->container(m_container).name;
+        const QString question = name.isEmpty() ? tr("Delete all cookies and session data?")
+                                                 : tr("Delete all cookies and session data in %1?").arg(name);
+        if (QMessageBox::question(this, tr("Clear Cookies and Session"), question) == QMessageBox::Yes) {
+            QWebEngineProfile* profile = m_profile;
+            // The HTTP cache has its own button; logging out needn't make
+            // every site slow on its next visit
             profile->cookieStore()->deleteAllCookies();
-            profile->clearHttpCache();
             profile->clearAllVisitedLinks();
             statusBar()->showMessage(tr("Cookies and session data cleared"), 3000);
         }
     });
 
+    connect(analyzeStorageBtn, &QPushButton::clicked, this, [storage, updateStorageStatus]() {
+        storage->scan();
+        updateStorageStatus();
+    });
+    connect(siteQuotaSpin, QOverload<int>::of(&QSpinBox::valueChanged), storage, &StorageManager::setSiteDataQuotaMB);
+    connect(cacheQuotaSpin, QOverload<int>::of(&QSpinBox::valueChanged), storage, &StorageManager::setHttpCacheQuotaMB);
+
+    connect(manageCookiesBtn, &QPushButton::clicked, this, &MainWindow::onManageCookies);
+
     connect(clearCacheBtn, &QPushButton::clicked, this, [this]() {
-        QWebEngineProfile::defaultProfile()->clearHttpCache();
+        m_profile->clearHttpCache();
         statusBar()->showMessage(tr("Cache cleared"), 3000);
     });
 
     connect(clearBookmarksBtn, &QPushButton::clicked, this, [this]() {
         if (QMessageBox::question(this, tr("Clear Bookmarks"),
                                   tr("Delete all saved bookmarks?")) == QMessageBox::Yes) {
-            m_bookmarks.clear();
-            saveBookmarks();
-            rebuildBookmarksMenu();
+            BrowserData::instance()->bookmarks()->clear();
             statusBar()->showMessage(tr("All bookmarks cleared"), 3000);
         }
     });
 
     connect(resetHomeBtn, &QPushButton::clicked, this, [this]() {
-        QSettings s("ArchBrowser", "arch-browser");
-        s.setValue("homePage", "https://google.com");
-        statusBar()->showMessage(tr("Home page reset to https://google.com"), 3000);
+        Settings::instance()->setHomePage(Settings::DEFAULT_HOME_PAGE);
+        statusBar()->showMessage(tr("Home page reset to %1").arg(QString(Settings::DEFAULT_HOME_PAGE)), 3000);
+    });
+
+    connect(retentionSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [](int days) {
+        BrowserData::instance()->history()->setRetentionDays(days);
+    });
+
+    connect(freezeSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [lifecycle](int minutes) {
+        lifecycle->setFreezeAfterMinutes(minutes);
+    });
+
+    connect(discardSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [lifecycle](int percent) {
+        lifecycle->setDiscardBelowPercent(percent);
+    });
+
+    connect(linkTabsCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [linkTabsCombo]() {
+        Settings::instance()->setValue("backgroundTabLoading", linkTabsCombo->currentData());
+    });
+
+    connect(poolSpin, QOverload<int>::of(&QSpinBox::valueChanged), this, [](int size) {
+        WebViewPool::instance()->setSize(size);
+    });
+
+    // The background-tab preset applies now, through the controls above
+    connect(profileCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this,
+            [freezeSpin, discardSpin, poolSpin, linkTabsCombo, updateProfileNote](int index) {
+        const PerformanceProfile::Kind kind = PerformanceProfile::Kind(index);
+        PerformanceProfile::select(kind);
+        const PerformanceProfile::TabPolicy policy = PerformanceProfile::tabPolicy(kind);
+        freezeSpin->setValue(policy.freezeMinutes);
+        discardSpin->setValue(policy.discardBelowPercent);
+        poolSpin->setValue(policy.spareViews);
+        linkTabsCombo->setCurrentIndex(policy.loadOnSelect ? 1 : 0);
+        updateProfileNote();
+    });
+
+    connect(preconnectCheck, &QCheckBox::toggled, predictor, &Predictor::setPreconnectEnabled);
+    connect(prerenderCheck, &QCheckBox::toggled, predictor, &Predictor::setPrerenderEnabled);
+    connect(prerenderCountSpin, QOverload<int>::of(&QSpinBox::valueChanged), predictor, &Predictor::setMaxPrerenders);
+    connect(prerenderMemorySpin, QOverload<int>::of(&QSpinBox::valueChanged), predictor, &Predictor::setMemoryCapMB);
+
+    connect(folderEdit, &QLineEdit::editingFinished, downloads, [downloads, folderEdit]() {
+        downloads->setDefaultDirectory(folderEdit->text().trimmed());
+    });
+    connect(browseFolderBtn, &QPushButton::clicked, this, [this, downloads, folderEdit]() {
+        const QString dir = QFileDialog::getExistingDirectory(this, tr("Save Downloads To"), folderEdit->text());
+        if (dir.isEmpty()) return;
+        folderEdit->setText(dir);
+        downloads->setDefaultDirectory(dir);
+    });
+
+    connect(restoreCheck, &QCheckBox::toggled, this, [](bool on) {
+        Settings::instance()->setRestoreSession(on);
+    });
+
+    connect(newTabCheck, &QCheckBox::toggled, this, [](bool on) {
+        Settings::instance()->setNewTabPage(on);
+    });
+
+    connect(adBlockCheck, &QCheckBox::toggled, this, [this](bool on) {
+        AdBlocker::instance()->setEnabled(on);
+        updateAdBlockAction();
+    });
+
+    connect(httpsCheck, &QCheckBox::toggled, HttpsUpgrader::instance(), &HttpsUpgrader::setEnabled);
+
+    connect(updateFiltersBtn, &QPushButton::clicked, this, []() {
+        AdBlocker::instance()->updateLists(true);
+    });
+
+    connect(pageTextCheck, &QCheckBox::toggled, this, [](bool on) {
+        BrowserData::instance()->pageText()->setEnabled(on);
     });
 
     connect(searchCombo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [searchCombo]() {
-        QSettings s("ArchBrowser", "arch-browser");
-        s.setValue("searchEngine", searchCombo->currentData().toString());
+        Settings::instance()->setSearchEngine(searchCombo->currentData().toString());
     });
 
     connect(closeBtn, &QPushButton::clicked, &dlg, &QDialog::accept);
     dlg.exec();
+
+    // Read once the dialog closes rather than on every keystroke
+    QVector<DownloadManager::Rule> rules;
+    const QStringList lines = rulesEdit->toPlainText().split('\n', Qt::SkipEmptyParts);
+    for (const QString& line : lines) {
+        const QString rule = line.trimmed();
+        const int space = rule.indexOf(QRegularExpression("\\s"));
+        if (space > 0) rules.append({rule.left(space), rule.mid(space + 1).trimmed()});
+    }
+    downloads->setRules(rules);
 }
 
 void MainWindow::onSetHomePage()
@@ -614,89 +1663,302 @@ void MainWindow::onSetHomePage()
     if (!view) return;
     QString url = view->url().toString();
     if (url.isEmpty() || url == "about:blank") return;
-    QSettings settings("ArchBrowser", "arch-browser");
-    settings.setValue("homePage", url);
+    Settings::instance()->setHomePage(url);
     statusBar()->showMessage(tr("Home page set to: %1").arg(url), 2000);
 }
 
-void MainWindow::onDownloadRequested(QWebEngineDownloadItem* download)
+void MainWindow::populateBookmarkMenu(QMenu* menu, int folderId)
 {
-    QString path = QFileDialog::getSaveFileName(this, tr("Save File"),
-        QStandardPaths::writableLocation(QStandardPaths::DownloadLocation) + "/" + download->suggestedFileName());
-    if (!path.isEmpty()) {
-        QFileInfo fi(path);
-        download->setDownloadDirectory(fi.absolutePath());
-        download->setDownloadFileName(fi.fileName());
-        connect(download, &QWebEngineDownloadItem::finished, this, &MainWindow::onDownloadFinished);
-        download->accept();
+    // Root keeps Add, Remove, Set Home, Manage and the separator
+    const int keep = menu == m_bookmarksMenu ? BOOKMARK_MENU_FIXED_ACTIONS : 0;
+    const QList<QAction*> actions = menu->actions();
+    for (int i = keep; i < actions.size(); ++i) {
+        menu->removeAction(actions[i]);
+        if (QMenu* sub = actions[i]->menu()) {
+            delete sub;
+        } else {
+            delete actions[i];
+        }
     }
+
+    BookmarkStore* store = BrowserData::instance()->bookmarks();
+    const QVector<int> children = store->children(folderId);
+    const int shown = qMin(children.size(), MAX_BOOKMARK_MENU_ITEMS);
+    for (int i = 0; i < shown; ++i) {
+        const BookmarkNode n = store->node(children[i]);
+        if (n.folder) {
+            QMenu* sub = menu->addMenu(QIcon::fromTheme("folder"), n.title);
+            const int id = n.id;
+            m_staleBookmarkMenus.insert(id);
+            connect(sub, &QMenu::aboutToShow, this, [this, sub, id]() {
+                if (m_staleBookmarkMenus.contains(id)) populateBookmarkMenu(sub, id);
+            });
+        } else {
+            QAction* a = menu->addAction(n.title.isEmpty() ? n.url : n.title);
+            a->setData(n.url);
+            a->setToolTip(n.url);
+            connect(a, &QAction::triggered, this, [this, a]() { onBookmarkTriggered(a); });
+        }
+    }
+    if (children.size() > shown) {
+        menu->addSeparator();
+        menu->addAction(tr("Show All %1 Bookmarks...").arg(children.size()), this, &MainWindow::onManageBookmarks);
+    }
+    m_staleBookmarkMenus.remove(folderId);
 }
 
-void MainWindow::onDownloadFinished()
+void MainWindow::markBookmarkFolderStale(int folderId)
 {
-    statusBar()->showMessage(tr("Download finished"), 3000);
+    // Cheap on purpose: an import can touch thousands of nodes
+    m_staleBookmarkMenus.insert(folderId);
 }
 
-void MainWindow::loadBookmarks()
+void MainWindow::updateBookmarkStar()
 {
-    m_bookmarks.clear();
-    QSettings settings("ArchBrowser", "arch-browser");
-    int size = settings.beginReadArray("bookmarks");
-    for (int i = 0; i < size; ++i) {
-        settings.setArrayIndex(i);
-        m_bookmarks.append({
-            settings.value("title").toString(),
-            settings.value("url").toString()
-        });
-    }
-    settings.endArray();
+    WebView* view = currentWebView();
+    const bool bookmarked = view && BrowserData::instance()->bookmarks()->isBookmarked(view->url().toString());
+    m_bookmarkStar->setIcon(bookmarked ? m_starOn : m_starOff);
+    m_bookmarkStar->setToolTip(bookmarked ? tr("Remove bookmark") : tr("Bookmark this page"));
 }
 
-void MainWindow::saveBookmarks()
+void MainWindow::updateAdBlockAction()
 {
-    QSettings settings("ArchBrowser", "arch-browser");
-    settings.beginWriteArray("bookmarks");
-    for (int i = 0; i < m_bookmarks.size(); ++i) {
-        settings.setArrayIndex(i);
-        settings.setValue("title", m_bookmarks[i].title);
-        settings.setValue("url", m_bookmarks[i].url);
+    WebView* view = currentWebView();
+    const QString host = view ? view->url().host() : QString();
+    AdBlocker* blocker = AdBlocker::instance();
+    // Nothing to show on pages the blocker never filters
+    m_adBlockAction->setVisible(blocker->isEnabled() && !host.isEmpty());
+    if (!m_adBlockAction->isVisible()) return;
+
+    const WebPage* page = qobject_cast<WebPage*>(view->page());
+    const int count = page ? page->blockedCount() : 0;
+    if (blocker->isAllowlisted(host)) {
+        m_adBlockAction->setIcon(blockedIcon(0, false));
+        m_adBlockAction->setToolTip(tr("Ads and trackers are allowed on %1. Click to block them.").arg(host));
+    } else {
+        m_adBlockAction->setIcon(blockedIcon(count, true));
+        m_adBlockAction->setToolTip(tr("%n request(s) blocked on this page. Click to allow ads on %1.", "", count).arg(host));
     }
-    settings.endArray();
 }
 
-void MainWindow::rebuildBookmarksMenu()
+QWebEngineView* MainWindow::createTabForExternalRequest(QWebEnginePage::WebWindowType type)
 {
-    // Remove old bookmark items (keep Add, Remove, Set Home, Manage, separator)
-    QList<QAction*> actions = m_bookmarksMenu->actions();
-    for (int i = 5; i < actions.size(); ++i) {
-        m_bookmarksMenu->removeAction(actions[i]);
+    if (type == QWebEnginePage::WebBrowserWindow || type == QWebEnginePage::WebDialog) {
+        // Chromium hands the opener's page over, so it must be the same profile
+        MainWindow* window = new MainWindow(NoTab(), m_container);
+        window->show();
+        return window->createTabForExternalRequest(QWebEnginePage::WebBrowserTab);
+    }
+
+    // Chromium adopts the opener's new page into this view, which only
+    // works if it hasn't loaded anything: a pooled view won't do
+    WebView* view = createWebView(BrowserData::instance()->session()->newTabId(), false);
+    if (type != QWebEnginePage::WebBrowserBackgroundTab) {
+        const int idx = m_tabWidget->addTab(view, tr("New Tab"));
+        m_tabWidget->setCurrentIndex(idx);
+        markTabDirty(view);
+        return view;
+    }
+
+    // Background tabs go after the current one and after any tabs already
+    // opened from it, and don't take focus
+    int index = m_tabWidget->currentIndex() + 1;
+    if (m_backgroundOpener && m_backgroundOpener == m_tabWidget->currentWidget() && m_lastBackgroundTab) {
+        const int last = m_tabWidget->indexOf(m_lastBackgroundTab);
+        if (last >= 0) index = last + 1;
     }
-    for (const Bookmark& b : m_bookmarks) {
-        QAction* a = m_bookmarksMenu->addAction(b.title);
-        a->setData(b.url);
-        connect(a, &QAction::triggered, this, [this, a]() { onBookmarkTriggered(a); });
+    m_tabWidget->insertTab(index, view, tr("New Tab"));
+    m_backgroundOpener = m_tabWidget->currentWidget();
+    m_lastBackgroundTab = view;
+    markTabDirty(view);
+
+    const bool onSelect = deferBackgroundTabs();
+    if (!onSelect && m_backgroundLoads.size() < BACKGROUND_LOAD_SLOTS) {
+        startBackgroundLoad(view);
+        return view;
     }
+
+    // Refused before anything is fetched; the tab becomes a placeholder
+    // that loads when shown, or when a background slot frees up. The swap
+    // waits until Chromium is done with this view's navigation request.
+    QPointer<WebView> guard(view);
+    static_cast<WebPage*>(view->page())->deferNextNavigation([this, guard, onSelect](const QUrl& url) {
+        QMetaObject::invokeMethod(this, [this, guard, url, onSelect]() {
+            if (!guard) return;
+            const int at = m_tabWidget->indexOf(guard);
+            if (at < 0) return;
+            if (at == m_tabWidget->currentIndex()) {
+                guard->setUrl(url);
+                return;
+            }
+            TabState state;
+            state.url = url;
+            state.title = url.toDisplayString();
+            TabPlaceholder* placeholder = replaceWithPlaceholder(at, state);
+            if (!onSelect) {
+                m_backgroundQueue.append(placeholder);
+                pumpBackgroundLoads();
+            }
+        }, Qt::QueuedConnection);
+    });
+    return view;
 }
 
-QWebEngineView* MainWindow::createTabForExternalRequest()
+void MainWindow::startBackgroundLoad(QWebEngineView* view)
 {
-    WebView* view = addTab();
-    return view;
+    // Slots free up when the first load finishes or the tab goes away
+    m_backgroundLoads.insert(view);
+    auto release = [this, view]() {
+        if (m_backgroundLoads.remove(view)) pumpBackgroundLoads();
+    };
+    connect(view, &QWebEngineView::loadFinished, this, release);
+    connect(view, &QObject::destroyed, this, release);
+}
+
+void MainWindow::pumpBackgroundLoads()
+{
+    while (m_backgroundLoads.size() < BACKGROUND_LOAD_SLOTS && !m_backgroundQueue.isEmpty()) {
+        // Entries vanish when the tab is shown (and loaded) or closed first
+        QPointer<TabPlaceholder> next = m_backgroundQueue.takeFirst();
+        const int index = next ? m_tabWidget->indexOf(next) : -1;
+        if (index < 0) continue;
+        if (WebView* view = materializeTab(index)) startBackgroundLoad(view);
+    }
 }
 
 WebView* MainWindow::addTab(const QUrl& url)
 {
-    WebView* view = new WebView(this);
+    WebView* view = createWebView(BrowserData::instance()->session()->newTabId());
     view->setUrl(url);
 
-    view->setCreateTabCallback([this]() -> QWebEngineView* {
-        return createTabForExternalRequest();
+    int idx = m_tabWidget->addTab(view, tr("New Tab"));
+    m_tabWidget->setCurrentIndex(idx);
+    m_findBar->setWebView(view);
+    updateNavigationButtons();
+    markTabDirty(view);
+
+    return view;
+}
+
+WebView* MainWindow::addRestoredTab(const TabState& state)
+{
+    WebView* view = createWebView(BrowserData::instance()->session()->newTabId());
+    restoreTab(view, state);
+
+    int idx = m_tabWidget->addTab(view, tabTitle(state.title));
+    updateTabIcon(idx);
+    m_tabWidget->setCurrentIndex(idx);
+    markTabDirty(view);
+
+    return view;
+}
+
+void MainWindow::addPlaceholderTab(int tabId, const TabState& state)
+{
+    TabPlaceholder* placeholder = new TabPlaceholder(state, this);
+    placeholder->setProperty(TAB_ID_PROPERTY, tabId);
+    placeholder->setProperty(TabLifecycleManager::PINNED_PROPERTY, state.pinned);
+    const int idx = m_tabWidget->addTab(placeholder, tabTitle(state.title));
+    m_tabWidget->setTabToolTip(idx, state.url.toDisplayString());
+    updateTabIcon(idx);
+}
+
+WebView* MainWindow::materializeTab(int index)
+{
+    QWidget* w = m_tabWidget->widget(index);
+    TabPlaceholder* placeholder = qobject_cast<TabPlaceholder*>(w);
+    if (!placeholder) return qobject_cast<WebView*>(w);
+
+    WebView* view = createWebView(tabIdOf(placeholder));
+    restoreTab(view, placeholder->state());
+    replaceTabWidget(index, view);
+    m_tabWidget->setTabToolTip(index, QString());
+    placeholder->deleteLater();
+    return view;
+}
+
+void MainWindow::discardTab(QWebEngineView* view)
+{
+    // The manager asks every window; only the owner acts
+    const int index = m_tabWidget->indexOf(view);
+    if (index < 0 || index == m_tabWidget->currentIndex()) return;
+    replaceWithPlaceholder(index, tabStateOf(view));
+}
+
+TabPlaceholder* MainWindow::replaceWithPlaceholder(int index, const TabState& state)
+{
+    QWidget* old = m_tabWidget->widget(index);
+    TabPlaceholder* placeholder = new TabPlaceholder(state, this);
+    placeholder->setProperty(TAB_ID_PROPERTY, tabIdOf(old));
+    placeholder->setProperty(TabLifecycleManager::PINNED_PROPERTY, state.pinned);
+    replaceTabWidget(index, placeholder);
+    m_tabWidget->setTabText(index, tabTitle(state.title));
+    m_tabWidget->setTabToolTip(index, state.url.toDisplayString());
+    markTabDirty(placeholder);
+    old->deleteLater();
+    return placeholder;
+}
+
+void MainWindow::replaceTabWidget(int index, QWidget* with)
+{
+    if (m_lastBackgroundTab == m_tabWidget->widget(index)) m_lastBackgroundTab = with;
+    // Swap widgets in place without the intermediate currentChanged signals
+    const bool wasCurrent = m_tabWidget->currentIndex() == index;
+    m_tabWidget->blockSignals(true);
+    m_tabWidget->insertTab(index, with, m_tabWidget->tabText(index));
+    m_tabWidget->removeTab(index + 1);
+    if (wasCurrent) m_tabWidget->setCurrentIndex(index);
+    m_tabWidget->blockSignals(false);
+    updateTabIcon(index);
+}
+
+void MainWindow::setTabPinned(int index, bool pinned)
+{
+    QWidget* w = m_tabWidget->widget(index);
+    w->setProperty(TabLifecycleManager::PINNED_PROPERTY, pinned);
+    updateTabIcon(index);
+    markTabDirty(w);
+}
+
+void MainWindow::updateTabIcon(int index)
+{
+    const bool pinned = m_tabWidget->widget(index)->property(TabLifecycleManager::PINNED_PROPERTY).toBool();
+    m_tabWidget->setTabIcon(index, pinned ? pinIcon() : QIcon());
+}
+
+WebView* MainWindow::createWebView(int tabId, bool pooled)
+{
+    // Spare views are in the default profile
+    if (pooled && m_container.isEmpty()) return setUpWebView(WebViewPool::instance()->take(this), tabId);
+    return setUpWebView(new WebView(m_profile, this), tabId);
+}
+
+WebView* MainWindow::setUpWebView(WebView* view, int tabId)
+{
+    view->setProperty(TAB_ID_PROPERTY, tabId);
+    TabLifecycleManager::instance()->track(view);
+
+    view->setCreateTabCallback([this](QWebEnginePage::WebWindowType type) -> QWebEngineView* {
+        return createTabForExternalRequest(type);
     });
 
     connect(view, &WebView::urlChanged, this, &MainWindow::onCurrentViewUrlChanged);
     connect(view, &WebView::titleChanged, this, &MainWindow::onCurrentViewTitleChanged);
     connect(view, &WebView::loadProgress, this, &MainWindow::onCurrentViewLoadProgress);
     connect(view, &WebView::urlChanged, this, [this]() { updateNavigationButtons(); });
+    connect(view, &WebView::urlChanged, this, [this, view]() { markTabDirty(view); });
+    connect(view, &WebView::titleChanged, this, [this, view]() { markTabDirty(view); });
+    if (WebPage* page = qobject_cast<WebPage*>(view->page())) {
+        connect(page, &WebPage::blockedCountChanged, this, [this, view]() {
+            if (view == currentWebView()) updateAdBlockAction();
+        });
+    }
+    if (m_container.isEmpty()) {
+        connect(view->page(), &QWebEnginePage::urlChanged, Predictor::instance(), &Predictor::noteNavigation);
+        connect(view->page(), &QWebEnginePage::linkHovered, this, [view](const QString& url) {
+            Predictor::instance()->predictHover(view, QUrl(url));
+        });
+    }
     connect(view->page(), &QWebEnginePage::loadStarted, this, [this, view]() {
         if (view == currentWebView()) {
             m_refreshAction->setVisible(false);
@@ -704,21 +1966,100 @@ WebView* MainWindow::addTab(const QUrl& url)
         }
     });
     connect(view->page(), &QWebEnginePage::loadFinished, this, [this, view](bool ok) {
+        // An https upgrade that didn't work is retried over plain http
+        const QUrl fallback = ok ? QUrl() : HttpsUpgrader::instance()->fallbackFor(view->url());
+        if (!fallback.isEmpty()) {
+            view->setUrl(fallback);
+            return;
+        }
         if (view == currentWebView()) {
             m_refreshAction->setVisible(true);
             m_stopAction->setVisible(false);
         }
-        if (ok) onPageLoadedForHistory(view->url(), view->title());
+        markTabDirty(view);
+        if (ok && !m_offTheRecord) {
+            onPageLoadedForHistory(view->url(), view->title());
+            indexPageText(view);
+            BrowserData::instance()->thumbnails()->capture(view);
+        }
     });
 
-    int idx = m_tabWidget->addTab(view, tr("New Tab"));
-    m_tabWidget->setCurrentIndex(idx);
-    m_findBar->setWebView(view);
-    updateNavigationButtons();
-
     return view;
 }
 
+void MainWindow::restoreTab(WebView* view, const TabState& state)
+{
+    view->setProperty(TabLifecycleManager::PINNED_PROPERTY, state.pinned);
+    // Restoring the history also navigates to its current entry
+    if (!state.history.isEmpty()) {
+        SessionStore::restoreHistory(view->history(), state.history);
+    } else if (state.url.isValid()) {
+        view->setUrl(state.url);
+    }
+}
+
+int MainWindow::tabIdOf(QWidget* tab) const
+{
+    return tab ? tab->property(TAB_ID_PROPERTY).toInt() : -1;
+}
+
+TabState MainWindow::tabStateOf(QWidget* tab) const
+{
+    TabState state;
+    if (TabPlaceholder* placeholder = qobject_cast<TabPlaceholder*>(tab)) {
+        state = placeholder->state();
+    } else if (WebView* view = qobject_cast<WebView*>(tab)) {
+        state.url = view->url();
+        state.title = view->title();
+        state.history = SessionStore::saveHistory(view->history());
+    }
+    // Pinning can change while a tab is a placeholder
+    if (tab) state.pinned = tab->property(TabLifecycleManager::PINNED_PROPERTY).toBool();
+    return state;
+}
+
+void MainWindow::markTabDirty(QWidget* tab)
+{
+    m_dirtyTabs.insert(tabIdOf(tab));
+    m_windowDirty = true;
+    if (!m_sessionTimer.isActive()) m_sessionTimer.start();
+}
+
+void MainWindow::markWindowDirty()
+{
+    m_windowDirty = true;
+    if (!m_sessionTimer.isActive()) m_sessionTimer.start();
+}
+
+void MainWindow::saveSession()
+{
+    m_sessionTimer.stop();
+    if (m_offTheRecord) {
+        m_dirtyTabs.clear();
+        m_windowDirty = false;
+        return;
+    }
+    SessionStore* session = BrowserData::instance()->session();
+
+    // Tab states first, so the window record never names an unsaved tab
+    WindowState window;
+    window.id = m_windowId;
+    window.container = m_container;
+    for (int i = 0; i < m_tabWidget->count(); ++i) {
+        QWidget* w = m_tabWidget->widget(i);
+        const int tabId = tabIdOf(w);
+        if (m_dirtyTabs.contains(tabId)) session->saveTab(tabId, tabStateOf(w));
+        window.tabs.append(tabId);
+    }
+    m_dirtyTabs.clear();
+
+    if (!m_windowDirty) return;
+    m_windowDirty = false;
+    window.geometry = saveGeometry();
+    window.current = m_tabWidget->currentIndex();
+    session->saveWindow(window);
+}
+
 WebView* MainWindow::currentWebView() const
 {
     return qobject_cast<WebView*>(m_tabWidget->currentWidget());
@@ -747,8 +2088,7 @@ QString MainWindow::validateAndNormalizeUrl(const QString& input) const
         return "https://" + trimmed;
     }
 
-    QSettings settings("ArchBrowser", "arch-browser");
-    const QString engine = settings.value("searchEngine", "duckduckgo").toString();
+    const QString engine = Settings::instance()->searchEngine();
     QByteArray encoded = QUrl::toPercentEncoding(trimmed);
 
     if (engine == "google") {
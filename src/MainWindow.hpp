@@ -7,10 +7,14 @@
  * - Address bar with basic URL validation
  * - Find in page (Ctrl+F)
  * - Zoom in/out/reset
- * - Bookmarks (add, menu, persist)
+ * - Bookmarks (folders, lazily built menus, star in the address bar)
  * - HTTPS support (via QtWebEngine/Chromium)
- * - Download handling
+ * - Downloads saved by rule, without prompting (see DownloadManager)
  * - Multiple windows
+ * - Pinned tabs; idle background tabs are paused and unloaded under memory pressure
+ * - Preconnect/prerender of likely next pages (see Predictor)
+ * - Ad and tracker blocking with a per-site allowlist (see AdBlocker)
+ * - Container windows with their own cookies and cache (see ContainerManager)
  */
 
 #ifndef MAINWINDOW_HPP
@@ -22,29 +26,59 @@
 #include <QToolBar>
 #include <QTabBar>
 #include <QUrl>
+#include <QPointer>
+#include <QSet>
+#include <QIcon>
+#include <QTimer>
 #include <QWebEngineView>
-#include <QWebEngineDownloadItem>
 
 class WebView;
+class QWebEngineProfile;
 class QProgressBar;
+class QCompleter;
+class QStandardItemModel;
 class FindBar;
+class HistoryWindow;
+class TabPlaceholder;
+class TaskManager;
+class DownloadsWindow;
+struct TabState;
+struct WindowState;
 
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget* parent = nullptr);
+    // Opens with one tab on urlOrSearch, or the home page if empty, in the
+    // given container (the default profile if empty)
+    explicit MainWindow(const QString& urlOrSearch = QString(), const QString& container = QString(),
+                        QWidget* parent = nullptr);
+    // Recreates a window from the saved session; only its active tab loads,
+    // or instead a new tab on urlOrSearch if one is given
+    explicit MainWindow(const WindowState& state, const QString& urlOrSearch = QString(),
+                        QWidget* parent = nullptr);
     ~MainWindow();
 
+    // Reopens every window of the last session, with urlOrSearch (if any)
+    // in a new tab of the last one; returns the last one, or nullptr if
+    // there was nothing to restore
+    static MainWindow* restoreSession(const QString& urlOrSearch = QString());
+
     // Called from main.cpp or when opening URL in new window
     void navigateTo(const QString& urlOrSearch);
+    void openInNewTab(const QString& urlOrSearch);
+
+    // Called by WebView::createWindow when page requests new tab/window.
+    // Views start blank; Chromium fills them with the requested page.
+    QWebEngineView* createTabForExternalRequest(QWebEnginePage::WebWindowType type);
 
-    // Called by WebView::createWindow when page requests new tab/window
-    QWebEngineView* createTabForExternalRequest();
+protected:
+    void closeEvent(QCloseEvent* event) override;
 
 private slots:
     void onNewWindow();
+    void onNewOffTheRecordWindow();
     void onNewTab();
     void onCloseTab(int index);
     void onTabChanged(int index);
@@ -53,13 +87,13 @@ private slots:
     void onCurrentViewLoadProgress(int progress);
     void onGoClicked();
     void onAddressBarReturnPressed();
+    void onAddressBarEdited(const QString& text);
+    void onCompletionActivated(const QModelIndex& index);
     void onBackClicked();
     void onForwardClicked();
     void onRefreshClicked();
     void onStopClicked();
     void onHomeClicked();
-    void onDownloadRequested(QWebEngineDownloadItem* download);
-    void onDownloadFinished();
     void onFindInPage();
     void onZoomIn();
     void onZoomOut();
@@ -67,29 +101,77 @@ private slots:
     void onAddBookmark();
     void onRemoveBookmark();
     void onManageBookmarks();
+    void onImport();
     void onBookmarkTriggered(QAction* action);
     void onSetHomePage();
     void onShowHistory();
+    void onShowTaskManager();
+    void onShowDownloads();
     void onClearHistory();
+    void onManageCookies();
+    void onSearchPageContents();
     void onPageLoadedForHistory(const QUrl& url, const QString& title);
     void onOpenSettings();
     void onReopenClosedTab();
+    void onTabContextMenu(const QPoint& pos);
+    // Swaps a background tab's view for a placeholder, freeing its renderer
+    void discardTab(QWebEngineView* view);
 
 private:
-    WebView* addTab(const QUrl& url = QUrl("https://google.com"));
+    // A window with no tabs yet, for popups to be adopted into
+    struct NoTab {};
+    MainWindow(NoTab, const QString& container, QWidget* parent = nullptr);
+
+    void init();
+    WebView* addTab(const QUrl& url);
+    WebView* addRestoredTab(const TabState& state);
+    void addPlaceholderTab(int tabId, const TabState& state);
+    // Turns a placeholder tab into a live WebView (no-op for live tabs)
+    WebView* materializeTab(int index);
+    void replaceTabWidget(int index, QWidget* with);
+    TabPlaceholder* replaceWithPlaceholder(int index, const TabState& state);
+    // At most BACKGROUND_LOAD_SLOTS link-opened background tabs load at once
+    void startBackgroundLoad(QWebEngineView* view);
+    void pumpBackgroundLoads();
+    void setTabPinned(int index, bool pinned);
+    void updateTabIcon(int index);
+    // pooled: take a prewarmed view from WebViewPool when one is ready
+    WebView* createWebView(int tabId, bool pooled = true);
+    // Gives a view its tab id and this window's signal connections
+    WebView* setUpWebView(WebView* view, int tabId);
+    // Swaps the tab for Predictor's prerender of url, if it has one
+    bool adoptPrerender(int index, const QUrl& url);
+    void restoreTab(WebView* view, const TabState& state);
+    int tabIdOf(QWidget* tab) const;
+    TabState tabStateOf(QWidget* tab) const;
+    void markTabDirty(QWidget* tab);
+    void markWindowDirty();
+    void saveSession();
     WebView* currentWebView() const;
     void updateNavigationButtons();
     // Basic URL validation: ensures http/https or converts search to URL
     QString validateAndNormalizeUrl(const QString& input) const;
-    void loadBookmarks();
-    void saveBookmarks();
-    void rebuildBookmarksMenu();
+    void populateBookmarkMenu(QMenu* menu, int folderId);
+    void populateContainerMenu(QMenu* menu);
+    void markBookmarkFolderStale(int folderId);
+    void updateBookmarkStar();
+    void updateAdBlockAction();
     void addToHistory(const QString& url, const QString& title);
-    void loadHistory();
-    void saveHistory();
+    void indexPageText(WebView* view);
 
+    int m_windowId;
+    QString m_container;
+    QWebEngineProfile* m_profile = nullptr;
+    // Nothing from this window reaches history, the session or disk caches
+    bool m_offTheRecord = false;
+    QSet<int> m_dirtyTabs;
+    bool m_windowDirty = false;
+    QTimer m_sessionTimer;
     QTabWidget* m_tabWidget;
     QLineEdit* m_addressBar;
+    QCompleter* m_completer;
+    QStandardItemModel* m_completionModel;
+    bool m_completionActivated = false;
     QToolBar* m_toolbar;
     QAction* m_backAction;
     QAction* m_forwardAction;
@@ -99,11 +181,21 @@ private:
     QProgressBar* m_progressBar;
     FindBar* m_findBar;
     QMenu* m_bookmarksMenu;
-    struct Bookmark { QString title; QString url; };
-    struct HistoryEntry { QString url; QString title; qint64 timestamp; };
-    QList<Bookmark> m_bookmarks;
-    QList<HistoryEntry> m_history;
-    QList<QUrl> m_closedTabs;
+    QSet<int> m_staleBookmarkMenus;
+    QAction* m_bookmarkStar;
+    QAction* m_adBlockAction;
+    QIcon m_starOn;
+    QIcon m_starOff;
+    QPointer<HistoryWindow> m_historyWindow;
+    QPointer<TaskManager> m_taskManager;
+    QPointer<DownloadsWindow> m_downloadsWindow;
+    QPointer<QWidget> m_backgroundOpener;
+    QPointer<QWidget> m_lastBackgroundTab;
+    QSet<QWebEngineView*> m_backgroundLoads;
+    QList<QPointer<TabPlaceholder>> m_backgroundQueue;
+    static constexpr int BOOKMARK_MENU_FIXED_ACTIONS = 5;
+    static constexpr int MAX_BOOKMARK_MENU_ITEMS = 500;
+    static constexpr int MAX_COMPLETIONS = 8;
     static constexpr double ZOOM_STEP = 1.2;
     static constexpr double ZOOM_MIN = 0.25;
     static constexpr double ZOOM_MAX = 5.0;
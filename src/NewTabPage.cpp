@@ -0,0 +1,177 @@
+/**
+ * NewTabPage implementation
+ */
+
+#include "NewTabPage.hpp"
+#include "BrowserData.hpp"
+#include "HistoryStore.hpp"
+#include "OmniboxIndex.hpp"
+#include "ThumbnailCache.hpp"
+#include <QBuffer>
+#include <QDateTime>
+#include <QHash>
+#include <QStringList>
+#include <QUrl>
+#include <QWebEngineUrlRequestJob>
+#include <QWebEngineUrlScheme>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+
+// History changes in bursts (a page load is a visit plus a title update)
+const int UPDATE_DELAY_MS = 2000;
+
+const char* const PAGE_HEAD =
+    "<!DOCTYPE html><html><head><meta charset=\"utf-8\">"
+    "<meta http-equiv=\"Content-Security-Policy\" "
+    "content=\"default-src 'none'; img-src archbrowser:; style-src 'unsafe-inline'\">"
+    "<title>New Tab</title><style>"
+    "body{margin:0;font:14px sans-serif;background:#f4f4f6;color:#222}"
+    "@media (prefers-color-scheme:dark){body{background:#202124;color:#e8eaed}"
+    ".tile{background:#2d2e31}}"
+    ".grid{display:grid;grid-template-columns:repeat(4,176px);gap:20px;"
+    "justify-content:center;padding-top:18vh}"
+    ".tile{display:block;border-radius:8px;overflow:hidden;background:#fff;"
+    "color:inherit;text-decoration:none;box-shadow:0 1px 3px rgba(0,0,0,.2)}"
+    ".tile:hover{box-shadow:0 2px 8px rgba(0,0,0,.35)}"
+    ".thumb{width:176px;height:110px;object-fit:cover;display:block}"
+    ".letter{width:176px;height:110px;display:flex;align-items:center;"
+    "justify-content:center;font-size:44px;background:#1793d1;color:#fff}"
+    ".name{padding:8px 10px;white-space:nowrap;overflow:hidden;text-overflow:ellipsis}"
+    "</style></head><body><div class=\"grid\">";
+
+const char* const PAGE_TAIL = "</div></body></html>";
+
+} // namespace
+
+void NewTabPage::registerScheme()
+{
+    QWebEngineUrlScheme scheme(SCHEME);
+    scheme.setSyntax(QWebEngineUrlScheme::Syntax::Host);
+    scheme.setFlags(QWebEngineUrlScheme::SecureScheme | QWebEngineUrlScheme::LocalScheme);
+    QWebEngineUrlScheme::registerScheme(scheme);
+}
+
+NewTabPage::NewTabPage(Content content, QObject* parent)
+    : QWebEngineUrlSchemeHandler(parent)
+{
+    rebuildHtml();
+    if (content == Blank) return;
+
+    BrowserData* data = BrowserData::instance();
+    HistoryStore* history = data->history();
+    ThumbnailCache* thumbnails = data->thumbnails();
+
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(UPDATE_DELAY_MS);
+    connect(&m_updateTimer, &QTimer::timeout, this, [this, history]() {
+        if (m_watcher.isRunning()) {
+            m_updateTimer.start();
+            return;
+        }
+        m_watcher.setFuture(QtConcurrent::run(&NewTabPage::topSites, history->snapshot()));
+    });
+    connect(&m_watcher, &QFutureWatcher<QVector<Site>>::finished, this, [this, thumbnails]() {
+        m_sites = m_watcher.result();
+        QStringList urls;
+        for (const Site& site : qAsConst(m_sites)) urls.append(site.url);
+        thumbnails->setWanted(urls);
+        rebuildHtml();
+    });
+
+    connect(history, &HistoryStore::loaded, this, [this]() { m_updateTimer.start(0); });
+    connect(history, &HistoryStore::visited, this, &NewTabPage::scheduleUpdate);
+    connect(history, &HistoryStore::removed, this, &NewTabPage::scheduleUpdate);
+    connect(history, &HistoryStore::removedMany, this, &NewTabPage::scheduleUpdate);
+    connect(history, &HistoryStore::cleared, this, &NewTabPage::scheduleUpdate);
+    connect(history, &HistoryStore::imported, this, &NewTabPage::scheduleUpdate);
+    connect(thumbnails, &ThumbnailCache::thumbnailReady, this, &NewTabPage::rebuildHtml);
+
+    if (history->isLoaded()) m_updateTimer.start(0);
+}
+
+void NewTabPage::scheduleUpdate()
+{
+    if (!m_updateTimer.isActive()) m_updateTimer.start();
+}
+
+QVector<NewTabPage::Site> NewTabPage::topSites(const QVector<HistoryEntry>& history)
+{
+    struct Candidate
+    {
+        const HistoryEntry* entry;
+        double score;
+    };
+
+    // The best-scoring page of each host stands in for the whole site
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QHash<QString, Candidate> byHost;
+    for (const HistoryEntry& entry : history) {
+        if (entry.isNull()) continue;
+        const QUrl url(entry.url);
+        if (url.scheme() != QLatin1String("http") && url.scheme() != QLatin1String("https")) continue;
+        const double score = OmniboxIndex::frecency(entry.visitCount, entry.timestamp, false, now);
+        auto it = byHost.find(url.host());
+        if (it == byHost.end()) byHost.insert(url.host(), {&entry, score});
+        else if (score > it->score) *it = {&entry, score};
+    }
+
+    QVector<Candidate> candidates;
+    candidates.reserve(byHost.size());
+    for (const Candidate& c : qAsConst(byHost)) candidates.append(c);
+    const int n = qMin(int(TILE_COUNT), candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end(),
+                      [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+
+    QVector<Site> sites;
+    for (int i = 0; i < n; ++i) sites.append({candidates.at(i).entry->url, candidates.at(i).entry->title});
+    return sites;
+}
+
+void NewTabPage::rebuildHtml()
+{
+    ThumbnailCache* thumbnails = BrowserData::instance()->thumbnails();
+    QString body;
+    for (const Site& site : qAsConst(m_sites)) {
+        const QUrl url(site.url);
+        const QString title = site.title.isEmpty() ? url.host() : site.title;
+        const QString key = ThumbnailCache::keyFor(site.url);
+        body += QStringLiteral("<a class=\"tile\" href=\"%1\" title=\"%2\">")
+                    .arg(url.toString(QUrl::FullyEncoded).toHtmlEscaped(), title.toHtmlEscaped());
+        if (!thumbnails->thumbnail(key).isEmpty()) {
+            body += QStringLiteral("<img class=\"thumb\" alt=\"\" src=\"%1://thumbnail/%2\">").arg(SCHEME, key);
+        } else {
+            QString host = url.host();
+            if (host.startsWith(QLatin1String("www."))) host.remove(0, 4);
+            body += QStringLiteral("<div class=\"letter\">%1</div>").arg(host.left(1).toUpper().toHtmlEscaped());
+        }
+        body += QStringLiteral("<div class=\"name\">%1</div></a>").arg(title.toHtmlEscaped());
+    }
+    m_html = QByteArray(PAGE_HEAD) + body.toUtf8() + PAGE_TAIL;
+}
+
+void NewTabPage::requestStarted(QWebEngineUrlRequestJob* job)
+{
+    const QUrl url = job->requestUrl();
+    QByteArray content;
+    QByteArray mimeType;
+    if (url.host() == QLatin1String("newtab")) {
+        content = m_html;
+        mimeType = "text/html";
+    } else if (url.host() == QLatin1String("thumbnail") && !m_sites.isEmpty()) {
+        // A blank page has no tiles and serves no thumbnails either
+        content = BrowserData::instance()->thumbnails()->thumbnail(url.path().mid(1));
+        mimeType = "image/jpeg";
+    }
+    if (content.isEmpty()) {
+        job->fail(QWebEngineUrlRequestJob::UrlNotFound);
+        return;
+    }
+
+    // The job reads the buffer after this returns; it shares the byte array
+    QBuffer* buffer = new QBuffer(job);
+    buffer->setData(content);
+    buffer->open(QIODevice::ReadOnly);
+    job->reply(mimeType, buffer);
+}
@@ -0,0 +1,63 @@
+/**
+ * NewTabPage - archbrowser://newtab, served from memory
+ *
+ * A QWebEngineUrlSchemeHandler for the browser's own scheme. The new tab
+ * page lists the most frecent sites (one tile per host) with thumbnails
+ * from ThumbnailCache. Its HTML is rebuilt off the request path whenever
+ * history or a thumbnail changes, so a request is answered from a ready
+ * QByteArray; the page has no scripts and loads nothing from the network.
+ * Off-the-record profiles get an instance with no tiles, so a private
+ * window never shows what was visited outside it.
+ *
+ *   archbrowser://newtab            the page itself
+ *   archbrowser://thumbnail/<key>   a tile's JPEG (see ThumbnailCache::keyFor)
+ */
+
+#ifndef NEWTABPAGE_HPP
+#define NEWTABPAGE_HPP
+
+#include <QWebEngineUrlSchemeHandler>
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+struct HistoryEntry;
+
+class NewTabPage : public QWebEngineUrlSchemeHandler
+{
+    Q_OBJECT
+
+public:
+    static constexpr const char* SCHEME = "archbrowser";
+    static constexpr const char* URL = "archbrowser://newtab";
+
+    // Must run before QApplication is constructed
+    static void registerScheme();
+
+    enum Content { TopSites, Blank };
+
+    explicit NewTabPage(Content content, QObject* parent = nullptr);
+
+    void requestStarted(QWebEngineUrlRequestJob* job) override;
+
+private:
+    struct Site
+    {
+        QString url;
+        QString title;
+    };
+
+    static QVector<Site> topSites(const QVector<HistoryEntry>& history);
+    void scheduleUpdate();
+    void rebuildHtml();
+
+    QVector<Site> m_sites;
+    QByteArray m_html;
+    QTimer m_updateTimer;
+    QFutureWatcher<QVector<Site>> m_watcher;
+    static constexpr int TILE_COUNT = 8;
+};
+
+#endif // NEWTABPAGE_HPP
@@ -0,0 +1,275 @@
+/**
+ * OmniboxIndex implementation
+ */
+
+#include "OmniboxIndex.hpp"
+#include "BookmarkStore.hpp"
+#include "HistoryStore.hpp"
+#include <QDateTime>
+#include <QUrl>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const qint64 MS_PER_DAY = 24LL * 60 * 60 * 1000;
+const int MAX_TOKENS_PER_ITEM = 32;
+// Per-keystroke work bounds: candidates scored, prefix tokens expanded,
+// and ids taken from each expanded token's (newest-last) posting list
+const int CANDIDATE_BUDGET = 20000;
+const int MAX_PREFIX_TOKENS = 4096;
+const int PER_TOKEN_CANDIDATES = 256;
+const int COMPACT_MIN_DEAD = 16384;
+
+QString stripUrlPrefix(QString s)
+{
+    if (s.startsWith(QLatin1String("https://"))) s.remove(0, 8);
+    else if (s.startsWith(QLatin1String("http://"))) s.remove(0, 7);
+    if (s.startsWith(QLatin1String("www."))) s.remove(0, 4);
+    return s;
+}
+
+void splitWords(const QString& text, QStringList& out)
+{
+    int start = -1;
+    for (int i = 0; i <= text.size(); ++i) {
+        const bool word = i < text.size() && text.at(i).isLetterOrNumber();
+        if (word && start < 0) {
+            start = i;
+        } else if (!word && start >= 0) {
+            out.append(text.mid(start, i - start));
+            start = -1;
+        }
+    }
+}
+
+} // namespace
+
+OmniboxIndex::OmniboxIndex(QObject* parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<Data>::finished, this, [this]() {
+        m_data = m_watcher.result();
+        m_building = false;
+        const QVector<std::function<void()>> pending = m_pending;
+        m_pending.clear();
+        for (const auto& fn : pending) fn();
+    });
+}
+
+void OmniboxIndex::rebuild(const QVector<HistoryEntry>& history, const QList<Bookmark>& bookmarks)
+{
+    runBuild([history, bookmarks]() {
+        QVector<Item> items;
+        items.reserve(history.size() + bookmarks.size());
+        QHash<QString, int> seen;
+        // History is oldest-first, which keeps the newest-last id order
+        for (const HistoryEntry& e : history) {
+            if (e.isNull()) continue;
+            seen.insert(e.url, items.size());
+            items.append({e.url, e.title, e.timestamp, e.visitCount, false, true});
+        }
+        for (const Bookmark& b : bookmarks) {
+            auto it = seen.constFind(b.url);
+            if (it != seen.constEnd()) {
+                items[it.value()].bookmarked = true;
+            } else {
+                seen.insert(b.url, items.size());
+                items.append({b.url, b.title, 0, 0, true, true});
+            }
+        }
+        return build(items);
+    });
+}
+
+void OmniboxIndex::noteVisit(const HistoryEntry& entry)
+{
+    whenReady([this, entry]() {
+        Item item{entry.url, entry.title, entry.timestamp, entry.visitCount, false, true};
+        auto it = m_data.idByUrl.constFind(entry.url);
+        if (it != m_data.idByUrl.constEnd()) {
+            item.bookmarked = m_data.items.at(it.value()).bookmarked;
+        }
+        insert(m_data, item);
+        maybeCompact();
+    });
+}
+
+void OmniboxIndex::removeHistory(const QString& url)
+{
+    whenReady([this, url]() {
+        auto it = m_data.idByUrl.find(url);
+        if (it == m_data.idByUrl.end()) return;
+        Item& item = m_data.items[it.value()];
+        if (item.bookmarked) {
+            item.visitCount = 0;
+            item.lastVisit = 0;
+        } else {
+            item.alive = false;
+            ++m_data.dead;
+            m_data.idByUrl.erase(it);
+        }
+    });
+}
+
+void OmniboxIndex::setBookmarked(const QString& url, const QString& title, bool bookmarked)
+{
+    whenReady([this, url, title, bookmarked]() {
+        auto it = m_data.idByUrl.find(url);
+        if (it != m_data.idByUrl.end()) {
+            Item& item = m_data.items[it.value()];
+            item.bookmarked = bookmarked;
+            if (!bookmarked && item.visitCount == 0) {
+                item.alive = false;
+                ++m_data.dead;
+                m_data.idByUrl.erase(it);
+            }
+        } else if (bookmarked) {
+            insert(m_data, {url, title, 0, 0, true, true});
+        }
+    });
+}
+
+QVector<OmniboxIndex::Match> OmniboxIndex::query(const QString& text, int limit) const
+{
+    QVector<Match> results;
+    const QString q = stripUrlPrefix(text.trimmed().toLower());
+    QStringList terms;
+    splitWords(q, terms);
+    if (terms.isEmpty() || limit <= 0) return results;
+
+    // Drive the lookup with the most selective (longest) term
+    QString primary = terms.first();
+    for (const QString& t : qAsConst(terms)) {
+        if (t.size() > primary.size()) primary = t;
+    }
+
+    QVector<int> candidates;
+    candidates.reserve(CANDIDATE_BUDGET);
+    auto it = m_data.postings.lowerBound(primary);
+    if (it != m_data.postings.constEnd() && it.key() == primary) {
+        const QVector<int>& ids = it.value();
+        for (int i = ids.size() - 1; i >= 0 && candidates.size() < CANDIDATE_BUDGET; --i) {
+            candidates.append(ids.at(i));
+        }
+        ++it;
+    }
+    int expanded = 0;
+    for (; it != m_data.postings.constEnd() && it.key().startsWith(primary)
+           && expanded < MAX_PREFIX_TOKENS && candidates.size() < CANDIDATE_BUDGET;
+         ++it, ++expanded) {
+        const QVector<int>& ids = it.value();
+        const int stop = qMax(0, ids.size() - PER_TOKEN_CANDIDATES);
+        for (int i = ids.size() - 1; i >= stop && candidates.size() < CANDIDATE_BUDGET; --i) {
+            candidates.append(ids.at(i));
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int id : qAsConst(candidates)) {
+        const Item& item = m_data.items.at(id);
+        if (!item.alive) continue;
+        const QString url = stripUrlPrefix(item.url.toLower());
+        const QString title = item.title.toLower();
+        bool all = true;
+        for (const QString& t : qAsConst(terms)) {
+            if (!url.contains(t) && !title.contains(t)) { all = false; break; }
+        }
+        if (!all) continue;
+        double score = frecency(item.visitCount, item.lastVisit, item.bookmarked, now);
+        // Typing the start of a URL is a strong signal for that site
+        if (url.startsWith(q)) score *= 4;
+        results.append({item.url, item.title, item.bookmarked, score});
+    }
+
+    const int n = qMin(limit, results.size());
+    std::partial_sort(results.begin(), results.begin() + n, results.end(),
+                      [](const Match& a, const Match& b) { return a.score > b.score; });
+    results.resize(n);
+    return results;
+}
+
+double OmniboxIndex::frecency(int visitCount, qint64 lastVisit, bool bookmarked, qint64 now)
+{
+    const double days = double(now - lastVisit) / MS_PER_DAY;
+    double weight;
+    if (days < 4) weight = 100;
+    else if (days < 14) weight = 70;
+    else if (days < 31) weight = 50;
+    else if (days < 90) weight = 30;
+    else weight = 10;
+    double score = weight * std::max(1, visitCount);
+    if (bookmarked) score += 140;
+    return score;
+}
+
+OmniboxIndex::Data OmniboxIndex::build(const QVector<Item>& items)
+{
+    Data data;
+    data.items.reserve(items.size());
+    data.idByUrl.reserve(items.size());
+    for (const Item& item : items) {
+        if (item.alive) insert(data, item);
+    }
+    return data;
+}
+
+void OmniboxIndex::insert(Data& data, Item item)
+{
+    auto it = data.idByUrl.find(item.url);
+    const int id = data.items.size();
+    if (it != data.idByUrl.end()) {
+        // Superseded entries stay in posting lists until the next compaction
+        data.items[it.value()].alive = false;
+        ++data.dead;
+        it.value() = id;
+    } else {
+        data.idByUrl.insert(item.url, id);
+    }
+    item.alive = true;
+    const QStringList tokens = tokenize(item.url, item.title);
+    data.items.append(item);
+    for (const QString& token : tokens) {
+        data.postings[token].append(id);
+    }
+}
+
+QStringList OmniboxIndex::tokenize(const QString& url, const QString& title)
+{
+    QStringList tokens;
+    const QString lowerUrl = url.toLower();
+    const QString host = stripUrlPrefix(QUrl(lowerUrl).host());
+    if (!host.isEmpty()) tokens.append(host);
+    splitWords(stripUrlPrefix(lowerUrl), tokens);
+    splitWords(title.toLower(), tokens);
+    tokens.removeDuplicates();
+    if (tokens.size() > MAX_TOKENS_PER_ITEM) tokens = tokens.mid(0, MAX_TOKENS_PER_ITEM);
+    return tokens;
+}
+
+void OmniboxIndex::runBuild(std::function<Data()> job)
+{
+    // A newer build supersedes any running one (setFuture drops the old
+    // result) and the updates queued for it, which are already in its input
+    m_pending.clear();
+    m_building = true;
+    m_watcher.setFuture(QtConcurrent::run(job));
+}
+
+void OmniboxIndex::whenReady(std::function<void()> fn)
+{
+    if (m_building) {
+        m_pending.append(std::move(fn));
+    } else {
+        fn();
+    }
+}
+
+void OmniboxIndex::maybeCompact()
+{
+    if (m_data.dead < COMPACT_MIN_DEAD || m_data.dead < m_data.idByUrl.size()) return;
+    runBuild([items = m_data.items]() { return build(items); });
+}
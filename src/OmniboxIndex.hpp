@@ -0,0 +1,89 @@
+/**
+ * OmniboxIndex - Frecency-ranked completion index over history and bookmarks
+ *
+ * Token -> posting list index over URL and title words, maintained
+ * incrementally as pages are visited. A query looks up the most selective
+ * term by prefix, scans a bounded number of the most recently visited
+ * candidates and ranks them by frecency (visit count weighted by recency),
+ * so each keystroke costs the same whether history holds 1k or 1M pages.
+ *
+ * The initial build and periodic compaction run on a worker thread; updates
+ * that arrive meanwhile are queued and applied once the new index is in.
+ */
+
+#ifndef OMNIBOXINDEX_HPP
+#define OMNIBOXINDEX_HPP
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QVector>
+#include <functional>
+
+struct HistoryEntry;
+struct Bookmark;
+
+class OmniboxIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Match
+    {
+        QString url;
+        QString title;
+        bool bookmarked = false;
+        double score = 0;
+    };
+
+    explicit OmniboxIndex(QObject* parent = nullptr);
+
+    // Replaces the whole index, built off the GUI thread
+    void rebuild(const QVector<HistoryEntry>& history, const QList<Bookmark>& bookmarks);
+
+    void noteVisit(const HistoryEntry& entry);
+    void removeHistory(const QString& url);
+    void setBookmarked(const QString& url, const QString& title, bool bookmarked);
+
+    QVector<Match> query(const QString& text, int limit) const;
+
+    // Visit count weighted by how recently the page was last visited
+    static double frecency(int visitCount, qint64 lastVisit, bool bookmarked, qint64 now);
+
+private:
+    struct Item
+    {
+        QString url;
+        QString title;
+        qint64 lastVisit = 0;
+        int visitCount = 0;
+        bool bookmarked = false;
+        bool alive = true;
+    };
+
+    struct Data
+    {
+        QVector<Item> items;                  // ids are positions; newest last
+        QHash<QString, int> idByUrl;
+        QMap<QString, QVector<int>> postings; // token -> ascending item ids
+        int dead = 0;
+    };
+
+    static Data build(const QVector<Item>& items);
+    static void insert(Data& data, Item item);
+    static QStringList tokenize(const QString& url, const QString& title);
+
+    void runBuild(std::function<Data()> job);
+    void whenReady(std::function<void()> fn);
+    void maybeCompact();
+
+    Data m_data;
+    bool m_building = false;
+    QVector<std::function<void()>> m_pending;
+    QFutureWatcher<Data> m_watcher;
+};
+
+#endif // OMNIBOXINDEX_HPP
@@ -0,0 +1,786 @@
+/**
+ * PageTextIndex implementation
+ *
+ * Segment file layout (little endian):
+ *   [0]  "ABFS"  [4] u32 version  [8] u32 termCount  [12] u32 docCount
+ *   [16] u32 minDoc  [20] u32 maxDoc  [24] u64 entriesOffset  [32] u64 poolOffset
+ *   [40] postings: per term, (docDelta varint, tf varint)* with ascending docs
+ *   entries: termCount x { u32 termOffset, u32 termLength, u64 postingsOffset,
+ *                          u32 postingsLength, u32 docFreq }, sorted by term bytes
+ *   pool: UTF-8 term bytes
+ */
+
+#include "PageTextIndex.hpp"
+#include "Journal.hpp"
+#include "Settings.hpp"
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+const char SEG_MAGIC[4] = { 'A', 'B', 'F', 'S' };
+const quint32 SEG_VERSION = 1;
+const int SEG_HEADER_SIZE = 40;
+const int ENTRY_SIZE = 24;
+
+const int MAX_TEXT_CHARS = 200000;
+const int MIN_TERM_CHARS = 2;
+const int MAX_TERM_CHARS = 32;
+const int FLUSH_DOCS = 128;
+const qint64 FLUSH_BYTES = 8 * 1024 * 1024;
+const int MAX_SEGMENTS = 10;
+const int MERGE_FACTOR = 4;
+const qint64 REINDEX_AFTER_MS = 60 * 60 * 1000;
+const double BM25_K1 = 1.2;
+const double BM25_B = 0.75;
+
+enum DocRecord : quint8 {
+    DocAdd = 1,
+    DocDelete = 2
+};
+
+struct Posting
+{
+    quint32 doc;
+    quint32 tf;
+};
+
+struct DocInfo
+{
+    QString url;
+    QString title;
+    qint64 timestamp = 0;
+    quint32 length = 0;
+};
+
+void putVarint(QByteArray& out, quint32 v)
+{
+    while (v >= 0x80) {
+        out.append(char((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.append(char(v));
+}
+
+bool getVarint(const uchar*& p, const uchar* end, quint32& v)
+{
+    v = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7) {
+        const uchar b = *p++;
+        v |= quint32(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+QVector<Posting> decodePostings(const uchar* p, quint32 len)
+{
+    QVector<Posting> out;
+    const uchar* end = p + len;
+    quint32 doc = 0;
+    while (p < end) {
+        quint32 delta, tf;
+        if (!getVarint(p, end, delta) || !getVarint(p, end, tf)) break;
+        doc += delta;
+        out.append({doc, tf});
+    }
+    return out;
+}
+
+int compareTerm(const char* a, int alen, const QByteArray& b)
+{
+    const int c = std::memcmp(a, b.constData(), size_t(qMin(alen, b.size())));
+    if (c != 0) return c;
+    return alen - b.size();
+}
+
+// Lowercased letter/digit runs; very short and very long runs are noise
+QVector<QByteArray> tokenize(const QString& text)
+{
+    QVector<QByteArray> terms;
+    int start = -1;
+    const int n = qMin(text.size(), MAX_TEXT_CHARS);
+    for (int i = 0; i <= n; ++i) {
+        const bool word = i < n && text.at(i).isLetterOrNumber();
+        if (word && start < 0) {
+            start = i;
+        } else if (!word && start >= 0) {
+            const int len = i - start;
+            if (len >= MIN_TERM_CHARS && len <= MAX_TERM_CHARS) {
+                terms.append(text.mid(start, len).toLower().toUtf8());
+            }
+            start = -1;
+        }
+    }
+    return terms;
+}
+
+class Segment
+{
+public:
+    bool open(const QString& path)
+    {
+        m_file.setFileName(path);
+        if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < SEG_HEADER_SIZE) return false;
+        m_size = m_file.size();
+        m_map = m_file.map(0, m_size);
+        if (!m_map || std::memcmp(m_map, SEG_MAGIC, 4) != 0
+            || u32(4) != SEG_VERSION) {
+            return false;
+        }
+        m_termCount = u32(8);
+        m_docCount = u32(12);
+        m_minDoc = u32(16);
+        m_maxDoc = u32(20);
+        const quint64 entries = qFromLittleEndian<quint64>(m_map + 24);
+        const quint64 pool = qFromLittleEndian<quint64>(m_map + 32);
+        // Compared without adding, so huge values can't wrap around
+        if (pool > quint64(m_size) || entries < quint64(SEG_HEADER_SIZE) || entries > pool
+            || (pool - entries) / ENTRY_SIZE < m_termCount) {
+            return false;
+        }
+        m_entries = qint64(entries);
+        m_pool = qint64(pool);
+        return validate();
+    }
+
+    // Binary search over the sorted entry table, directly on the mapping
+    int find(const QByteArray& term) const
+    {
+        int lo = 0, hi = int(m_termCount) - 1;
+        while (lo <= hi) {
+            const int mid = (lo + hi) / 2;
+            const int c = compareTerm(termData(mid), termLength(mid), term);
+            if (c == 0) return mid;
+            if (c < 0) lo = mid + 1; else hi = mid - 1;
+        }
+        return -1;
+    }
+
+    QByteArray term(int i) const { return QByteArray(termData(i), termLength(i)); }
+    quint32 docFreq(int i) const { return entryU32(i, 20); }
+    QVector<Posting> postings(int i) const
+    {
+        const quint64 off = qFromLittleEndian<quint64>(m_map + m_entries + qint64(i) * ENTRY_SIZE + 8);
+        const quint32 len = entryU32(i, 16);
+        if (off + len > quint64(m_size)) return {};
+        return decodePostings(m_map + off, len);
+    }
+
+    QString path() const { return m_file.fileName(); }
+    QString name() const { return QFileInfo(m_file).fileName(); }
+    qint64 size() const { return m_size; }
+    int termCount() const { return int(m_termCount); }
+    quint32 docCount() const { return m_docCount; }
+    quint32 minDoc() const { return m_minDoc; }
+    quint32 maxDoc() const { return m_maxDoc; }
+
+private:
+    // A truncated or corrupt segment must not send a search out of the
+    // mapping: every term lies in the pool and every postings list between
+    // the header and the entry table
+    bool validate() const
+    {
+        const quint64 poolSize = quint64(m_size - m_pool);
+        for (int i = 0; i < int(m_termCount); ++i) {
+            if (quint64(entryU32(i, 0)) + entryU32(i, 4) > poolSize) return false;
+            const quint64 off = qFromLittleEndian<quint64>(m_map + m_entries + qint64(i) * ENTRY_SIZE + 8);
+            if (off < quint64(SEG_HEADER_SIZE) || off > quint64(m_entries)
+                || entryU32(i, 16) > quint64(m_entries) - off) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    quint32 u32(qint64 off) const { return qFromLittleEndian<quint32>(m_map + off); }
+    quint32 entryU32(int i, int field) const { return u32(m_entries + qint64(i) * ENTRY_SIZE + field); }
+    const char* termData(int i) const { return reinterpret_cast<const char*>(m_map + m_pool + entryU32(i, 0)); }
+    int termLength(int i) const { return int(entryU32(i, 4)); }
+
+    QFile m_file;
+    uchar* m_map = nullptr;
+    qint64 m_size = 0;
+    quint32 m_termCount = 0;
+    quint32 m_docCount = 0;
+    quint32 m_minDoc = 0;
+    quint32 m_maxDoc = 0;
+    qint64 m_entries = 0;
+    qint64 m_pool = 0;
+};
+
+class SegmentWriter
+{
+public:
+    bool begin(const QString& path)
+    {
+        m_file.setFileName(path);
+        if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+        m_file.write(QByteArray(SEG_HEADER_SIZE, '\0'));
+        return true;
+    }
+
+    // Terms must be added in ascending byte order
+    void add(const QByteArray& term, const QVector<Posting>& postings)
+    {
+        QByteArray data;
+        data.reserve(postings.size() * 3);
+        quint32 prev = 0;
+        for (const Posting& p : postings) {
+            putVarint(data, p.doc - prev);
+            putVarint(data, p.tf);
+            prev = p.doc;
+        }
+        char entry[ENTRY_SIZE];
+        qToLittleEndian<quint32>(quint32(m_pool.size()), entry);
+        qToLittleEndian<quint32>(quint32(term.size()), entry + 4);
+        qToLittleEndian<quint64>(quint64(m_file.pos()), entry + 8);
+        qToLittleEndian<quint32>(quint32(data.size()), entry + 16);
+        qToLittleEndian<quint32>(quint32(postings.size()), entry + 20);
+        m_entries.append(entry, ENTRY_SIZE);
+        m_pool.append(term);
+        m_file.write(data);
+        ++m_terms;
+    }
+
+    bool finish(quint32 docCount, quint32 minDoc, quint32 maxDoc)
+    {
+        const quint64 entriesOffset = quint64(m_file.pos());
+        m_file.write(m_entries);
+        const quint64 poolOffset = quint64(m_file.pos());
+        m_file.write(m_pool);
+
+        char header[SEG_HEADER_SIZE];
+        std::memcpy(header, SEG_MAGIC, 4);
+        qToLittleEndian<quint32>(SEG_VERSION, header + 4);
+        qToLittleEndian<quint32>(m_terms, header + 8);
+        qToLittleEndian<quint32>(docCount, header + 12);
+        qToLittleEndian<quint32>(minDoc, header + 16);
+        qToLittleEndian<quint32>(maxDoc, header + 20);
+        qToLittleEndian<quint64>(entriesOffset, header + 24);
+        qToLittleEndian<quint64>(poolOffset, header + 32);
+        m_file.seek(0);
+        m_file.write(header, SEG_HEADER_SIZE);
+        const bool ok = m_file.flush() && m_file.error() == QFileDevice::NoError;
+        m_file.close();
+        return ok;
+    }
+
+private:
+    QFile m_file;
+    QByteArray m_entries;
+    QByteArray m_pool;
+    quint32 m_terms = 0;
+};
+
+} // namespace
+
+/**
+ * Index state; lives on and is only touched from the index thread
+ */
+class PageTextIndexWorker
+{
+public:
+    explicit PageTextIndexWorker(const QString& dir)
+        : m_dir(dir)
+        , m_docsJournal(dir + "/docs.journal")
+    {
+        QDir().mkpath(dir);
+    }
+
+    void open();
+    void addPage(const QString& url, const QString& title, const QString& text, qint64 timestamp);
+    void removeUrl(const QString& url);
+    void clear();
+    void flush();
+    void setBudget(qint64 bytes) { m_budget = bytes; enforceBudget(); }
+    QVector<PageTextResult> search(const QString& query, int limit);
+
+private:
+    void deleteDoc(quint32 id);
+    void journalDoc(const QByteArray& record);
+    void openSegment(const QString& name);
+    void writeManifest();
+    void maybeMerge();
+    void enforceBudget();
+    void forgetDocsOutsideSegments();
+    bool coveredBySegment(quint32 id) const;
+    QString nextSegmentName() { return QString("seg-%1.idx").arg(m_nextSegment++); }
+
+    QString m_dir;
+    Journal m_docsJournal;
+    int m_docsJournalRecords = 0;
+    QHash<quint32, DocInfo> m_docs;
+    QHash<QString, quint32> m_docByUrl;
+    QSet<quint32> m_deleted;
+    quint32 m_nextDoc = 1;
+    quint64 m_totalLength = 0;
+
+    std::vector<std::unique_ptr<Segment>> m_segments;
+    int m_nextSegment = 1;
+
+    QHash<QByteArray, QVector<Posting>> m_buffer;
+    quint32 m_bufferMinDoc = 0;
+    int m_bufferDocs = 0;
+    qint64 m_bufferBytes = 0;
+    qint64 m_budget = 256LL * 1024 * 1024;
+};
+
+void PageTextIndexWorker::open()
+{
+    quint32 maxId = 0;
+    m_docsJournalRecords = m_docsJournal.replay([&](const QByteArray& payload) {
+        QDataStream ds(payload);
+        quint8 type;
+        quint32 id;
+        ds >> type >> id;
+        if (type == DocAdd) {
+            DocInfo doc;
+            ds >> doc.url >> doc.title >> doc.timestamp >> doc.length;
+            m_docs.insert(id, doc);
+            m_docByUrl.insert(doc.url, id);
+        } else if (type == DocDelete) {
+            auto it = m_docs.find(id);
+            if (it != m_docs.end()) {
+                if (m_docByUrl.value(it.value().url) == id) m_docByUrl.remove(it.value().url);
+                m_docs.erase(it);
+            }
+            m_deleted.insert(id);
+        }
+        maxId = qMax(maxId, id);
+    });
+    m_nextDoc = maxId + 1;
+
+    // The manifest lists live segments; anything else is a leftover from an
+    // interrupted flush or merge
+    QFile manifest(m_dir + "/segments");
+    QStringList live;
+    if (manifest.open(QIODevice::ReadOnly)) {
+        for (const QByteArray& line : manifest.readAll().split('\n')) {
+            if (!line.trimmed().isEmpty()) live.append(QString::fromUtf8(line.trimmed()));
+        }
+    }
+    const QStringList files = QDir(m_dir).entryList({"seg-*"}, QDir::Files);
+    for (const QString& f : files) {
+        const int n = f.mid(4).section('.', 0, 0).toInt();
+        m_nextSegment = qMax(m_nextSegment, n + 1);
+        if (!live.contains(f)) QFile::remove(m_dir + "/" + f);
+    }
+    for (const QString& name : qAsConst(live)) openSegment(name);
+
+    // Documents that were still buffered at exit have no postings
+    forgetDocsOutsideSegments();
+    for (quint32 id : m_deleted.values()) {
+        if (!coveredBySegment(id)) m_deleted.remove(id);
+    }
+    for (auto it = m_docs.cbegin(); it != m_docs.cend(); ++it) {
+        if (!m_deleted.contains(it.key())) m_totalLength += it.value().length;
+    }
+}
+
+void PageTextIndexWorker::addPage(const QString& url, const QString& title, const QString& text,
+                                  qint64 timestamp)
+{
+    auto existing = m_docByUrl.constFind(url);
+    if (existing != m_docByUrl.constEnd()) {
+        const DocInfo& doc = m_docs.value(existing.value());
+        if (timestamp - doc.timestamp < REINDEX_AFTER_MS) return;
+        deleteDoc(existing.value());
+    }
+
+    const QVector<QByteArray> terms = tokenize(text);
+    if (terms.isEmpty()) return;
+    QHash<QByteArray, quint32> tf;
+    for (const QByteArray& t : terms) ++tf[t];
+
+    const quint32 id = m_nextDoc++;
+    if (m_bufferDocs == 0) m_bufferMinDoc = id;
+    for (auto it = tf.cbegin(); it != tf.cend(); ++it) {
+        m_buffer[it.key()].append({id, it.value()});
+        m_bufferBytes += it.key().size() + 8;
+    }
+    ++m_bufferDocs;
+
+    DocInfo doc{url, title, timestamp, quint32(terms.size())};
+    m_docs.insert(id, doc);
+    m_docByUrl.insert(url, id);
+    m_totalLength += doc.length;
+
+    QByteArray record;
+    QDataStream ds(&record, QIODevice::WriteOnly);
+    ds << quint8(DocAdd) << id << doc.url << doc.title << doc.timestamp << doc.length;
+    journalDoc(record);
+
+    if (m_bufferDocs >= FLUSH_DOCS || m_bufferBytes >= FLUSH_BYTES) flush();
+}
+
+void PageTextIndexWorker::removeUrl(const QString& url)
+{
+    auto it = m_docByUrl.constFind(url);
+    if (it != m_docByUrl.constEnd()) deleteDoc(it.value());
+}
+
+void PageTextIndexWorker::clear()
+{
+    m_segments.clear();
+    const QStringList files = QDir(m_dir).entryList({"seg-*"}, QDir::Files);
+    for (const QString& f : files) QFile::remove(m_dir + "/" + f);
+    QFile::remove(m_dir + "/segments");
+    m_docsJournal.rewrite({});
+    m_docsJournalRecords = 0;
+    m_docs.clear();
+    m_docByUrl.clear();
+    m_deleted.clear();
+    m_buffer.clear();
+    m_bufferDocs = 0;
+    m_bufferBytes = 0;
+    m_totalLength = 0;
+}
+
+void PageTextIndexWorker::flush()
+{
+    if (m_bufferDocs == 0) return;
+
+    QList<QByteArray> terms = m_buffer.keys();
+    std::sort(terms.begin(), terms.end());
+    const QString name = nextSegmentName();
+    SegmentWriter writer;
+    if (writer.begin(m_dir + "/" + name)) {
+        for (const QByteArray& t : qAsConst(terms)) writer.add(t, m_buffer.value(t));
+        if (writer.finish(quint32(m_bufferDocs), m_bufferMinDoc, m_nextDoc - 1)) {
+            openSegment(name);
+            writeManifest();
+        }
+    }
+    m_buffer.clear();
+    m_bufferDocs = 0;
+    m_bufferBytes = 0;
+    m_docsJournal.sync();
+
+    maybeMerge();
+    enforceBudget();
+}
+
+QVector<PageTextResult> PageTextIndexWorker::search(const QString& query, int limit)
+{
+    QVector<QByteArray> terms = tokenize(query);
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    if (terms.isEmpty()) return {};
+
+    const double n = qMax(1, m_docs.size());
+    const double avgLen = qMax(1.0, double(m_totalLength) / n);
+
+    struct Acc { double score = 0; int matched = 0; };
+    QHash<quint32, Acc> acc;
+    for (const QByteArray& term : qAsConst(terms)) {
+        QVector<Posting> postings = m_buffer.value(term);
+        for (const auto& seg : m_segments) {
+            const int i = seg->find(term);
+            if (i >= 0) postings += seg->postings(i);
+        }
+        const double df = postings.size();
+        const double idf = std::log(1.0 + (n - df + 0.5) / (df + 0.5));
+        for (const Posting& p : qAsConst(postings)) {
+            if (m_deleted.contains(p.doc)) continue;
+            auto doc = m_docs.constFind(p.doc);
+            if (doc == m_docs.constEnd()) continue;
+            const double tf = p.tf;
+            const double norm = BM25_K1 * (1 - BM25_B + BM25_B * doc.value().length / avgLen);
+            Acc& a = acc[p.doc];
+            a.score += idf * tf * (BM25_K1 + 1) / (tf + norm);
+            ++a.matched;
+        }
+    }
+
+    QVector<PageTextResult> results;
+    for (auto it = acc.cbegin(); it != acc.cend(); ++it) {
+        if (it.value().matched < terms.size()) continue;
+        const DocInfo& doc = m_docs[it.key()];
+        results.append({doc.url, doc.title, doc.timestamp, it.value().score});
+    }
+    const int k = qMin(limit, results.size());
+    std::partial_sort(results.begin(), results.begin() + k, results.end(),
+                      [](const PageTextResult& a, const PageTextResult& b) { return a.score > b.score; });
+    results.resize(k);
+    return results;
+}
+
+void PageTextIndexWorker::deleteDoc(quint32 id)
+{
+    auto it = m_docs.find(id);
+    if (it == m_docs.end()) return;
+    m_totalLength -= qMin<quint64>(m_totalLength, it.value().length);
+    m_docByUrl.remove(it.value().url);
+    m_docs.erase(it);
+    m_deleted.insert(id);
+
+    QByteArray record;
+    QDataStream ds(&record, QIODevice::WriteOnly);
+    ds << quint8(DocDelete) << id;
+    journalDoc(record);
+}
+
+void PageTextIndexWorker::journalDoc(const QByteArray& record)
+{
+    m_docsJournal.append(record);
+    if (++m_docsJournalRecords < 2 * (m_docs.size() + m_deleted.size()) + 1024) return;
+
+    // Compact: one Add per live document plus the tombstones still needed
+    QList<QByteArray> records;
+    for (auto it = m_docs.cbegin(); it != m_docs.cend(); ++it) {
+        QByteArray r;
+        QDataStream ds(&r, QIODevice::WriteOnly);
+        ds << quint8(DocAdd) << it.key() << it.value().url << it.value().title
+           << it.value().timestamp << it.value().length;
+        records.append(r);
+    }
+    for (quint32 id : qAsConst(m_deleted)) {
+        QByteArray r;
+        QDataStream ds(&r, QIODevice::WriteOnly);
+        ds << quint8(DocDelete) << id;
+        records.append(r);
+    }
+    m_docsJournal.rewrite(records);
+    m_docsJournalRecords = records.size();
+}
+
+void PageTextIndexWorker::openSegment(const QString& name)
+{
+    auto seg = std::make_unique<Segment>();
+    if (seg->open(m_dir + "/" + name)) {
+        m_segments.push_back(std::move(seg));
+    } else {
+        seg.reset();
+        QFile::remove(m_dir + "/" + name);
+    }
+}
+
+void PageTextIndexWorker::writeManifest()
+{
+    QSaveFile out(m_dir + "/segments");
+    if (!out.open(QIODevice::WriteOnly)) return;
+    for (const auto& seg : m_segments) {
+        out.write(seg->name().toUtf8() + '\n');
+    }
+    out.commit();
+}
+
+void PageTextIndexWorker::maybeMerge()
+{
+    if (int(m_segments.size()) <= MAX_SEGMENTS) return;
+
+    // Tiered merge: fold the smallest segments together
+    std::sort(m_segments.begin(), m_segments.end(),
+              [](const std::unique_ptr<Segment>& a, const std::unique_ptr<Segment>& b) {
+                  return a->size() < b->size();
+              });
+    std::vector<Segment*> sources;
+    quint32 minDoc = 0xFFFFFFFFu, maxDoc = 0, docs = 0;
+    for (int i = 0; i < MERGE_FACTOR; ++i) {
+        Segment* s = m_segments[size_t(i)].get();
+        sources.push_back(s);
+        minDoc = qMin(minDoc, s->minDoc());
+        maxDoc = qMax(maxDoc, s->maxDoc());
+        docs += s->docCount();
+    }
+
+    const QString name = nextSegmentName();
+    SegmentWriter writer;
+    if (!writer.begin(m_dir + "/" + name)) return;
+
+    // k-way merge over the sorted term tables
+    std::vector<int> cursor(sources.size(), 0);
+    for (;;) {
+        int best = -1;
+        QByteArray bestTerm;
+        for (size_t s = 0; s < sources.size(); ++s) {
+            if (cursor[s] >= sources[s]->termCount()) continue;
+            const QByteArray t = sources[s]->term(cursor[s]);
+            if (best < 0 || t < bestTerm) {
+                best = int(s);
+                bestTerm = t;
+            }
+        }
+        if (best < 0) break;
+
+        QVector<Posting> merged;
+        for (size_t s = 0; s < sources.size(); ++s) {
+            if (cursor[s] >= sources[s]->termCount()) continue;
+            if (sources[s]->term(cursor[s]) != bestTerm) continue;
+            for (const Posting& p : sources[s]->postings(cursor[s])) {
+                if (!m_deleted.contains(p.doc)) merged.append(p);
+            }
+            ++cursor[s];
+        }
+        if (merged.isEmpty()) continue;
+        std::sort(merged.begin(), merged.end(),
+                  [](const Posting& a, const Posting& b) { return a.doc < b.doc; });
+        writer.add(bestTerm, merged);
+    }
+    if (!writer.finish(docs, minDoc, maxDoc)) return;
+
+    QStringList oldPaths;
+    for (Segment* s : sources) oldPaths.append(s->path());
+    m_segments.erase(m_segments.begin(), m_segments.begin() + MERGE_FACTOR);
+    openSegment(name);
+    writeManifest();
+    for (const QString& p : qAsConst(oldPaths)) QFile::remove(p);
+
+    // Tombstones for documents no segment covers anymore can go
+    for (quint32 id : m_deleted.values()) {
+        if (!coveredBySegment(id) && (m_bufferDocs == 0 || id < m_bufferMinDoc)) m_deleted.remove(id);
+    }
+}
+
+void PageTextIndexWorker::enforceBudget()
+{
+    qint64 total = 0;
+    for (const auto& seg : m_segments) total += seg->size();
+    bool dropped = false;
+    while (total > m_budget && !m_segments.empty()) {
+        // Drop the segment holding the oldest documents
+        auto oldest = std::min_element(m_segments.begin(), m_segments.end(),
+            [](const std::unique_ptr<Segment>& a, const std::unique_ptr<Segment>& b) {
+                return a->maxDoc() < b->maxDoc();
+            });
+        total -= (*oldest)->size();
+        const QString path = (*oldest)->path();
+        m_segments.erase(oldest);
+        QFile::remove(path);
+        dropped = true;
+    }
+    if (dropped) {
+        writeManifest();
+        forgetDocsOutsideSegments();
+    }
+}
+
+void PageTextIndexWorker::forgetDocsOutsideSegments()
+{
+    for (auto it = m_docs.begin(); it != m_docs.end();) {
+        const bool buffered = m_bufferDocs > 0 && it.key() >= m_bufferMinDoc;
+        if (!buffered && !coveredBySegment(it.key())) {
+            m_totalLength -= qMin<quint64>(m_totalLength, it.value().length);
+            if (m_docByUrl.value(it.value().url) == it.key()) m_docByUrl.remove(it.value().url);
+            it = m_docs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool PageTextIndexWorker::coveredBySegment(quint32 id) const
+{
+    for (const auto& seg : m_segments) {
+        if (id >= seg->minDoc() && id <= seg->maxDoc()) return true;
+    }
+    return false;
+}
+
+PageTextIndex::PageTextIndex(QObject* parent)
+    : QObject(parent)
+    , m_worker(new QObject)
+    , m_index(new PageTextIndexWorker(
+          QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/fulltext"))
+    , m_enabled(Settings::instance()->value("fullTextIndexEnabled", true).toBool())
+{
+    m_thread.setObjectName("PageTextIndex");
+    m_worker->moveToThread(&m_thread);
+    m_thread.start(QThread::LowestPriority);
+
+    PageTextIndexWorker* index = m_index;
+    const qint64 budget = Settings::instance()->value("fullTextBudgetMB", 256).toLongLong() * 1024 * 1024;
+    QMetaObject::invokeMethod(m_worker, [index, budget]() {
+        index->open();
+        index->setBudget(budget);
+    });
+
+    // Make buffered pages durable even during quiet browsing
+    m_flushTimer.setInterval(60 * 1000);
+    connect(&m_flushTimer, &QTimer::timeout, this, [index, this]() {
+        QMetaObject::invokeMethod(m_worker, [index]() { index->flush(); });
+    });
+    m_flushTimer.start();
+}
+
+PageTextIndex::~PageTextIndex()
+{
+    PageTextIndexWorker* index = m_index;
+    QMetaObject::invokeMethod(m_worker, [index]() { index->flush(); },
+                              Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+    delete m_index;
+    delete m_worker;
+}
+
+void PageTextIndex::addPage(const QString& url, const QString& title, const QString& text)
+{
+    if (!m_enabled || text.isEmpty()) return;
+    PageTextIndexWorker* index = m_index;
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QMetaObject::invokeMethod(m_worker, [index, url, title, text, now]() {
+        index->addPage(url, title, text, now);
+    });
+}
+
+void PageTextIndex::removeUrl(const QString& url)
+{
+    PageTextIndexWorker* index = m_index;
+    QMetaObject::invokeMethod(m_worker, [index, url]() { index->removeUrl(url); });
+}
+
+void PageTextIndex::removeUrls(const QStringList& urls)
+{
+    PageTextIndexWorker* index = m_index;
+    QMetaObject::invokeMethod(m_worker, [index, urls]() {
+        for (const QString& url : urls) index->removeUrl(url);
+    });
+}
+
+void PageTextIndex::clear()
+{
+    PageTextIndexWorker* index = m_index;
+    QMetaObject::invokeMethod(m_worker, [index]() { index->clear(); });
+}
+
+int PageTextIndex::search(const QString& query, int limit)
+{
+    const int id = m_nextRequest++;
+    PageTextIndexWorker* index = m_index;
+    QMetaObject::invokeMethod(m_worker, [this, index, query, limit, id]() {
+        const QVector<PageTextResult> results = index->search(query, limit);
+        QMetaObject::invokeMethod(this, [this, id, results]() {
+            emit searchFinished(id, results);
+        });
+    });
+    return id;
+}
+
+void PageTextIndex::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    Settings::instance()->setValue("fullTextIndexEnabled", enabled);
+    if (!enabled) clear();
+}
+
+void PageTextIndex::setDiskBudget(qint64 bytes)
+{
+    Settings::instance()->setValue("fullTextBudgetMB", bytes / (1024 * 1024));
+    PageTextIndexWorker* index = m_index;
+    QMetaObject::invokeMethod(m_worker, [index, bytes]() { index->setBudget(bytes); });
+}
@@ -0,0 +1,66 @@
+/**
+ * PageTextIndex - Full-text search over the text of visited pages
+ *
+ * Page text (from QWebEnginePage::toPlainText) is handed to a background
+ * thread that maintains an on-disk inverted index:
+ * - New documents accumulate in an in-memory buffer, flushed as immutable
+ *   segment files (sorted term table + varint delta-coded postings, mmapped)
+ * - Segments are merged in the background as they accumulate, dropping
+ *   deleted documents
+ * - A disk budget evicts the oldest segments; Clear History removes it all
+ * Queries are ranked with BM25 and answered asynchronously.
+ */
+
+#ifndef PAGETEXTINDEX_HPP
+#define PAGETEXTINDEX_HPP
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+
+class PageTextIndexWorker;
+
+struct PageTextResult
+{
+    QString url;
+    QString title;
+    qint64 timestamp = 0;
+    double score = 0;
+};
+
+class PageTextIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PageTextIndex(QObject* parent = nullptr);
+    ~PageTextIndex();
+
+    void addPage(const QString& url, const QString& title, const QString& text);
+    void removeUrl(const QString& url);
+    void removeUrls(const QStringList& urls);
+    void clear();
+
+    // Runs on the index thread; emits searchFinished with the returned id
+    int search(const QString& query, int limit = 50);
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+    void setDiskBudget(qint64 bytes);
+
+signals:
+    void searchFinished(int requestId, const QVector<PageTextResult>& results);
+
+private:
+    QThread m_thread;
+    QObject* m_worker;
+    PageTextIndexWorker* m_index;
+    QTimer m_flushTimer;
+    int m_nextRequest = 1;
+    bool m_enabled;
+};
+
+#endif // PAGETEXTINDEX_HPP
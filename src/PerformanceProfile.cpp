@@ -0,0 +1,165 @@
+/**
+ * PerformanceProfile implementation
+ */
+
+#include "PerformanceProfile.hpp"
+#include "Settings.hpp"
+#include "StartupTrace.hpp"
+#include "ProcessStats.hpp"
+#include <QApplication>
+#include <QSet>
+#include <QSettings>
+#include <QThread>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QWebEnginePage>
+#include <QWebEngineProfile>
+#include <QWebEngineView>
+
+namespace {
+
+const char* const KEYS[PerformanceProfile::KindCount] = { "lowMemory", "balanced", "maxThroughput" };
+const char* const SETTING = "performanceProfile";
+const char* const STATS_SETTING = "performanceStats";
+// Older runs weigh less, so the figures follow changes in browsing habits
+const int MAX_AVERAGED_RUNS = 20;
+
+PerformanceProfile::Kind g_active = PerformanceProfile::Balanced;
+
+PerformanceProfile::Kind kindOf(const QString& key)
+{
+    for (int i = 0; i < PerformanceProfile::KindCount; ++i) {
+        if (key == QLatin1String(KEYS[i])) return PerformanceProfile::Kind(i);
+    }
+    return PerformanceProfile::Balanced;
+}
+
+} // namespace
+
+void PerformanceProfile::applyEngineFlags()
+{
+    // No QApplication yet, so no Settings either; this one key is read directly
+    const QSettings settings(Settings::ORGANIZATION, Settings::APPLICATION);
+    g_active = kindOf(settings.value(SETTING).toString());
+
+    const QByteArray flags = engineFlags(g_active);
+    if (flags.isEmpty()) return;
+    // Chromium takes the last of repeated switches, so the user's come last
+    const QByteArray existing = qgetenv("QTWEBENGINE_CHROMIUM_FLAGS");
+    qputenv("QTWEBENGINE_CHROMIUM_FLAGS", existing.isEmpty() ? flags : flags + ' ' + existing);
+}
+
+void PerformanceProfile::applyTo(QWebEngineProfile* profile)
+{
+    profile->setHttpCacheType(QWebEngineProfile::DiskHttpCache);
+    switch (g_active) {
+    case LowMemory:
+        profile->setHttpCacheMaximumSize(64 * 1024 * 1024);
+        break;
+    case Balanced:
+        profile->setHttpCacheMaximumSize(0);    // Chromium sizes it from free disk space
+        break;
+    case MaxThroughput:
+        profile->setHttpCacheMaximumSize(1024 * 1024 * 1024);
+        break;
+    case KindCount:
+        break;
+    }
+}
+
+PerformanceProfile::Kind PerformanceProfile::active()
+{
+    return g_active;
+}
+
+PerformanceProfile::Kind PerformanceProfile::selected()
+{
+    return kindOf(Settings::instance()->value(SETTING, KEYS[Balanced]).toString());
+}
+
+void PerformanceProfile::select(Kind kind)
+{
+    Settings::instance()->setValue(SETTING, KEYS[kind]);
+}
+
+QString PerformanceProfile::name(Kind kind)
+{
+    switch (kind) {
+    case LowMemory: return QApplication::translate("PerformanceProfile", "Low memory");
+    case Balanced: return QApplication::translate("PerformanceProfile", "Balanced");
+    case MaxThroughput: return QApplication::translate("PerformanceProfile", "Maximum throughput");
+    case KindCount: break;
+    }
+    return QString();
+}
+
+QByteArray PerformanceProfile::engineFlags(Kind kind)
+{
+    switch (kind) {
+    case LowMemory:
+        // Sites share renderers instead of getting one per site instance
+        return "--renderer-process-limit=2 --process-per-site --disable-site-isolation-trials"
+               " --js-flags=--max-old-space-size=256 --num-raster-threads=1";
+    case Balanced:
+        return QByteArray();
+    case MaxThroughput:
+        // Chromium uses at most 4 raster threads however many are asked for
+        return "--site-per-process --js-flags=--max-old-space-size=4096 --num-raster-threads="
+               + QByteArray::number(qBound(2, QThread::idealThreadCount() / 2, 4));
+    case KindCount:
+        break;
+    }
+    return QByteArray();
+}
+
+PerformanceProfile::TabPolicy PerformanceProfile::tabPolicy(Kind kind)
+{
+    switch (kind) {
+    case LowMemory: return {1, 20, 0, true};
+    case MaxThroughput: return {30, 5, 2, false};
+    default: return {5, 10, 1, false};
+    }
+}
+
+void PerformanceProfile::recordRun()
+{
+    StartupTrace* trace = StartupTrace::instance();
+    qint64 startupMs = trace->elapsed(StartupTrace::FirstContentfulPaint);
+    if (startupMs < 0) startupMs = trace->elapsed(StartupTrace::WindowShown);
+
+    // Renderers shared by several views are counted once
+    qint64 memoryBytes = qMax<qint64>(0, ProcessStats::memoryOf(QApplication::applicationPid()));
+    QSet<qint64> pids;
+    for (QWidget* widget : QApplication::allWidgets()) {
+        QWebEngineView* view = qobject_cast<QWebEngineView*>(widget);
+        const qint64 pid = view ? view->page()->renderProcessPid() : 0;
+        if (pid <= 0 || pids.contains(pid)) continue;
+        pids.insert(pid);
+        memoryBytes += qMax<qint64>(0, ProcessStats::memoryOf(pid));
+    }
+
+    Measurement m = measurement(g_active);
+    const int weight = qMin(m.runs, MAX_AVERAGED_RUNS - 1);
+    auto average = [weight](qint64 mean, qint64 sample) {
+        if (sample < 0) return mean;
+        return mean < 0 ? sample : (mean * weight + sample) / (weight + 1);
+    };
+    m.startupMs = average(m.startupMs, startupMs);
+    m.memoryBytes = average(m.memoryBytes, memoryBytes);
+    ++m.runs;
+
+    QVariantMap stats = Settings::instance()->value(STATS_SETTING).toMap();
+    stats.insert(KEYS[g_active], QVariantList{m.runs, m.startupMs, m.memoryBytes});
+    Settings::instance()->setValue(STATS_SETTING, stats);
+}
+
+PerformanceProfile::Measurement PerformanceProfile::measurement(Kind kind)
+{
+    const QVariantList values = Settings::instance()->value(STATS_SETTING).toMap().value(KEYS[kind]).toList();
+    Measurement m;
+    if (values.size() != 3) return m;
+    m.runs = values.at(0).toInt();
+    m.startupMs = values.at(1).toLongLong();
+    m.memoryBytes = values.at(2).toLongLong();
+    return m;
+}
@@ -0,0 +1,70 @@
+/**
+ * PerformanceProfile - Engine tuning presets for small and large machines
+ *
+ * Three profiles, each a coherent set of Chromium switches passed through
+ * QTWEBENGINE_CHROMIUM_FLAGS, an HTTP cache setup and background-tab
+ * defaults:
+ *
+ *   LowMemory      2 renderers, one process per site, 256 MB V8 heaps,
+ *                  1 raster thread, 64 MB disk cache, eager tab unloading
+ *   Balanced       Chromium's own defaults, automatic cache size
+ *   MaxThroughput  a process per site instance, 4 GB V8 heaps, up to
+ *                  4 raster threads, 1 GB disk cache, tabs kept alive
+ *
+ * The switches are read by Chromium once, so applyEngineFlags() must run
+ * before QApplication and a change of profile takes effect at the next
+ * start. Flags already in the environment are kept and win over the
+ * profile's. Each run records its startup time and memory use against the
+ * active profile, so the settings dialog can show what a profile did.
+ */
+
+#ifndef PERFORMANCEPROFILE_HPP
+#define PERFORMANCEPROFILE_HPP
+
+#include <QByteArray>
+#include <QString>
+
+class QWebEngineProfile;
+
+class PerformanceProfile
+{
+public:
+    enum Kind { LowMemory, Balanced, MaxThroughput, KindCount };
+
+    // Background-tab settings a profile presets; still adjustable one by one
+    struct TabPolicy
+    {
+        int freezeMinutes;
+        int discardBelowPercent;
+        int spareViews;
+        bool loadOnSelect;      // links opened in the background wait until shown
+    };
+
+    // Averages over the runs recorded for a profile
+    struct Measurement
+    {
+        int runs = 0;
+        qint64 startupMs = -1;  // process start to first contentful paint
+        qint64 memoryBytes = -1;  // browser and renderers, a while after startup
+    };
+
+    // Before QApplication: reads the chosen profile from the settings file
+    static void applyEngineFlags();
+    static void applyTo(QWebEngineProfile* profile);
+
+    // The profile this process was started with
+    static Kind active();
+    static Kind selected();
+    // Engine switches and cache apply from the next start
+    static void select(Kind kind);
+
+    static QString name(Kind kind);
+    static QByteArray engineFlags(Kind kind);
+    static TabPolicy tabPolicy(Kind kind);
+
+    // Called once per run, after startup has settled
+    static void recordRun();
+    static Measurement measurement(Kind kind);
+};
+
+#endif // PERFORMANCEPROFILE_HPP
@@ -0,0 +1,309 @@
+/**
+ * Predictor implementation
+ */
+
+#include "Predictor.hpp"
+#include "WebView.hpp"
+#include "Settings.hpp"
+#include "ProcessStats.hpp"
+#include "TabLifecycleManager.hpp"
+#include "WebViewPool.hpp"
+#include <QApplication>
+#include <QDateTime>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QNetworkConfigurationManager>
+#include <QSet>
+#include <QWebEnginePage>
+#include <QWebEngineProfile>
+#include <QWebEngineScript>
+#include <QWebEngineView>
+
+namespace {
+
+const double PRECONNECT_CONFIDENCE = 0.3;
+const double PRERENDER_CONFIDENCE = 0.6;
+const int MIN_PRERENDER_CHARS = 3;
+const int TYPED_SETTLE_MS = 300;
+// Chromium keeps idle sockets open for about this long
+const qint64 PRECONNECT_REUSE_MS = 10 * 1000;
+const int BUDGET_CHECK_MS = 2000;
+
+// The hint is removed again once the connection has had time to open
+const char* const PRECONNECT_SCRIPT =
+    "(function(origin) {"
+    "  var link = document.createElement('link');"
+    "  link.rel = 'preconnect';"
+    "  link.href = origin;"
+    "  (document.head || document.documentElement).appendChild(link);"
+    "  setTimeout(function() { link.remove(); }, 10000);"
+    "})(%1[0]);";
+
+QUrl normalized(const QUrl& url)
+{
+    return url.adjusted(QUrl::RemoveFragment | QUrl::StripTrailingSlash);
+}
+
+bool isWebUrl(const QUrl& url)
+{
+    return url.scheme() == QLatin1String("http") || url.scheme() == QLatin1String("https");
+}
+
+// What the user typed leads this URL, as inline completion would assume
+bool typedPrefixOf(const QString& text, const QUrl& url)
+{
+    const QString typed = text.trimmed().toLower();
+    QString host = url.host();
+    if (host.startsWith(QLatin1String("www."))) host.remove(0, 4);
+    const QString rest = host + url.path();
+    return rest.startsWith(typed) || url.toString().startsWith(typed);
+}
+
+} // namespace
+
+Predictor* Predictor::instance()
+{
+    static Predictor* predictor = nullptr;
+    if (!predictor) predictor = new Predictor(qApp);
+    return predictor;
+}
+
+Predictor::Predictor(QObject* parent)
+    : QObject(parent)
+    , m_preconnect(Settings::instance()->value("preconnect", true).toBool())
+    , m_prerender(Settings::instance()->value("prerender", false).toBool())
+    , m_maxPrerenders(qBound(1, Settings::instance()->value("maxPrerenders", 1).toInt(), MAX_PRERENDERS))
+    , m_memoryCapMB(qMax(64, Settings::instance()->value("prerenderMemoryMB", 256).toInt()))
+    , m_network(new QNetworkConfigurationManager(this))
+{
+    m_typedTimer.setSingleShot(true);
+    m_typedTimer.setInterval(TYPED_SETTLE_MS);
+    connect(&m_typedTimer, &QTimer::timeout, this, [this]() { prerender(m_typedCandidate); });
+
+    m_budgetTimer.setInterval(BUDGET_CHECK_MS);
+    connect(&m_budgetTimer, &QTimer::timeout, this, &Predictor::enforceBudgets);
+    connect(TabLifecycleManager::instance(), &TabLifecycleManager::pressureChanged, this, &Predictor::enforceBudgets);
+    // Prerender views have no parent; they and the hint page must go
+    // before the WebEngine profile does
+    connect(qApp, &QCoreApplication::aboutToQuit, this, [this]() {
+        m_budgetTimer.stop();
+        for (const Entry& entry : qAsConst(m_entries)) delete entry.view;
+        m_entries.clear();
+        delete m_hintPage;
+    });
+}
+
+void Predictor::predictTyped(const QString& text, const QVector<OmniboxIndex::Match>& matches)
+{
+    m_typedTimer.stop();
+    if (matches.isEmpty()) return;
+    const OmniboxIndex::Match& top = matches.first();
+    const QUrl url(top.url);
+    if (!isWebUrl(url) || !typedPrefixOf(text, url)) return;
+
+    double total = 0;
+    for (const OmniboxIndex::Match& m : matches) total += m.score;
+    const double confidence = total > 0 ? top.score / total : 0;
+
+    if (confidence >= PRECONNECT_CONFIDENCE) preconnect(url);
+    if (confidence >= PRERENDER_CONFIDENCE && text.trimmed().size() >= MIN_PRERENDER_CHARS) {
+        m_typedCandidate = url;
+        m_typedTimer.start();
+    }
+}
+
+void Predictor::predictHover(QWebEngineView* from, const QUrl& url)
+{
+    if (!isWebUrl(url)) return;
+    // A link to the page itself (e.g. an anchor) needs nothing
+    if (from && normalized(from->url()) == normalized(url)) return;
+    preconnect(url);
+}
+
+Predictor::Prerender Predictor::take(const QUrl& url)
+{
+    const int index = indexOf(url);
+    if (index < 0) return {};
+    const Entry entry = m_entries.takeAt(index);
+    if (m_entries.isEmpty()) m_budgetTimer.stop();
+    entry.view->page()->setAudioMuted(false);
+    ++m_stats.hits;
+    emit statsChanged();
+    return {entry.view, entry.loaded};
+}
+
+void Predictor::noteNavigation(const QUrl& url)
+{
+    const int index = indexOf(url);
+    if (index < 0) return;
+    ++m_stats.warmHits;
+    m_entries.at(index).view->deleteLater();
+    m_entries.removeAt(index);
+    if (m_entries.isEmpty()) m_budgetTimer.stop();
+    emit statsChanged();
+}
+
+void Predictor::setPreconnectEnabled(bool enabled)
+{
+    m_preconnect = enabled;
+    Settings::instance()->setValue("preconnect", enabled);
+}
+
+void Predictor::setPrerenderEnabled(bool enabled)
+{
+    m_prerender = enabled;
+    Settings::instance()->setValue("prerender", enabled);
+    enforceBudgets();
+}
+
+void Predictor::setMaxPrerenders(int count)
+{
+    m_maxPrerenders = qBound(1, count, MAX_PRERENDERS);
+    Settings::instance()->setValue("maxPrerenders", m_maxPrerenders);
+    enforceBudgets();
+}
+
+void Predictor::setMemoryCapMB(int mb)
+{
+    m_memoryCapMB = qMax(64, mb);
+    Settings::instance()->setValue("prerenderMemoryMB", m_memoryCapMB);
+    enforceBudgets();
+}
+
+void Predictor::preconnect(const QUrl& url)
+{
+    if (!m_preconnect) return;
+    const QString origin = url.adjusted(QUrl::RemovePath | QUrl::RemoveQuery | QUrl::RemoveFragment
+                                        | QUrl::RemoveUserInfo).toString(QUrl::FullyEncoded);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now - m_preconnected.value(origin, 0) < PRECONNECT_REUSE_MS) return;
+    m_preconnected.insert(origin, now);
+    if (m_preconnected.size() > 64) {
+        for (auto it = m_preconnected.begin(); it != m_preconnected.end();) {
+            if (now - it.value() >= PRECONNECT_REUSE_MS) it = m_preconnected.erase(it);
+            else ++it;
+        }
+    }
+
+    if (!m_hintPage) {
+        m_hintPage = new QWebEnginePage(QWebEngineProfile::defaultProfile(), this);
+        m_hintPageReady = false;
+        connect(m_hintPage, &QWebEnginePage::loadFinished, this, [this]() {
+            m_hintPageReady = true;
+            for (const QString& pending : qAsConst(m_pendingHints)) sendHint(pending);
+            m_pendingHints.clear();
+        });
+        // A crashed renderer takes the page's usefulness with it
+        connect(m_hintPage, &QWebEnginePage::renderProcessTerminated, m_hintPage, &QObject::deleteLater);
+        m_hintPage->setUrl(QUrl(QStringLiteral("about:blank")));
+    }
+    if (m_hintPageReady) {
+        sendHint(origin);
+    } else if (!m_pendingHints.contains(origin)) {
+        m_pendingHints.append(origin);
+    }
+    ++m_stats.preconnects;
+    emit statsChanged();
+}
+
+void Predictor::sendHint(const QString& origin)
+{
+    if (!m_hintPage) return;
+    const QString arg = QString::fromUtf8(QJsonDocument(QJsonArray{origin}).toJson(QJsonDocument::Compact));
+    m_hintPage->runJavaScript(QString::fromLatin1(PRECONNECT_SCRIPT).arg(arg), QWebEngineScript::ApplicationWorld);
+}
+
+void Predictor::prerender(const QUrl& url)
+{
+    if (!m_prerender || indexOf(url) >= 0 || !canPrerender()) return;
+
+    while (m_entries.size() >= m_maxPrerenders) discard(0);
+
+    WebView* view = WebViewPool::instance()->take(nullptr);
+    view->page()->setAudioMuted(true);
+    view->setUrl(url);
+    m_entries.append({url, view, QDateTime::currentMSecsSinceEpoch()});
+    connect(view->page(), &QWebEnginePage::loadFinished, this, [this, view](bool ok) {
+        for (Entry& entry : m_entries) {
+            if (entry.view == view) entry.loaded = ok;
+        }
+        enforceBudgets();
+    });
+    m_budgetTimer.start();
+    ++m_stats.prerenders;
+    emit statsChanged();
+}
+
+bool Predictor::canPrerender() const
+{
+    const TabLifecycleManager* lifecycle = TabLifecycleManager::instance();
+    if (lifecycle->pressure() != TabLifecycleManager::Pressure::None) return false;
+    // Same headroom WebViewPool asks for before keeping more than one spare
+    const int floor = qMax(lifecycle->discardBelowPercent(), 10);
+    if (lifecycle->availableMemoryPercent() < 2.0 * floor) return false;
+    return !isMetered();
+}
+
+bool Predictor::isMetered() const
+{
+    // Bearer management is all Qt 5 offers; treat cellular links as metered
+QT_WARNING_PUSH
+QT_WARNING_DISABLE_DEPRECATED
+    switch (m_network->defaultConfiguration().bearerTypeFamily()) {
+    case QNetworkConfiguration::Bearer2G:
+    case QNetworkConfiguration::Bearer3G:
+    case QNetworkConfiguration::Bearer4G:
+        return true;
+    default:
+        return false;
+    }
+QT_WARNING_POP
+}
+
+void Predictor::discard(int index)
+{
+    m_entries.at(index).view->deleteLater();
+    m_entries.removeAt(index);
+    if (m_entries.isEmpty()) m_budgetTimer.stop();
+    ++m_stats.misses;
+    emit statsChanged();
+}
+
+void Predictor::enforceBudgets()
+{
+    if (!m_prerender || !canPrerender()) {
+        while (!m_entries.isEmpty()) discard(0);
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for (int i = m_entries.size() - 1; i >= 0; --i) {
+        if (now - m_entries.at(i).startedAt > PRERENDER_TTL_MS) discard(i);
+    }
+    while (m_entries.size() > m_maxPrerenders) discard(0);
+
+    // Oldest prerenders go first until their renderers fit the cap
+    for (;;) {
+        qint64 total = 0;
+        QSet<qint64> counted;
+        for (const Entry& entry : qAsConst(m_entries)) {
+            const qint64 pid = entry.view->page()->renderProcessPid();
+            if (pid <= 0 || counted.contains(pid)) continue;
+            counted.insert(pid);
+            total += qMax<qint64>(0, ProcessStats::memoryOf(pid));
+        }
+        if (m_entries.isEmpty() || total <= qint64(m_memoryCapMB) * 1024 * 1024) break;
+        discard(0);
+    }
+}
+
+int Predictor::indexOf(const QUrl& url) const
+{
+    const QUrl wanted = normalized(url);
+    for (int i = 0; i < m_entries.size(); ++i) {
+        const Entry& entry = m_entries.at(i);
+        // Redirects move the view off the URL it was asked for
+        if (normalized(entry.url) == wanted || normalized(entry.view->url()) == wanted) return i;
+    }
+    return -1;
+}
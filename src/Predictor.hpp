@@ -0,0 +1,124 @@
+/**
+ * Predictor - Speculative preconnect and prerender
+ *
+ * Fed by address-bar typing (the top omnibox match and its share of the
+ * total score) and by link hover. At moderate confidence, or on hover, it
+ * preconnects to the target's origin: a <link rel=preconnect> is added to
+ * a hidden blank page of the browser's own in the default profile, so
+ * Chromium opens the socket (DNS, TCP, TLS) where the real navigation will
+ * use it. Nothing goes into the page the user is on, where the site could
+ * read what is being typed, or its CSP could drop the hint. At high typed
+ * confidence it can also load the page in a hidden WebView that MainWindow
+ * swaps into an empty tab when the user commits. Hovering never loads a
+ * page: that would fire GET links (logout, unsubscribe) without a click.
+ *
+ * Prerendering is off by default. It stops at maxPrerenders views and
+ * memoryCapMB of renderer memory, and is off under memory pressure or on a
+ * cellular connection. Unused prerenders expire after PRERENDER_TTL_MS.
+ */
+
+#ifndef PREDICTOR_HPP
+#define PREDICTOR_HPP
+
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <QStringList>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+#include "OmniboxIndex.hpp"
+
+class QNetworkConfigurationManager;
+class QWebEnginePage;
+class QWebEngineView;
+class WebView;
+
+class Predictor : public QObject
+{
+    Q_OBJECT
+
+public:
+    static Predictor* instance();
+
+    struct Stats
+    {
+        int preconnects = 0;
+        int prerenders = 0;
+        int hits = 0;       // prerendered view swapped into a tab
+        int warmHits = 0;   // navigated to normally, after the prerender warmed the cache
+        int misses = 0;     // prerender thrown away unused
+    };
+
+    struct Prerender
+    {
+        WebView* view = nullptr;
+        bool loaded = false;    // loadFinished has already fired
+    };
+
+    void predictTyped(const QString& text, const QVector<OmniboxIndex::Match>& matches);
+    // from is the view the link is in; an empty URL means the pointer left it
+    void predictHover(QWebEngineView* from, const QUrl& url);
+
+    // Hands over the prerender for url, if there is one; the caller owns the
+    // view, which is still unparented, hidden and muted
+    Prerender take(const QUrl& url);
+    // Any tab navigated to url; a matching prerender has done its job
+    void noteNavigation(const QUrl& url);
+
+    Stats stats() const { return m_stats; }
+
+    bool preconnectEnabled() const { return m_preconnect; }
+    void setPreconnectEnabled(bool enabled);
+    bool prerenderEnabled() const { return m_prerender; }
+    void setPrerenderEnabled(bool enabled);
+    int maxPrerenders() const { return m_maxPrerenders; }
+    void setMaxPrerenders(int count);
+    int memoryCapMB() const { return m_memoryCapMB; }
+    void setMemoryCapMB(int mb);
+
+signals:
+    void statsChanged();
+
+private:
+    explicit Predictor(QObject* parent = nullptr);
+
+    struct Entry
+    {
+        QUrl url;
+        WebView* view;
+        qint64 startedAt;
+        bool loaded = false;
+    };
+
+    void preconnect(const QUrl& url);
+    void sendHint(const QString& origin);
+    void prerender(const QUrl& url);
+    bool canPrerender() const;
+    bool isMetered() const;
+    void discard(int index);
+    void enforceBudgets();
+    int indexOf(const QUrl& url) const;
+
+    QVector<Entry> m_entries;
+    QHash<QString, qint64> m_preconnected;  // origin -> ms since epoch
+    Stats m_stats;
+    bool m_preconnect;
+    bool m_prerender;
+    int m_maxPrerenders;
+    int m_memoryCapMB;
+    QNetworkConfigurationManager* m_network;
+    // Blank page the preconnect hints are added to; origins wait in
+    // m_pendingHints until it has loaded
+    QPointer<QWebEnginePage> m_hintPage;
+    bool m_hintPageReady = false;
+    QStringList m_pendingHints;
+    // Typing settles before anything is loaded
+    QTimer m_typedTimer;
+    QUrl m_typedCandidate;
+    QTimer m_budgetTimer;
+    static constexpr int MAX_PRERENDERS = 3;
+    static constexpr int PRERENDER_TTL_MS = 30 * 1000;
+};
+
+#endif // PREDICTOR_HPP
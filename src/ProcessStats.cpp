@@ -0,0 +1,103 @@
+/**
+ * ProcessStats implementation
+ */
+
+#include "ProcessStats.hpp"
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <unistd.h>
+
+namespace {
+
+// procfs files report size 0; readAll() reads them to EOF regardless
+QByteArray readProcFile(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+    return file.readAll();
+}
+
+// Value of a "Key:   1234 kB" line, or -1
+qint64 procField(const QByteArray& text, const QByteArray& key)
+{
+    int start = -1;
+    if (text.startsWith(key + ':')) {
+        start = key.size() + 1;
+    } else {
+        const int at = text.indexOf('\n' + key + ':');
+        if (at >= 0) start = at + key.size() + 2;
+    }
+    if (start < 0) return -1;
+    const int end = text.indexOf('\n', start);
+    QByteArray value = text.mid(start, end < 0 ? -1 : end - start);
+    bool ok = false;
+    const qint64 n = value.replace("kB", "").trimmed().toLongLong(&ok);
+    return ok ? n : -1;
+}
+
+qint64 kbToBytes(qint64 kb)
+{
+    return kb < 0 ? -1 : kb * 1024;
+}
+
+} // namespace
+
+ProcessStats::Sample ProcessStats::sample(qint64 pid)
+{
+    Sample result;
+
+    // The command name is in parentheses and may contain spaces, so fields
+    // are counted from the last ')': state is first, utime/stime 12th/13th
+    const QByteArray stat = readProcFile(QString("/proc/%1/stat").arg(pid));
+    const int close = stat.lastIndexOf(')');
+    if (close >= 0) {
+        const QList<QByteArray> fields = stat.mid(close + 2).split(' ');
+        if (fields.size() > 12) {
+            result.cpuTicks = fields.at(11).toLongLong() + fields.at(12).toLongLong();
+        }
+    }
+
+    const QByteArray rollup = readProcFile(QString("/proc/%1/smaps_rollup").arg(pid));
+    result.pssBytes = kbToBytes(procField(rollup, "Pss"));
+    result.rssBytes = kbToBytes(procField(rollup, "Rss"));
+    if (result.rssBytes < 0) {
+        result.rssBytes = kbToBytes(procField(readProcFile(QString("/proc/%1/status").arg(pid)), "VmRSS"));
+    }
+    return result;
+}
+
+qint64 ProcessStats::memoryOf(qint64 pid)
+{
+    const qint64 pss = procField(readProcFile(QString("/proc/%1/smaps_rollup").arg(pid)), "Pss");
+    if (pss >= 0) return kbToBytes(pss);
+    return kbToBytes(procField(readProcFile(QString("/proc/%1/status").arg(pid)), "VmRSS"));
+}
+
+long ProcessStats::clockTicksPerSecond()
+{
+    static const long ticks = sysconf(_SC_CLK_TCK);
+    return ticks > 0 ? ticks : 100;
+}
+
+ProcessStats::SystemMemory ProcessStats::systemMemory()
+{
+    const QByteArray text = readProcFile("/proc/meminfo");
+    SystemMemory result;
+    result.totalBytes = kbToBytes(procField(text, "MemTotal"));
+    result.availableBytes = kbToBytes(procField(text, "MemAvailable"));
+    return result;
+}
+
+double ProcessStats::memoryPressure()
+{
+    const QByteArray text = readProcFile("/proc/pressure/memory");
+    const int at = text.indexOf("some avg10=");
+    if (at < 0) return -1;
+    const int start = at + 11;
+    const int end = text.indexOf(' ', start);
+    bool ok = false;
+    const double value = text.mid(start, end < 0 ? -1 : end - start).toDouble(&ok);
+    return ok ? value : -1;
+}
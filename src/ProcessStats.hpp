@@ -0,0 +1,40 @@
+/**
+ * ProcessStats - Readers for Linux /proc process and memory figures
+ *
+ * Plain, uncached file reads; callers choose which thread pays for them.
+ * Figures that can't be read (another platform, or a process that has
+ * exited) come back as -1.
+ */
+
+#ifndef PROCESSSTATS_HPP
+#define PROCESSSTATS_HPP
+
+#include <QtGlobal>
+
+class ProcessStats
+{
+public:
+    struct Sample
+    {
+        qint64 cpuTicks = -1;   // utime + stime, in clockTicksPerSecond() units
+        qint64 pssBytes = -1;   // proportional share, counts shared pages fairly
+        qint64 rssBytes = -1;
+    };
+
+    struct SystemMemory
+    {
+        qint64 totalBytes = -1;
+        qint64 availableBytes = -1;
+    };
+
+    static Sample sample(qint64 pid);
+    // Pss, falling back to VmRSS on kernels without smaps_rollup (< 4.14)
+    static qint64 memoryOf(qint64 pid);
+    static long clockTicksPerSecond();
+
+    static SystemMemory systemMemory();
+    // "some avg10" from /proc/pressure/memory (kernel 4.20+)
+    static double memoryPressure();
+};
+
+#endif // PROCESSSTATS_HPP
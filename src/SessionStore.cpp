@@ -0,0 +1,274 @@
+/**
+ * SessionStore implementation
+ */
+
+#include "SessionStore.hpp"
+#include "Journal.hpp"
+#include <QDataStream>
+#include <QSet>
+#include <QStandardPaths>
+#include <QWebEngineHistory>
+#include <algorithm>
+
+namespace {
+
+enum RecordType : quint8 {
+    RecordWindow = 1,
+    RecordWindowRemove = 2,
+    RecordTab = 3,
+    RecordTabRemove = 4,
+    RecordClosedPush = 5,
+    RecordClosedPop = 6,
+    RecordReset = 7
+};
+
+const int MAX_CLOSED_TABS = 10;
+const int COMPACT_MIN_RECORDS = 256;
+
+QDataStream& operator<<(QDataStream& ds, const TabState& t)
+{
+    return ds << t.url << t.title << t.history << t.pinned;
+}
+
+QDataStream& operator>>(QDataStream& ds, TabState& t)
+{
+    // Records written before pinning existed end after the history, and
+    // reading past the end leaves pinned false
+    return ds >> t.url >> t.title >> t.history >> t.pinned;
+}
+
+QByteArray encodeWindow(const WindowState& w)
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << quint8(RecordWindow) << qint32(w.id) << w.geometry << w.tabs << qint32(w.current) << w.container;
+    return out;
+}
+
+QByteArray encodeTab(int tabId, const TabState& state)
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << quint8(RecordTab) << qint32(tabId) << state;
+    return out;
+}
+
+QByteArray encodeId(RecordType type, int id)
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << quint8(type) << qint32(id);
+    return out;
+}
+
+QByteArray encodeClosedPush(const TabState& state)
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << quint8(RecordClosedPush) << state;
+    return out;
+}
+
+QByteArray encodeType(RecordType type)
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds << quint8(type);
+    return out;
+}
+
+} // namespace
+
+SessionStore::SessionStore(QObject* parent)
+    : QObject(parent)
+    , m_worker(new QObject)
+    , m_journal(new Journal(QStandardPaths::writableLocation(QStandardPaths::DataLocation)
+                            + "/session.journal"))
+{
+    // Replayed here, before the writer thread gets any work, so the journal
+    // is still only ever used by one thread at a time
+    load();
+
+    m_thread.setObjectName("SessionStore");
+    m_worker->moveToThread(&m_thread);
+    m_thread.start(QThread::LowPriority);
+
+    maybeCompact();
+}
+
+SessionStore::~SessionStore()
+{
+    Journal* journal = m_journal;
+    QMetaObject::invokeMethod(m_worker, [journal]() { journal->sync(); },
+                              Qt::BlockingQueuedConnection);
+    m_thread.quit();
+    m_thread.wait();
+    delete m_journal;
+    delete m_worker;
+}
+
+void SessionStore::load()
+{
+    m_journalRecords = m_journal->replay([this](const QByteArray& payload) {
+        QDataStream ds(payload);
+        quint8 type;
+        qint32 id;
+        ds >> type;
+        switch (type) {
+        case RecordWindow: {
+            WindowState w;
+            qint32 current;
+            // Records from before containers end after current
+            ds >> id >> w.geometry >> w.tabs >> current >> w.container;
+            w.id = id;
+            w.current = current;
+            m_windows.insert(w.id, w);
+            m_nextWindowId = qMax(m_nextWindowId, w.id + 1);
+            break;
+        }
+        case RecordWindowRemove:
+            ds >> id;
+            for (int tabId : m_windows.value(id).tabs) m_tabs.remove(tabId);
+            m_windows.remove(id);
+            break;
+        case RecordTab: {
+            TabState t;
+            ds >> id >> t;
+            m_tabs.insert(id, t);
+            m_nextTabId = qMax(m_nextTabId, int(id) + 1);
+            break;
+        }
+        case RecordTabRemove:
+            ds >> id;
+            m_tabs.remove(id);
+            break;
+        case RecordClosedPush: {
+            TabState t;
+            ds >> t;
+            m_closed.prepend(t);
+            while (m_closed.size() > MAX_CLOSED_TABS) m_closed.removeLast();
+            break;
+        }
+        case RecordClosedPop:
+            if (!m_closed.isEmpty()) m_closed.removeFirst();
+            break;
+        case RecordReset:
+            m_windows.clear();
+            m_tabs.clear();
+            break;
+        }
+    });
+
+    // Tabs whose state was never written can't be restored, and tab states
+    // no window refers to (e.g. a crash between the two records) are dropped
+    QSet<int> referenced;
+    for (WindowState& w : m_windows) {
+        const int currentId = w.tabs.value(w.current, -1);
+        w.tabs.erase(std::remove_if(w.tabs.begin(), w.tabs.end(),
+                                    [this](int id) { return !m_tabs.contains(id); }),
+                     w.tabs.end());
+        w.current = qMax(0, w.tabs.indexOf(currentId));
+        for (int id : qAsConst(w.tabs)) referenced.insert(id);
+    }
+    for (auto it = m_tabs.begin(); it != m_tabs.end();) {
+        if (referenced.contains(it.key())) ++it;
+        else it = m_tabs.erase(it);
+    }
+}
+
+QVector<WindowState> SessionStore::windows() const
+{
+    QVector<WindowState> result;
+    for (const WindowState& w : m_windows) {
+        if (!w.tabs.isEmpty()) result.append(w);
+    }
+    std::sort(result.begin(), result.end(), [](const WindowState& a, const WindowState& b) {
+        return a.id < b.id;
+    });
+    return result;
+}
+
+void SessionStore::saveWindow(const WindowState& window)
+{
+    m_windows.insert(window.id, window);
+    journal(encodeWindow(window));
+}
+
+void SessionStore::removeWindow(int windowId)
+{
+    if (!m_windows.contains(windowId)) return;
+    for (int tabId : m_windows.value(windowId).tabs) m_tabs.remove(tabId);
+    m_windows.remove(windowId);
+    journal(encodeId(RecordWindowRemove, windowId));
+}
+
+void SessionStore::saveTab(int tabId, const TabState& state)
+{
+    m_tabs.insert(tabId, state);
+    journal(encodeTab(tabId, state));
+}
+
+void SessionStore::removeTab(int tabId)
+{
+    if (m_tabs.remove(tabId) == 0) return;
+    journal(encodeId(RecordTabRemove, tabId));
+}
+
+void SessionStore::reset()
+{
+    m_windows.clear();
+    m_tabs.clear();
+    journal(encodeType(RecordReset));
+}
+
+void SessionStore::pushClosedTab(const TabState& state)
+{
+    m_closed.prepend(state);
+    while (m_closed.size() > MAX_CLOSED_TABS) m_closed.removeLast();
+    journal(encodeClosedPush(state));
+}
+
+TabState SessionStore::takeClosedTab()
+{
+    if (m_closed.isEmpty()) return TabState();
+    journal(encodeType(RecordClosedPop));
+    return m_closed.takeFirst();
+}
+
+QByteArray SessionStore::saveHistory(QWebEngineHistory* history)
+{
+    QByteArray data;
+    QDataStream ds(&data, QIODevice::WriteOnly);
+    ds << *history;
+    return data;
+}
+
+void SessionStore::restoreHistory(QWebEngineHistory* history, const QByteArray& data)
+{
+    QDataStream ds(data);
+    ds >> *history;
+}
+
+void SessionStore::journal(const QByteArray& record)
+{
+    ++m_journalRecords;
+    Journal* journal = m_journal;
+    QMetaObject::invokeMethod(m_worker, [journal, record]() { journal->append(record); });
+    maybeCompact();
+}
+
+void SessionStore::maybeCompact()
+{
+    // Tab records are rewritten on every navigation; keep only the latest
+    const int live = m_windows.size() + m_tabs.size() + m_closed.size();
+    if (m_journalRecords < 4 * live + COMPACT_MIN_RECORDS) return;
+
+    QList<QByteArray> records;
+    for (const WindowState& w : qAsConst(m_windows)) records.append(encodeWindow(w));
+    for (auto it = m_tabs.cbegin(); it != m_tabs.cend(); ++it) records.append(encodeTab(it.key(), it.value()));
+    for (auto it = m_closed.crbegin(); it != m_closed.crend(); ++it) records.append(encodeClosedPush(*it));
+    m_journalRecords = records.size();
+
+    Journal* journal = m_journal;
+    QMetaObject::invokeMethod(m_worker, [journal, records]() { journal->rewrite(records); });
+}
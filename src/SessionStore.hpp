@@ -0,0 +1,92 @@
+/**
+ * SessionStore - Journaled record of open windows, tabs and closed tabs
+ *
+ * Windows report their tab order and tabs report their state (URL, title
+ * and serialized QWebEngineHistory) as they change; each report is one
+ * small journal record, so a crash loses at most the last few seconds.
+ * Replayed synchronously at startup, since the first window depends on it.
+ * The recently-closed stack lives here too and survives restarts.
+ */
+
+#ifndef SESSIONSTORE_HPP
+#define SESSIONSTORE_HPP
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QThread>
+#include <QUrl>
+#include <QVector>
+
+class Journal;
+class QWebEngineHistory;
+
+struct TabState
+{
+    QUrl url;
+    QString title;
+    QByteArray history;     // QWebEngineHistory via QDataStream; may be empty
+    bool pinned = false;
+
+    bool isNull() const { return url.isEmpty() && history.isEmpty(); }
+};
+
+struct WindowState
+{
+    int id = -1;
+    QByteArray geometry;    // QWidget::saveGeometry
+    QVector<int> tabs;      // tab ids in display order
+    int current = 0;        // index into tabs
+    QString container;      // ContainerManager id; empty for the default profile
+};
+
+class SessionStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SessionStore(QObject* parent = nullptr);
+    ~SessionStore();
+
+    // State as of the last run (or as updated since), ordered by window id
+    QVector<WindowState> windows() const;
+    TabState tab(int tabId) const { return m_tabs.value(tabId); }
+
+    int newWindowId() { return m_nextWindowId++; }
+    int newTabId() { return m_nextTabId++; }
+
+    void saveWindow(const WindowState& window);
+    // Forgets a window and all of its tabs
+    void removeWindow(int windowId);
+    void saveTab(int tabId, const TabState& state);
+    void removeTab(int tabId);
+    // Drops all windows and tabs (not restoring); closed tabs are kept
+    void reset();
+
+    void pushClosedTab(const TabState& state);
+    bool hasClosedTabs() const { return !m_closed.isEmpty(); }
+    TabState takeClosedTab();
+
+    static QByteArray saveHistory(QWebEngineHistory* history);
+    static void restoreHistory(QWebEngineHistory* history, const QByteArray& data);
+
+private:
+    void load();
+    void journal(const QByteArray& record);
+    void maybeCompact();
+
+    QHash<int, WindowState> m_windows;
+    QHash<int, TabState> m_tabs;
+    QList<TabState> m_closed;           // most recent first
+    int m_nextWindowId = 1;
+    int m_nextTabId = 1;
+    int m_journalRecords = 0;
+
+    QThread m_thread;
+    QObject* m_worker;
+    Journal* m_journal;
+};
+
+#endif // SESSIONSTORE_HPP
@@ -0,0 +1,156 @@
+/**
+ * Settings implementation
+ */
+
+#include "Settings.hpp"
+#include <QApplication>
+#include <QSettings>
+
+namespace {
+
+const int FLUSH_DELAY_MS = 500;
+
+void writeSettings(const QVariantMap& changes)
+{
+    QSettings settings(Settings::ORGANIZATION, Settings::APPLICATION);
+    for (auto it = changes.cbegin(); it != changes.cend(); ++it) {
+        if (it.value().isValid()) {
+            settings.setValue(it.key(), it.value());
+        } else {
+            settings.remove(it.key());
+        }
+    }
+    settings.sync();
+}
+
+} // namespace
+
+Settings* Settings::instance()
+{
+    static Settings* settings = nullptr;
+    if (!settings) settings = new Settings(qApp);
+    return settings;
+}
+
+Settings::Settings(QObject* parent)
+    : QObject(parent)
+    , m_worker(new QObject)
+{
+    // Top-level keys only; arrays (bookmarks etc.) are owned by their stores
+    QSettings settings(ORGANIZATION, APPLICATION);
+    const QStringList keys = settings.childKeys();
+    for (const QString& key : keys) {
+        m_values.insert(key, settings.value(key));
+    }
+
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(FLUSH_DELAY_MS);
+    connect(&m_flushTimer, &QTimer::timeout, this, [this]() {
+        const QVariantMap changes = m_pending;
+        m_pending.clear();
+        QMetaObject::invokeMethod(m_worker, [changes]() { writeSettings(changes); });
+    });
+
+    m_thread.setObjectName("Settings");
+    m_worker->moveToThread(&m_thread);
+    m_thread.start(QThread::LowPriority);
+}
+
+Settings::~Settings()
+{
+    flush();
+    m_thread.quit();
+    m_thread.wait();
+    delete m_worker;
+}
+
+QString Settings::homePage() const
+{
+    return value("homePage", DEFAULT_HOME_PAGE).toString();
+}
+
+void Settings::setHomePage(const QString& url)
+{
+    setValue("homePage", url);
+}
+
+QString Settings::searchEngine() const
+{
+    return value("searchEngine", "duckduckgo").toString();
+}
+
+void Settings::setSearchEngine(const QString& engine)
+{
+    setValue("searchEngine", engine);
+}
+
+int Settings::historyRetentionDays() const
+{
+    return value("historyRetentionDays", 90).toInt();
+}
+
+void Settings::setHistoryRetentionDays(int days)
+{
+    setValue("historyRetentionDays", days);
+}
+
+bool Settings::restoreSession() const
+{
+    return value("restoreSession", true).toBool();
+}
+
+void Settings::setRestoreSession(bool restore)
+{
+    setValue("restoreSession", restore);
+}
+
+bool Settings::newTabPage() const
+{
+    return value("newTabPage", true).toBool();
+}
+
+void Settings::setNewTabPage(bool enabled)
+{
+    setValue("newTabPage", enabled);
+}
+
+QVariant Settings::value(const QString& key, const QVariant& defaultValue) const
+{
+    return m_values.value(key, defaultValue);
+}
+
+void Settings::setValue(const QString& key, const QVariant& value)
+{
+    auto it = m_values.constFind(key);
+    if (it != m_values.constEnd() && it.value() == value) return;
+    m_values.insert(key, value);
+    m_pending.insert(key, value);
+    scheduleFlush();
+    emit changed(key);
+}
+
+void Settings::remove(const QString& key)
+{
+    if (!m_values.contains(key)) return;
+    m_values.remove(key);
+    m_pending.insert(key, QVariant());
+    scheduleFlush();
+    emit changed(key);
+}
+
+void Settings::flush()
+{
+    m_flushTimer.stop();
+    const QVariantMap changes = m_pending;
+    m_pending.clear();
+    // Blocking so anything queued before is written first, in order
+    QMetaObject::invokeMethod(m_worker, [changes]() {
+        if (!changes.isEmpty()) writeSettings(changes);
+    }, Qt::BlockingQueuedConnection);
+}
+
+void Settings::scheduleFlush()
+{
+    // Coalesce bursts of changes (e.g. dragging a spin box) into one write
+    if (!m_flushTimer.isActive()) m_flushTimer.start();
+}
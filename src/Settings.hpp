@@ -0,0 +1,72 @@
+/**
+ * Settings - Process-wide typed settings cache
+ *
+ * Reads the INI file once at startup and serves values from memory. Writes
+ * update the cache immediately, emit changed(), and are coalesced into a
+ * single QSettings sync on a background thread, so hot paths such as
+ * address-bar navigation never touch the filesystem.
+ */
+
+#ifndef SETTINGS_HPP
+#define SETTINGS_HPP
+
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVariant>
+#include <QVariantMap>
+
+class Settings : public QObject
+{
+    Q_OBJECT
+
+public:
+    static Settings* instance();
+    ~Settings();
+
+    static constexpr const char* ORGANIZATION = "ArchBrowser";
+    static constexpr const char* APPLICATION = "arch-browser";
+    static constexpr const char* DEFAULT_HOME_PAGE = "https://google.com";
+
+    QString homePage() const;
+    void setHomePage(const QString& url);
+
+    // "duckduckgo", "google" or "brave"
+    QString searchEngine() const;
+    void setSearchEngine(const QString& engine);
+
+    // 0 keeps history forever
+    int historyRetentionDays() const;
+    void setHistoryRetentionDays(int days);
+
+    // Reopen the previous session's windows and tabs at startup
+    bool restoreSession() const;
+    void setRestoreSession(bool restore);
+
+    // New tabs open archbrowser://newtab instead of the home page
+    bool newTabPage() const;
+    void setNewTabPage(bool enabled);
+
+    QVariant value(const QString& key, const QVariant& defaultValue = QVariant()) const;
+    void setValue(const QString& key, const QVariant& value);
+    void remove(const QString& key);
+
+    // Writes pending changes now (blocking); used on shutdown
+    void flush();
+
+signals:
+    void changed(const QString& key);
+
+private:
+    explicit Settings(QObject* parent = nullptr);
+    void scheduleFlush();
+
+    QVariantMap m_values;
+    QVariantMap m_pending;      // key -> value; invalid QVariant means remove
+    QTimer m_flushTimer;
+    QThread m_thread;
+    QObject* m_worker;
+};
+
+#endif // SETTINGS_HPP
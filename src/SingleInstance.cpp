@@ -0,0 +1,94 @@
+/**
+ * SingleInstance implementation
+ */
+
+#include "SingleInstance.hpp"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QLockFile>
+#include <QStandardPaths>
+
+SingleInstance::SingleInstance(QObject* parent)
+    : QObject(parent)
+    , m_name(serverName())
+{
+}
+
+SingleInstance::~SingleInstance() = default;
+
+QString SingleInstance::serverName()
+{
+    // XDG_RUNTIME_DIR is per user and cleared at logout, so a stale socket
+    // from a crash rarely outlives the session. A shared directory such as
+    // /tmp would let another user squat the name.
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    return dir.isEmpty() ? QString() : dir + "/arch-browser.sock";
+}
+
+bool SingleInstance::forward(const QString& url, bool newWindow)
+{
+    if (m_name.isEmpty()) {
+        qWarning("SingleInstance: no runtime directory, not sharing this browser with later launches");
+        return false;
+    }
+    m_lock.reset(new QLockFile(m_name + ".lock"));
+    if (!m_lock->tryLock(LOCK_TIMEOUT_MS)) {
+        // Still worth a try; listen() won't touch a socket it can't own
+        qWarning("SingleInstance: cannot lock %s", qPrintable(m_lock->fileName()));
+        m_lock.reset();
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(m_name);
+    if (socket.waitForConnected(CONNECT_TIMEOUT_MS)) {
+        QString line = url;
+        line.replace('\n', ' ');
+        socket.write(QString("%1 %2\n").arg(newWindow ? "window" : "tab", line).toUtf8());
+        socket.flush();
+        if (!socket.waitForReadyRead(ACK_TIMEOUT_MS)) {
+            qWarning("SingleInstance: running browser did not acknowledge the request");
+        }
+        return true;
+    }
+    return false;
+}
+
+void SingleInstance::listen()
+{
+    if (!m_lock) return;
+    m_server = new QLocalServer(this);
+    // Only the owner may connect, so other users can't open pages in our browser
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &SingleInstance::onNewConnection);
+
+    // Nobody answered: whatever is left at the path is from a crashed run
+    QLocalServer::removeServer(m_name);
+    if (!m_server->listen(m_name)) {
+        qWarning("SingleInstance: cannot listen on %s: %s", qPrintable(m_name),
+                 qPrintable(m_server->errorString()));
+    }
+    m_lock.reset();
+}
+
+void SingleInstance::onNewConnection()
+{
+    while (QLocalSocket* socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        if (socket->canReadLine()) onReadyRead(socket);
+    }
+}
+
+void SingleInstance::onReadyRead(QLocalSocket* socket)
+{
+    if (!socket->canReadLine()) return;
+    const QString line = QString::fromUtf8(socket->readLine()).trimmed();
+    const int space = line.indexOf(' ');
+    const QString mode = space < 0 ? line : line.left(space);
+    const QString url = space < 0 ? QString() : line.mid(space + 1).trimmed();
+
+    // Acknowledge first so the other process can exit right away
+    socket->write("\n");
+    socket->disconnectFromServer();
+    emit openRequested(url, mode == "window");
+}
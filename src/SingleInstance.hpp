@@ -0,0 +1,60 @@
+/**
+ * SingleInstance - Hands command-line URLs to an already running browser
+ *
+ * The first process listens on a QLocalServer in the user's runtime
+ * directory. Later launches connect, send the URL and whether it wants a new
+ * window or a new tab, wait for a one-byte acknowledgement and exit. That
+ * needs only a QCoreApplication, so they exit before the GUI, WebEngine or
+ * any browser data is initialized. A lock file, held from forward() to
+ * listen(), serializes the decision so two simultaneous first launches can't
+ * both become primary. Without a runtime directory there is no place private
+ * to the user for the socket, and every launch runs on its own.
+ *
+ * Wire format: one UTF-8 line per request, "tab <url>" or "window <url>"
+ * (the URL may be empty). The server answers with "\n" and disconnects.
+ */
+
+#ifndef SINGLEINSTANCE_HPP
+#define SINGLEINSTANCE_HPP
+
+#include <QObject>
+#include <QString>
+#include <memory>
+
+class QLocalServer;
+class QLockFile;
+class QLocalSocket;
+
+class SingleInstance : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SingleInstance(QObject* parent = nullptr);
+    ~SingleInstance();
+
+    // Forwards to a running instance and returns true, or returns false if
+    // this process is the first; it should then call listen()
+    bool forward(const QString& url, bool newWindow);
+    // Takes requests from later launches; needs the event loop's application
+    void listen();
+
+signals:
+    void openRequested(const QString& url, bool newWindow);
+
+private slots:
+    void onNewConnection();
+
+private:
+    static QString serverName();
+    void onReadyRead(QLocalSocket* socket);
+
+    QString m_name;
+    std::unique_ptr<QLockFile> m_lock;
+    QLocalServer* m_server = nullptr;
+    static constexpr int LOCK_TIMEOUT_MS = 5000;
+    static constexpr int CONNECT_TIMEOUT_MS = 500;
+    static constexpr int ACK_TIMEOUT_MS = 2000;
+};
+
+#endif // SINGLEINSTANCE_HPP
@@ -0,0 +1,152 @@
+/**
+ * StartupTrace implementation
+ */
+
+#include "StartupTrace.hpp"
+#include "ProcessStats.hpp"
+#include <QApplication>
+#include <QDateTime>
+#include <QEvent>
+#include <QFile>
+#include <QList>
+#include <QTimer>
+#include <QWebEnginePage>
+#include <QWebEngineScript>
+#include <cstdio>
+#include <time.h>
+
+namespace {
+
+const char* const PHASE_NAMES[StartupTrace::PhaseCount] = {
+    "process start", "QApplication ready", "profile ready", "window shown", "first contentful paint"
+};
+
+// Epoch milliseconds of the page's first contentful paint, or 0 if none yet
+const char* const FIRST_PAINT_SCRIPT =
+    "(function() {"
+    "  var e = performance.getEntriesByName('first-contentful-paint')[0];"
+    "  return e ? performance.timeOrigin + e.startTime : 0;"
+    "})()";
+
+qint64 bootTimeMs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return qint64(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Field 22 of /proc/self/stat: start time in clock ticks after boot
+qint64 processStartMs()
+{
+    QFile file("/proc/self/stat");
+    if (!file.open(QIODevice::ReadOnly)) return -1;
+    const QByteArray stat = file.readAll();
+    const int close = stat.lastIndexOf(')');
+    if (close < 0) return -1;
+    const QList<QByteArray> fields = stat.mid(close + 2).split(' ');
+    if (fields.size() < 20) return -1;
+    return fields.at(19).toLongLong() * 1000 / ProcessStats::clockTicksPerSecond();
+}
+
+} // namespace
+
+StartupTrace* StartupTrace::instance()
+{
+    static StartupTrace* trace = nullptr;
+    if (!trace) trace = new StartupTrace(qApp);
+    return trace;
+}
+
+StartupTrace::StartupTrace(QObject* parent)
+    : QObject(parent)
+{
+    for (qint64& m : m_marks) m = -1;
+    m_marks[ProcessStart] = processStartMs();
+}
+
+void StartupTrace::setReportEnabled(bool enabled)
+{
+    m_reportEnabled = enabled;
+    if (enabled) QTimer::singleShot(REPORT_TIMEOUT_MS, this, &StartupTrace::report);
+}
+
+void StartupTrace::mark(Phase phase)
+{
+    mark(phase, bootTimeMs());
+}
+
+void StartupTrace::mark(Phase phase, qint64 atMs)
+{
+    if (m_marks[phase] < 0) m_marks[phase] = atMs;
+}
+
+qint64 StartupTrace::elapsed(Phase phase) const
+{
+    if (m_marks[phase] < 0 || m_marks[ProcessStart] < 0) return -1;
+    return m_marks[phase] - m_marks[ProcessStart];
+}
+
+void StartupTrace::watchWindow(QWidget* window, std::function<void()> afterPaint)
+{
+    m_window = window;
+    m_afterPaint = std::move(afterPaint);
+    window->installEventFilter(this);
+}
+
+void StartupTrace::watchPage(QWebEnginePage* page)
+{
+    m_page = page;
+    connect(page, &QWebEnginePage::loadFinished, this, [this]() {
+        if (m_marks[FirstContentfulPaint] < 0) queryFirstPaint(0);
+    });
+}
+
+bool StartupTrace::eventFilter(QObject* watched, QEvent* event)
+{
+    if (watched == m_window && event->type() == QEvent::Paint) {
+        m_window->removeEventFilter(this);
+        mark(WindowShown);
+        // Run once this paint has been flushed to the screen
+        if (m_afterPaint) QTimer::singleShot(0, this, m_afterPaint);
+        m_afterPaint = nullptr;
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void StartupTrace::queryFirstPaint(int attempt)
+{
+    if (!m_page) return;
+    m_page->runJavaScript(FIRST_PAINT_SCRIPT, QWebEngineScript::ApplicationWorld,
+                          [this, attempt](const QVariant& result) {
+        const double paintedAt = result.toDouble();
+        if (paintedAt > 0) {
+            // Translate the page's wall-clock timestamp to boot time
+            const qint64 age = QDateTime::currentMSecsSinceEpoch() - qint64(paintedAt);
+            mark(FirstContentfulPaint, bootTimeMs() - age);
+            report();
+        } else if (attempt + 1 < PAINT_QUERY_ATTEMPTS) {
+            QTimer::singleShot(PAINT_QUERY_INTERVAL_MS, this, [this, attempt]() { queryFirstPaint(attempt + 1); });
+        }
+    });
+}
+
+void StartupTrace::report()
+{
+    if (!m_reportEnabled || m_reported) return;
+    m_reported = true;
+
+    const qint64 origin = m_marks[ProcessStart];
+    std::fprintf(stderr, "Startup trace (ms since process start):\n");
+    qint64 previous = origin;
+    for (int phase = 0; phase < PhaseCount; ++phase) {
+        const qint64 at = m_marks[phase];
+        if (at < 0 || origin < 0) {
+            std::fprintf(stderr, "  %-24s %8s\n", PHASE_NAMES[phase], "-");
+            continue;
+        }
+        std::fprintf(stderr, "  %-24s %8lld  (+%lld)\n", PHASE_NAMES[phase],
+                     static_cast<long long>(at - origin), static_cast<long long>(at - previous));
+        previous = at;
+    }
+    std::fflush(stderr);
+}
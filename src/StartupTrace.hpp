@@ -0,0 +1,62 @@
+/**
+ * StartupTrace - Timestamps for the phases of browser startup
+ *
+ * Phases are recorded on CLOCK_BOOTTIME, so "process start" can come from
+ * the kernel (/proc/self/stat) and include dynamic linking, which happens
+ * before main(). With --startup-trace the timings are printed to stderr
+ * once the first page has painted (or after 30 s).
+ *
+ * First contentful paint is read from the page's own Paint Timing entry
+ * after it loads, since QtWebEngine has no signal for it.
+ */
+
+#ifndef STARTUPTRACE_HPP
+#define STARTUPTRACE_HPP
+
+#include <QObject>
+#include <QPointer>
+#include <QWidget>
+#include <functional>
+
+class QWebEnginePage;
+
+class StartupTrace : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Phase { ProcessStart, ApplicationReady, ProfileReady, WindowShown, FirstContentfulPaint, PhaseCount };
+
+    static StartupTrace* instance();
+
+    void setReportEnabled(bool enabled);
+    // Later marks of the same phase are ignored
+    void mark(Phase phase);
+    void mark(Phase phase, qint64 atMs);
+    // Milliseconds from process start to the phase, or -1 if not reached
+    qint64 elapsed(Phase phase) const;
+
+    // Marks WindowShown at the window's first paint, then runs afterPaint
+    void watchWindow(QWidget* window, std::function<void()> afterPaint);
+    void watchPage(QWebEnginePage* page);
+
+protected:
+    bool eventFilter(QObject* watched, QEvent* event) override;
+
+private:
+    explicit StartupTrace(QObject* parent = nullptr);
+    void queryFirstPaint(int attempt);
+    void report();
+
+    qint64 m_marks[PhaseCount];
+    bool m_reportEnabled = false;
+    bool m_reported = false;
+    QPointer<QWidget> m_window;
+    QPointer<QWebEnginePage> m_page;
+    std::function<void()> m_afterPaint;
+    static constexpr int REPORT_TIMEOUT_MS = 30 * 1000;
+    static constexpr int PAINT_QUERY_ATTEMPTS = 10;
+    static constexpr int PAINT_QUERY_INTERVAL_MS = 250;
+};
+
+#endif // STARTUPTRACE_HPP
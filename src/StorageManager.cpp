@@ -0,0 +1,358 @@
+/**
+ * StorageManager implementation
+ */
+
+#include "StorageManager.hpp"
+#include "BrowserData.hpp"
+#include "FilterMatcher.hpp"
+#include "HistoryStore.hpp"
+#include "Settings.hpp"
+#include <QApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QWebEngineProfile>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+const char* const PLAN_FILE = "storage-eviction.txt";
+// Evicting a little below the quota keeps every scan from evicting again
+const double EVICT_TARGET = 0.9;
+// Cache entry keys and Cache Storage origins sit near the start of the file
+const int KEY_READ_BYTES = 4096;
+// A split HTTP cache key starts with the top-level site, right after the
+// entry header
+const int HTTP_KEY_READ_BYTES = 512;
+// Every key read is a file open; the largest entries are enough to tell
+// which sites fill the cache
+const int HTTP_CACHE_SAMPLE_FILES = 1000;
+
+struct Item
+{
+    QString path;
+    StorageManager::Category category;
+    QString site;               // empty if it has to be read from the data
+    bool readSite = true;       // false for HTTP cache files outside the sample
+};
+
+struct Measured
+{
+    QString path;
+    StorageManager::Category category;
+    QString site;
+    qint64 bytes = 0;
+    qint64 modified = 0;
+};
+
+QString siteOfHost(const QString& host)
+{
+    return host.isEmpty() ? QString() : FilterMatcher::registrableDomain(host.toLower());
+}
+
+// "https_example.com_0.indexeddb.leveldb" -> example.com
+QString siteOfIndexedDb(const QString& name)
+{
+    const int scheme = name.indexOf('_');
+    const int suffix = name.indexOf(QLatin1String(".indexeddb"));
+    if (scheme < 0 || suffix < 0) return QString();
+    const int port = name.lastIndexOf('_', suffix);
+    if (port <= scheme) return QString();
+    return siteOfHost(name.mid(scheme + 1, port - scheme - 1));
+}
+
+// Host of the first http(s) URL in data; in a split cache key
+// ("_dk_<site> <site> <url>") that is the top-level site
+QString hostOfFirstUrl(const QByteArray& data)
+{
+    for (int at = data.indexOf("://"); at >= 0; at = data.indexOf("://", at + 3)) {
+        const bool http = (at >= 4 && data.mid(at - 4, 4) == "http") || (at >= 5 && data.mid(at - 5, 5) == "https");
+        if (!http) continue;
+        int end = at + 3;
+        while (end < data.size()) {
+            const char c = data.at(end);
+            if (!(std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '-')) break;
+            ++end;
+        }
+        if (end > at + 3) return QString::fromLatin1(data.mid(at + 3, end - at - 3));
+    }
+    return QString();
+}
+
+QByteArray head(const QString& path, int bytes = KEY_READ_BYTES)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.read(bytes) : QByteArray();
+}
+
+Measured measure(const Item& item)
+{
+    Measured m;
+    m.path = item.path;
+    m.category = item.category;
+    m.site = item.site;
+
+    const QFileInfo info(item.path);
+    if (info.isDir()) {
+        m.modified = info.lastModified().toMSecsSinceEpoch();
+        QDirIterator it(item.path, QDir::Files | QDir::Hidden | QDir::NoSymLinks, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            m.bytes += it.fileInfo().size();
+            m.modified = qMax(m.modified, it.fileInfo().lastModified().toMSecsSinceEpoch());
+        }
+    } else {
+        m.bytes = info.size();
+        m.modified = info.lastModified().toMSecsSinceEpoch();
+    }
+
+    if (item.category == StorageManager::CacheStorage) {
+        m.site = siteOfHost(hostOfFirstUrl(head(item.path + "/index.txt")));
+    } else if (item.category == StorageManager::HttpCache && item.readSite) {
+        m.site = siteOfHost(hostOfFirstUrl(head(item.path, HTTP_KEY_READ_BYTES)));
+    }
+    return m;
+}
+
+QFileInfoList entriesOf(const QString& path)
+{
+    return QDir(path).entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+}
+
+void removePath(const QFileInfo& info)
+{
+    if (info.isDir()) {
+        QDir(info.filePath()).removeRecursively();
+    } else {
+        QFile::remove(info.filePath());
+    }
+}
+
+// IndexedDB and Cache Storage directories belonging to any of sites
+void removeSiteData(const QString& storagePath, const QSet<QString>& sites)
+{
+    for (const QFileInfo& origin : entriesOf(storagePath + "/IndexedDB")) {
+        if (sites.contains(siteOfIndexedDb(origin.fileName()))) removePath(origin);
+    }
+    for (const QFileInfo& origin : entriesOf(storagePath + "/Service Worker/CacheStorage")) {
+        if (sites.contains(siteOfHost(hostOfFirstUrl(head(origin.filePath() + "/index.txt"))))) removePath(origin);
+    }
+}
+
+} // namespace
+
+qint64 StorageManager::SiteUsage::total() const
+{
+    qint64 sum = 0;
+    for (qint64 b : bytes) sum += b;
+    return sum;
+}
+
+qint64 StorageManager::Report::total() const
+{
+    qint64 sum = 0;
+    for (qint64 b : totals) sum += b;
+    return sum;
+}
+
+StorageManager* StorageManager::instance()
+{
+    static StorageManager* manager = nullptr;
+    if (!manager) manager = new StorageManager(qApp);
+    return manager;
+}
+
+StorageManager::StorageManager(QObject* parent)
+    : QObject(parent)
+    , m_planPath(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/" + PLAN_FILE)
+    , m_sitesToClear(Settings::instance()->value("siteDataToClear").toStringList())
+    , m_siteDataQuotaMB(qMax(0, Settings::instance()->value("siteDataQuotaMB", 2048).toInt()))
+    , m_httpCacheQuotaMB(qMax(0, Settings::instance()->value("httpCacheQuotaMB", 0).toInt()))
+{
+    connect(&m_watcher, &QFutureWatcher<Report>::finished, this, [this]() {
+        m_report = m_watcher.result();
+        emit scanFinished();
+    });
+}
+
+StorageManager::~StorageManager()
+{
+    m_watcher.waitForFinished();
+}
+
+void StorageManager::start(const QString& storagePath, const QString& cachePath)
+{
+    m_storagePath = storagePath;
+    m_cachePath = cachePath;
+
+    if (!m_sitesToClear.isEmpty()) {
+        removeSiteData(storagePath, QSet<QString>(m_sitesToClear.cbegin(), m_sitesToClear.cend()));
+        m_sitesToClear.clear();
+        Settings::instance()->remove("siteDataToClear");
+    }
+
+    QFile file(m_planPath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return;
+    QTextStream ts(&file);
+    const qint64 plannedAt = ts.readLine().toLongLong();
+    const QDir storage(storagePath);
+    while (!ts.atEnd()) {
+        const QString relative = ts.readLine();
+        // Only ever below the profile directory
+        if (relative.isEmpty() || relative.contains(QLatin1String("..")) || QDir::isAbsolutePath(relative)) continue;
+        const QFileInfo info(storage.filePath(relative));
+        // Touched since the scan: the site is in use after all
+        if (!info.exists() || info.lastModified().toMSecsSinceEpoch() > plannedAt) continue;
+        removePath(info);
+    }
+    file.remove();
+}
+
+void StorageManager::applyTo(QWebEngineProfile* profile) const
+{
+    if (m_httpCacheQuotaMB <= 0) return;
+    const int quota = m_httpCacheQuotaMB * 1024 * 1024;
+    // 0 is Chromium's automatic size
+    const int current = profile->httpCacheMaximumSize();
+    if (current == 0 || current > quota) profile->setHttpCacheMaximumSize(quota);
+}
+
+void StorageManager::scan()
+{
+    if (isScanning() || m_storagePath.isEmpty()) return;
+    const QVector<HistoryEntry> history = BrowserData::instance()->history()->snapshot();
+    m_watcher.setFuture(QtConcurrent::run(&StorageManager::scanDirectories, m_storagePath, m_cachePath,
+                                          history, qint64(m_siteDataQuotaMB) * 1024 * 1024, m_planPath));
+}
+
+void StorageManager::clearSiteData(const QString& site)
+{
+    if (site.isEmpty() || m_sitesToClear.contains(site)) return;
+    m_sitesToClear.append(site);
+    Settings::instance()->setValue("siteDataToClear", m_sitesToClear);
+}
+
+void StorageManager::setSiteDataQuotaMB(int mb)
+{
+    m_siteDataQuotaMB = qMax(0, mb);
+    Settings::instance()->setValue("siteDataQuotaMB", m_siteDataQuotaMB);
+}
+
+void StorageManager::setHttpCacheQuotaMB(int mb)
+{
+    m_httpCacheQuotaMB = qMax(0, mb);
+    Settings::instance()->setValue("httpCacheQuotaMB", m_httpCacheQuotaMB);
+}
+
+StorageManager::Report StorageManager::scanDirectories(const QString& storagePath, const QString& cachePath,
+                                                       const QVector<HistoryEntry>& history, qint64 quotaBytes,
+                                                       const QString& planPath)
+{
+    // One task per origin directory or cache file; the walk below each one
+    // happens inside its task
+    QVector<Item> items;
+    const QString cacheDir = QDir(cachePath).absolutePath();
+    for (const QFileInfo& entry : entriesOf(storagePath)) {
+        const QString name = entry.fileName();
+        if (entry.absoluteFilePath() == cacheDir) continue;
+        if (name == QLatin1String("IndexedDB")) {
+            for (const QFileInfo& origin : entriesOf(entry.filePath())) {
+                items.append({origin.filePath(), IndexedDb, siteOfIndexedDb(origin.fileName())});
+            }
+        } else if (name == QLatin1String("Service Worker")) {
+            for (const QFileInfo& part : entriesOf(entry.filePath())) {
+                if (part.fileName() != QLatin1String("CacheStorage")) {
+                    items.append({part.filePath(), Other, QString()});
+                    continue;
+                }
+                for (const QFileInfo& origin : entriesOf(part.filePath())) {
+                    items.append({origin.filePath(), CacheStorage, QString()});
+                }
+            }
+        } else if (name == QLatin1String("Local Storage")) {
+            items.append({entry.filePath(), LocalStorage, QString()});
+        } else {
+            items.append({entry.filePath(), Other, QString()});
+        }
+    }
+    // Only the largest cache files are opened to find their site; the rest
+    // just count towards the total
+    QVector<QPair<qint64, QString>> cacheFiles;
+    QDirIterator it(cachePath, QDir::Files | QDir::Hidden | QDir::NoSymLinks, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        cacheFiles.append({it.fileInfo().size(), it.filePath()});
+    }
+    const int sampled = qMin(HTTP_CACHE_SAMPLE_FILES, cacheFiles.size());
+    std::nth_element(cacheFiles.begin(), cacheFiles.begin() + sampled, cacheFiles.end(),
+                     [](const QPair<qint64, QString>& a, const QPair<qint64, QString>& b) { return a.first > b.first; });
+    for (int i = 0; i < cacheFiles.size(); ++i) {
+        items.append({cacheFiles.at(i).second, HttpCache, QString(), i < sampled});
+    }
+
+    const QVector<Measured> measured = QtConcurrent::blockingMapped<QVector<Measured>>(items, measure);
+
+    Report report;
+    report.scannedAt = QDateTime::currentMSecsSinceEpoch();
+    QHash<QString, SiteUsage> sites;
+    QHash<QString, QStringList> siteDataPaths;
+    for (const Measured& m : measured) {
+        report.totals[m.category] += m.bytes;
+        if (m.site.isEmpty()) continue;
+        SiteUsage& usage = sites[m.site];
+        usage.site = m.site;
+        usage.bytes[m.category] += m.bytes;
+        usage.lastUsed = qMax(usage.lastUsed, m.modified);
+        if (m.category == IndexedDb || m.category == CacheStorage) siteDataPaths[m.site].append(m.path);
+    }
+    for (const HistoryEntry& entry : history) {
+        if (entry.isNull()) continue;
+        auto it = sites.find(siteOfHost(HistoryStore::hostOf(entry.url)));
+        if (it != sites.end()) it->lastUsed = qMax(it->lastUsed, entry.timestamp);
+    }
+    report.sites = QVector<SiteUsage>(sites.cbegin(), sites.cend());
+    std::sort(report.sites.begin(), report.sites.end(), [](const SiteUsage& a, const SiteUsage& b) {
+        return a.total() > b.total();
+    });
+
+    // Least recently used site data first, until under the target
+    QStringList plan;
+    qint64 siteData = report.totals[IndexedDb] + report.totals[CacheStorage];
+    if (quotaBytes > 0 && siteData > quotaBytes) {
+        QVector<SiteUsage> candidates;
+        for (const SiteUsage& usage : qAsConst(report.sites)) {
+            if (usage.siteData() > 0) candidates.append(usage);
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const SiteUsage& a, const SiteUsage& b) {
+            return a.lastUsed < b.lastUsed;
+        });
+        const QDir storage(storagePath);
+        for (const SiteUsage& usage : qAsConst(candidates)) {
+            if (siteData <= quotaBytes * EVICT_TARGET) break;
+            for (const QString& path : siteDataPaths.value(usage.site)) plan.append(storage.relativeFilePath(path));
+            siteData -= usage.siteData();
+            report.bytesToEvict += usage.siteData();
+            ++report.sitesToEvict;
+        }
+    }
+
+    if (plan.isEmpty()) {
+        QFile::remove(planPath);
+    } else {
+        QSaveFile file(planPath);
+        if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            file.write(QByteArray::number(report.scannedAt) + '\n' + plan.join('\n').toUtf8() + '\n');
+            file.commit();
+        }
+    }
+    return report;
+}
@@ -0,0 +1,105 @@
+/**
+ * StorageManager - Disk usage of the default profile, by site, with quotas
+ *
+ * scan() walks the profile and cache directories on the thread pool, one
+ * task per top-level entry (an IndexedDB origin, a Cache Storage origin,
+ * an HTTP cache file...), and attributes the bytes to sites by registrable
+ * domain:
+ * - IndexedDB: from the directory name (https_example.com_0.indexeddb.*)
+ * - Cache Storage: from the origin recorded in the directory's index
+ * - HTTP cache: from the URL key at the start of each entry file, for the
+ *   largest thousand files only; the rest count towards the total alone
+ * Local Storage is one database for all sites, so it is only totalled.
+ *
+ * Site data (IndexedDB and Cache Storage) over the quota is evicted least
+ * recently used first, where use is the later of the data's modification
+ * time and the last visit in history. Chromium has the files open while it
+ * runs, so a scan only writes down what to delete; start() deletes it at
+ * the next launch, before the profile opens its storage, skipping anything
+ * used since. Site data the user clears by hand is removed the same way.
+ * The HTTP cache quota is handed to Chromium, which evicts on
+ * its own.
+ */
+
+#ifndef STORAGEMANAGER_HPP
+#define STORAGEMANAGER_HPP
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct HistoryEntry;
+class QWebEngineProfile;
+
+class StorageManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static StorageManager* instance();
+    ~StorageManager();
+
+    enum Category { IndexedDb, CacheStorage, LocalStorage, HttpCache, Other, CategoryCount };
+
+    struct SiteUsage
+    {
+        QString site;
+        qint64 bytes[CategoryCount] = {};
+        qint64 lastUsed = 0;    // ms since epoch
+        qint64 total() const;
+        qint64 siteData() const { return bytes[IndexedDb] + bytes[CacheStorage]; }
+    };
+
+    struct Report
+    {
+        QVector<SiteUsage> sites;   // largest first
+        qint64 totals[CategoryCount] = {};
+        qint64 scannedAt = 0;
+        // Planned for the next start
+        int sitesToEvict = 0;
+        qint64 bytesToEvict = 0;
+        qint64 total() const;
+    };
+
+    // Before anything opens the profile: applies the last scan's evictions
+    void start(const QString& storagePath, const QString& cachePath);
+    void applyTo(QWebEngineProfile* profile) const;
+
+    void scan();
+    bool isScanning() const { return m_watcher.isRunning(); }
+    Report report() const { return m_report; }
+
+    // IndexedDB and Cache Storage of the site (and its subdomains), removed
+    // at the next start like evictions, but even if used in the meantime
+    void clearSiteData(const QString& site);
+    QStringList sitesToClear() const { return m_sitesToClear; }
+
+    // 0 means unlimited; the HTTP cache quota applies from the next start
+    int siteDataQuotaMB() const { return m_siteDataQuotaMB; }
+    void setSiteDataQuotaMB(int mb);
+    int httpCacheQuotaMB() const { return m_httpCacheQuotaMB; }
+    void setHttpCacheQuotaMB(int mb);
+
+signals:
+    void scanFinished();
+
+private:
+    explicit StorageManager(QObject* parent = nullptr);
+
+    static Report scanDirectories(const QString& storagePath, const QString& cachePath,
+                                  const QVector<HistoryEntry>& history, qint64 quotaBytes,
+                                  const QString& planPath);
+
+    QString m_storagePath;
+    QString m_cachePath;
+    QString m_planPath;
+    QStringList m_sitesToClear;
+    int m_siteDataQuotaMB;
+    int m_httpCacheQuotaMB;
+    Report m_report;
+    QFutureWatcher<Report> m_watcher;
+};
+
+#endif // STORAGEMANAGER_HPP
@@ -0,0 +1,162 @@
+/**
+ * TabLifecycleManager implementation
+ */
+
+#include "TabLifecycleManager.hpp"
+#include "Settings.hpp"
+#include "ProcessStats.hpp"
+#include <QApplication>
+#include <QDateTime>
+#include <QVector>
+#include <QWebEnginePage>
+#include <QWebEngineView>
+#include <algorithm>
+
+namespace {
+
+const int TICK_MS = 10 * 1000;
+const int CRITICAL_DISCARDS = 3;
+
+} // namespace
+
+TabLifecycleManager* TabLifecycleManager::instance()
+{
+    static TabLifecycleManager* manager = nullptr;
+    if (!manager) manager = new TabLifecycleManager(qApp);
+    return manager;
+}
+
+TabLifecycleManager::TabLifecycleManager(QObject* parent)
+    : QObject(parent)
+    , m_freezeAfterMinutes(Settings::instance()->value("tabFreezeMinutes", 5).toInt())
+    , m_discardBelowPercent(Settings::instance()->value("tabDiscardMemoryPercent", 10).toInt())
+    , m_pressureThreshold(Settings::instance()->value("tabDiscardPressure", 20).toInt())
+{
+    sampleMemory();
+    m_timer.setInterval(TICK_MS);
+    connect(&m_timer, &QTimer::timeout, this, &TabLifecycleManager::tick);
+    m_timer.start();
+}
+
+void TabLifecycleManager::track(QWebEngineView* view)
+{
+    m_tabs.insert(view, {QDateTime::currentMSecsSinceEpoch(), false});
+    connect(view, &QObject::destroyed, this, [this, view]() { m_tabs.remove(view); });
+}
+
+void TabLifecycleManager::noteActivated(QWebEngineView* view)
+{
+    auto it = m_tabs.find(view);
+    if (it == m_tabs.end()) return;
+    it->lastActive = QDateTime::currentMSecsSinceEpoch();
+    if (it->frozen) {
+        view->page()->setLifecycleState(QWebEnginePage::LifecycleState::Active);
+        it->frozen = false;
+    }
+}
+
+void TabLifecycleManager::sampleMemory()
+{
+    const ProcessStats::SystemMemory mem = ProcessStats::systemMemory();
+    m_availablePercent = mem.totalBytes > 0 && mem.availableBytes >= 0
+        ? 100.0 * mem.availableBytes / mem.totalBytes : 100.0;
+    const double stall = ProcessStats::memoryPressure();
+
+    Pressure level = Pressure::None;
+    const bool lowMemory = m_discardBelowPercent > 0 && m_availablePercent < m_discardBelowPercent;
+    const bool stalled = m_pressureThreshold > 0 && stall > m_pressureThreshold;
+    if (lowMemory || stalled) {
+        // Half the free-memory floor, or three times the stall threshold
+        const bool critical = (m_discardBelowPercent > 0 && m_availablePercent < m_discardBelowPercent / 2.0)
+            || (m_pressureThreshold > 0 && stall > 3.0 * m_pressureThreshold);
+        level = critical ? Pressure::Critical : Pressure::Moderate;
+    }
+    if (level != m_pressure) {
+        m_pressure = level;
+        emit pressureChanged(level);
+    }
+}
+
+void TabLifecycleManager::setFreezeAfterMinutes(int minutes)
+{
+    m_freezeAfterMinutes = qMax(0, minutes);
+    Settings::instance()->setValue("tabFreezeMinutes", m_freezeAfterMinutes);
+}
+
+void TabLifecycleManager::setDiscardBelowPercent(int percent)
+{
+    m_discardBelowPercent = qBound(0, percent, 90);
+    Settings::instance()->setValue("tabDiscardMemoryPercent", m_discardBelowPercent);
+}
+
+void TabLifecycleManager::setPressureThreshold(int avg10)
+{
+    m_pressureThreshold = qBound(0, avg10, 100);
+    Settings::instance()->setValue("tabDiscardPressure", m_pressureThreshold);
+}
+
+void TabLifecycleManager::tick()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    bool changed = false;
+
+    // Visible tabs count as active right up to the moment they're hidden
+    for (auto it = m_tabs.begin(); it != m_tabs.end(); ++it) {
+        if (it.key()->isVisible()) it->lastActive = now;
+    }
+
+    if (m_freezeAfterMinutes > 0) {
+        const qint64 cutoff = now - qint64(m_freezeAfterMinutes) * 60 * 1000;
+        for (auto it = m_tabs.begin(); it != m_tabs.end(); ++it) {
+            QWebEngineView* view = it.key();
+            if (it->frozen || it->lastActive > cutoff || view->isVisible() || isExempt(view)) continue;
+            view->page()->setLifecycleState(QWebEnginePage::LifecycleState::Frozen);
+            it->frozen = true;
+            ++m_stats.frozen;
+            changed = true;
+        }
+    }
+
+    sampleMemory();
+    const Pressure level = m_pressure;
+    if (level != Pressure::None) {
+        QVector<QWebEngineView*> candidates;
+        for (auto it = m_tabs.cbegin(); it != m_tabs.cend(); ++it) {
+            if (!it.key()->isVisible() && !isExempt(it.key())) candidates.append(it.key());
+        }
+        std::sort(candidates.begin(), candidates.end(), [this](QWebEngineView* a, QWebEngineView* b) {
+            return m_tabs.value(a).lastActive < m_tabs.value(b).lastActive;
+        });
+        // Memory is released asynchronously, so go gently and re-check next tick
+        const int count = qMin(candidates.size(), level == Pressure::Critical ? CRITICAL_DISCARDS : 1);
+        for (int i = 0; i < count; ++i) discard(candidates.at(i));
+    }
+
+    if (changed) emit statsChanged();
+}
+
+void TabLifecycleManager::discard(QWebEngineView* view)
+{
+    if (!m_tabs.contains(view) || view->isVisible()) return;
+    m_stats.reclaimedBytes += estimateReclaim(view);
+    ++m_stats.discarded;
+    m_tabs.remove(view);
+    emit discardRequested(view);
+    emit statsChanged();
+}
+
+bool TabLifecycleManager::isExempt(QWebEngineView* view) const
+{
+    return view->property(PINNED_PROPERTY).toBool() || view->page()->recentlyAudible();
+}
+
+qint64 TabLifecycleManager::estimateReclaim(QWebEngineView* view) const
+{
+    // A renderer shared with another live tab stays alive after the discard
+    const qint64 pid = view->page()->renderProcessPid();
+    if (pid <= 0) return 0;
+    for (auto it = m_tabs.cbegin(); it != m_tabs.cend(); ++it) {
+        if (it.key() != view && it.key()->page()->renderProcessPid() == pid) return 0;
+    }
+    return qMax<qint64>(0, ProcessStats::memoryOf(pid));
+}
@@ -0,0 +1,92 @@
+/**
+ * TabLifecycleManager - Freezes and discards background tabs
+ *
+ * Two tiers, checked on a timer across every window:
+ * - Freeze: a tab hidden for longer than freezeAfterMinutes is put in the
+ *   Frozen page lifecycle state (no timers or JS run; memory kept)
+ * - Discard: when memory runs low (MemAvailable in /proc/meminfo below a
+ *   percentage, or /proc/pressure/memory "some avg10" above a threshold),
+ *   the least recently used tabs are handed back to their window to be
+ *   replaced by placeholders, which frees their renderer entirely
+ * The visible tab of each window, pinned tabs and tabs that recently played
+ * audio are never touched.
+ */
+
+#ifndef TABLIFECYCLEMANAGER_HPP
+#define TABLIFECYCLEMANAGER_HPP
+
+#include <QObject>
+#include <QHash>
+#include <QTimer>
+
+class QWebEngineView;
+
+class TabLifecycleManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static TabLifecycleManager* instance();
+
+    // Tab widgets carrying this property set to true are exempt
+    static constexpr const char* PINNED_PROPERTY = "pinned";
+
+    struct Stats
+    {
+        int frozen = 0;
+        int discarded = 0;
+        qint64 reclaimedBytes = 0;  // renderer memory freed by discards (estimated)
+    };
+
+    enum class Pressure { None, Moderate, Critical };
+
+    // Views are forgotten automatically when destroyed
+    void track(QWebEngineView* view);
+    void noteActivated(QWebEngineView* view);
+    // Discards now, regardless of pressure; visible tabs are left alone
+    void discard(QWebEngineView* view);
+
+    Stats stats() const { return m_stats; }
+    // As of the last check (every few seconds)
+    Pressure pressure() const { return m_pressure; }
+    double availableMemoryPercent() const { return m_availablePercent; }
+
+    // 0 disables the tier
+    int freezeAfterMinutes() const { return m_freezeAfterMinutes; }
+    void setFreezeAfterMinutes(int minutes);
+    int discardBelowPercent() const { return m_discardBelowPercent; }
+    void setDiscardBelowPercent(int percent);
+    int pressureThreshold() const { return m_pressureThreshold; }
+    void setPressureThreshold(int avg10);
+
+signals:
+    // The owning window should swap the view for a placeholder
+    void discardRequested(QWebEngineView* view);
+    void statsChanged();
+    void pressureChanged(TabLifecycleManager::Pressure pressure);
+
+private:
+    explicit TabLifecycleManager(QObject* parent = nullptr);
+
+    struct TabInfo
+    {
+        qint64 lastActive = 0;
+        bool frozen = false;
+    };
+
+    void tick();
+    void sampleMemory();
+    bool isExempt(QWebEngineView* view) const;
+    qint64 estimateReclaim(QWebEngineView* view) const;
+
+    QHash<QWebEngineView*, TabInfo> m_tabs;
+    Stats m_stats;
+    Pressure m_pressure = Pressure::None;
+    double m_availablePercent = 100.0;
+    int m_freezeAfterMinutes;
+    int m_discardBelowPercent;
+    int m_pressureThreshold;
+    QTimer m_timer;
+};
+
+#endif // TABLIFECYCLEMANAGER_HPP
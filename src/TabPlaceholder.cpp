@@ -0,0 +1,19 @@
+/**
+ * TabPlaceholder implementation
+ */
+
+#include "TabPlaceholder.hpp"
+#include <QLabel>
+#include <QVBoxLayout>
+
+TabPlaceholder::TabPlaceholder(const TabState& state, QWidget* parent)
+    : QWidget(parent)
+    , m_state(state)
+{
+    // Only seen for a moment while the real view is created
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    QLabel* label = new QLabel(m_state.url.toDisplayString(), this);
+    label->setAlignment(Qt::AlignCenter);
+    label->setEnabled(false);
+    layout->addWidget(label);
+}
@@ -0,0 +1,28 @@
+/**
+ * TabPlaceholder - Stand-in for a tab whose page isn't loaded
+ *
+ * Holds a tab's saved state (URL, title, navigation history) without a
+ * QWebEngineView, so it costs no renderer process. MainWindow swaps it for
+ * a real WebView the first time the tab is activated.
+ */
+
+#ifndef TABPLACEHOLDER_HPP
+#define TABPLACEHOLDER_HPP
+
+#include <QWidget>
+#include "SessionStore.hpp"
+
+class TabPlaceholder : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TabPlaceholder(const TabState& state, QWidget* parent = nullptr);
+
+    const TabState& state() const { return m_state; }
+
+private:
+    TabState m_state;
+};
+
+#endif // TABPLACEHOLDER_HPP
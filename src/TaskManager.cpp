@@ -0,0 +1,273 @@
+/**
+ * TaskManager implementation
+ */
+
+#include "TaskManager.hpp"
+#include "MainWindow.hpp"
+#include "WebView.hpp"
+#include "TabLifecycleManager.hpp"
+#include <QApplication>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QMessageBox>
+#include <QElapsedTimer>
+#include <QLocale>
+#include <QSet>
+#include <QWebEnginePage>
+#include <QWebEngineScript>
+#include <signal.h>
+
+namespace {
+
+enum Column { ColTask, ColPid, ColCpu, ColPss, ColRss, ColNetwork, ColumnCount };
+
+// Runs in an isolated world so pages can't interfere with the numbers
+const char* const NETWORK_SCRIPT =
+    "(function() {"
+    "  var total = 0;"
+    "  ['navigation', 'resource'].forEach(function(type) {"
+    "    performance.getEntriesByType(type).forEach(function(e) { total += e.transferSize || 0; });"
+    "  });"
+    "  return total;"
+    "})()";
+
+// Numeric columns sort by the raw value kept in Qt::UserRole
+class TaskItem : public QTreeWidgetItem
+{
+public:
+    using QTreeWidgetItem::QTreeWidgetItem;
+
+    bool operator<(const QTreeWidgetItem& other) const override
+    {
+        const int column = treeWidget() ? treeWidget()->sortColumn() : 0;
+        if (column == ColTask) return QTreeWidgetItem::operator<(other);
+        return data(column, Qt::UserRole).toDouble() < other.data(column, Qt::UserRole).toDouble();
+    }
+};
+
+void setCell(QTreeWidgetItem* item, int column, double value, const QString& text)
+{
+    item->setData(column, Qt::UserRole, value);
+    item->setText(column, value < 0 ? QStringLiteral("–") : text);
+}
+
+void setBytes(QTreeWidgetItem* item, int column, qint64 bytes)
+{
+    setCell(item, column, bytes, QLocale().formattedDataSize(bytes));
+}
+
+} // namespace
+
+TaskManager::TaskManager(QWidget* parent)
+    : QWidget(parent, Qt::Window)
+    , m_worker(new QObject)
+{
+    setAttribute(Qt::WA_DeleteOnClose);
+    setWindowTitle(tr("Task Manager"));
+    resize(760, 420);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+
+    m_table = new QTreeWidget(this);
+    m_table->setColumnCount(ColumnCount);
+    m_table->setHeaderLabels({tr("Task"), tr("Process ID"), tr("CPU"), tr("Memory (PSS)"),
+                              tr("Resident (RSS)"), tr("Network")});
+    m_table->setRootIsDecorated(false);
+    m_table->setUniformRowHeights(true);
+    m_table->header()->setSectionResizeMode(ColTask, QHeaderView::Stretch);
+    m_table->header()->setStretchLastSection(false);
+    for (int column = ColPid; column < ColumnCount; ++column) {
+        m_table->header()->setSectionResizeMode(column, QHeaderView::ResizeToContents);
+    }
+    layout->addWidget(m_table);
+
+    m_browserItem = new TaskItem(m_table);
+    m_browserItem->setText(ColTask, tr("Browser"));
+    setCell(m_browserItem, ColPid, QCoreApplication::applicationPid(),
+            QString::number(QCoreApplication::applicationPid()));
+    setCell(m_browserItem, ColNetwork, -1, QString());
+
+    m_table->setSortingEnabled(true);
+    m_table->sortByColumn(ColPss, Qt::DescendingOrder);
+
+    QHBoxLayout* buttons = new QHBoxLayout;
+    m_discardBtn = new QPushButton(tr("&Discard Tab"), this);
+    m_discardBtn->setToolTip(tr("Unload the tab; it reloads when you switch to it"));
+    m_endBtn = new QPushButton(tr("&End Process"), this);
+    QPushButton* closeBtn = new QPushButton(tr("&Close"), this);
+    buttons->addWidget(m_discardBtn);
+    buttons->addWidget(m_endBtn);
+    buttons->addStretch();
+    buttons->addWidget(closeBtn);
+    layout->addLayout(buttons);
+
+    m_thread.setObjectName("TaskManager");
+    m_worker->moveToThread(&m_thread);
+    m_thread.start(QThread::LowPriority);
+
+    m_timer.setInterval(REFRESH_MS);
+    connect(&m_timer, &QTimer::timeout, this, &TaskManager::refresh);
+    connect(m_table, &QTreeWidget::itemSelectionChanged, this, &TaskManager::updateButtons);
+    connect(m_discardBtn, &QPushButton::clicked, this, &TaskManager::onDiscardTab);
+    connect(m_endBtn, &QPushButton::clicked, this, &TaskManager::onEndProcess);
+    connect(closeBtn, &QPushButton::clicked, this, &QWidget::close);
+
+    updateButtons();
+}
+
+TaskManager::~TaskManager()
+{
+    // Results queued back to us after this are dropped with the object
+    m_thread.quit();
+    m_thread.wait();
+    delete m_worker;
+}
+
+void TaskManager::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    refresh();
+    m_timer.start();
+}
+
+void TaskManager::hideEvent(QHideEvent* event)
+{
+    m_timer.stop();
+    QWidget::hideEvent(event);
+}
+
+void TaskManager::refresh()
+{
+    // A slow disk shouldn't pile up samples behind each other
+    if (m_sampling) return;
+
+    QSet<qint64> pids;
+    pids.insert(QCoreApplication::applicationPid());
+
+    m_table->setSortingEnabled(false);
+    for (QWidget* top : QApplication::topLevelWidgets()) {
+        if (!qobject_cast<MainWindow*>(top)) continue;
+        for (WebView* view : top->findChildren<WebView*>()) {
+            QTreeWidgetItem* item = m_items.value(view);
+            if (!item) {
+                item = new TaskItem(m_table);
+                m_items.insert(view, item);
+                connect(view, &QObject::destroyed, this, [this, view]() {
+                    delete m_items.take(view);
+                    updateButtons();
+                });
+            }
+            const QString title = view->title().isEmpty() ? view->url().toDisplayString() : view->title();
+            item->setText(ColTask, tr("Tab: %1").arg(title));
+            item->setToolTip(ColTask, view->url().toDisplayString());
+            const qint64 pid = view->page()->renderProcessPid();
+            setCell(item, ColPid, pid > 0 ? pid : -1, QString::number(pid));
+            if (pid > 0) pids.insert(pid);
+            sampleNetwork(view);
+        }
+    }
+    m_table->setSortingEnabled(true);
+    updateButtons();
+
+    m_sampling = true;
+    QMetaObject::invokeMethod(m_worker, [this, pids]() {
+        QHash<qint64, ProcessStats::Sample> samples;
+        for (qint64 pid : pids) samples.insert(pid, ProcessStats::sample(pid));
+        QElapsedTimer clock;
+        clock.start();
+        const qint64 atMs = clock.msecsSinceReference();
+        QMetaObject::invokeMethod(this, [this, samples, atMs]() { applySamples(samples, atMs); },
+                                  Qt::QueuedConnection);
+    });
+}
+
+void TaskManager::applySamples(const QHash<qint64, ProcessStats::Sample>& samples, qint64 atMs)
+{
+    m_sampling = false;
+
+    // CPU is the share of one core used since the previous sample
+    QHash<qint64, double> cpu;
+    QHash<qint64, CpuMark> marks;
+    for (auto it = samples.cbegin(); it != samples.cend(); ++it) {
+        const CpuMark last = m_lastCpu.value(it.key());
+        double percent = -1;
+        if (it->cpuTicks >= 0 && last.ticks >= 0 && atMs > last.atMs) {
+            percent = 100.0 * (it->cpuTicks - last.ticks) / ProcessStats::clockTicksPerSecond()
+                      / ((atMs - last.atMs) / 1000.0);
+        }
+        cpu.insert(it.key(), percent);
+        marks.insert(it.key(), {it->cpuTicks, atMs});
+    }
+    m_lastCpu = marks;
+
+    auto fill = [&](QTreeWidgetItem* item) {
+        const qint64 pid = item->data(ColPid, Qt::UserRole).toLongLong();
+        const ProcessStats::Sample sample = samples.value(pid);
+        const double percent = cpu.value(pid, -1);
+        setCell(item, ColCpu, percent, QString::number(percent, 'f', 1) + '%');
+        setBytes(item, ColPss, sample.pssBytes);
+        setBytes(item, ColRss, sample.rssBytes);
+    };
+
+    m_table->setSortingEnabled(false);
+    fill(m_browserItem);
+    for (QTreeWidgetItem* item : qAsConst(m_items)) fill(item);
+    m_table->setSortingEnabled(true);
+}
+
+void TaskManager::sampleNetwork(QWebEngineView* view)
+{
+    // A frozen page wouldn't answer until it thaws; keep its last figure
+    if (view->page()->lifecycleState() != QWebEnginePage::LifecycleState::Active) return;
+
+    QPointer<TaskManager> self(this);
+    view->page()->runJavaScript(NETWORK_SCRIPT, QWebEngineScript::ApplicationWorld,
+                                [self, view](const QVariant& result) {
+        if (!self) return;
+        QTreeWidgetItem* item = self->m_items.value(view);
+        if (item && result.isValid()) setBytes(item, ColNetwork, result.toLongLong());
+    });
+}
+
+QWebEngineView* TaskManager::selectedView() const
+{
+    QTreeWidgetItem* item = m_table->currentItem();
+    if (!item || !item->isSelected()) return nullptr;
+    return m_items.key(item, nullptr);
+}
+
+void TaskManager::updateButtons()
+{
+    QWebEngineView* view = selectedView();
+    m_discardBtn->setEnabled(view && !view->isVisible());
+    m_endBtn->setEnabled(view && view->page()->renderProcessPid() > 0);
+}
+
+void TaskManager::onDiscardTab()
+{
+    if (QWebEngineView* view = selectedView()) TabLifecycleManager::instance()->discard(view);
+}
+
+void TaskManager::onEndProcess()
+{
+    QWebEngineView* view = selectedView();
+    if (!view) return;
+    const qint64 pid = view->page()->renderProcessPid();
+    if (pid <= 0) return;
+
+    int sharing = 0;
+    for (auto it = m_items.cbegin(); it != m_items.cend(); ++it) {
+        if (it.key()->page()->renderProcessPid() == pid) ++sharing;
+    }
+    const QString question = sharing > 1
+        ? tr("End process %1? The %2 tabs it renders will show an error until reloaded.").arg(pid).arg(sharing)
+        : tr("End process %1? The tab will show an error until reloaded.").arg(pid);
+    if (QMessageBox::question(this, tr("End Process"), question,
+                              QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes) {
+        return;
+    }
+    ::kill(pid_t(pid), SIGTERM);
+}
@@ -0,0 +1,72 @@
+/**
+ * TaskManager - Per-tab CPU, memory and network usage
+ *
+ * Lists the browser process and every loaded tab in every window, mapped to
+ * its renderer through QWebEnginePage::renderProcessPid(). /proc is read on
+ * a worker thread every couple of seconds while the window is open; the GUI
+ * thread only collects pids and fills in the table.
+ *
+ * Network is the sum of transferSize over the page's Performance resource
+ * timing entries, so it counts what the page itself fetched (cross-origin
+ * entries without Timing-Allow-Origin report 0). Tabs sharing a renderer
+ * show the same process figures.
+ */
+
+#ifndef TASKMANAGER_HPP
+#define TASKMANAGER_HPP
+
+#include <QWidget>
+#include <QHash>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+#include "ProcessStats.hpp"
+
+class QTreeWidget;
+class QTreeWidgetItem;
+class QPushButton;
+class QWebEngineView;
+
+class TaskManager : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TaskManager(QWidget* parent = nullptr);
+    ~TaskManager();
+
+protected:
+    void showEvent(QShowEvent* event) override;
+    void hideEvent(QHideEvent* event) override;
+
+private slots:
+    void refresh();
+    void onEndProcess();
+    void onDiscardTab();
+
+private:
+    struct CpuMark
+    {
+        qint64 ticks = -1;
+        qint64 atMs = 0;
+    };
+
+    void applySamples(const QHash<qint64, ProcessStats::Sample>& samples, qint64 atMs);
+    void sampleNetwork(QWebEngineView* view);
+    QWebEngineView* selectedView() const;
+    void updateButtons();
+
+    QTreeWidget* m_table;
+    QTreeWidgetItem* m_browserItem;
+    QPushButton* m_endBtn;
+    QPushButton* m_discardBtn;
+    QHash<QWebEngineView*, QTreeWidgetItem*> m_items;
+    QHash<qint64, CpuMark> m_lastCpu;
+    bool m_sampling = false;
+    QTimer m_timer;
+    QThread m_thread;
+    QObject* m_worker;
+    static constexpr int REFRESH_MS = 2000;
+};
+
+#endif // TASKMANAGER_HPP
@@ -0,0 +1,148 @@
+/**
+ * ThumbnailCache implementation
+ */
+
+#include "ThumbnailCache.hpp"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QPointer>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QWebEngineView>
+
+namespace {
+
+const int JPEG_QUALITY = 70;
+
+} // namespace
+
+ThumbnailCache::ThumbnailCache(QObject* parent)
+    : QObject(parent)
+    , m_dir(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/thumbnails")
+    , m_worker(new QObject)
+{
+    m_thread.setObjectName("ThumbnailCache");
+    m_worker->moveToThread(&m_thread);
+    m_thread.start(QThread::LowestPriority);
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    m_thread.quit();
+    m_thread.wait();
+    delete m_worker;
+}
+
+QString ThumbnailCache::keyFor(const QString& url)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(url.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+void ThumbnailCache::setWanted(const QStringList& urls)
+{
+    QSet<QString> wanted;
+    QStringList missing;
+    for (const QString& url : urls) {
+        const QString key = keyFor(url);
+        wanted.insert(key);
+        if (!m_images.contains(key)) missing.append(key);
+    }
+    m_wanted = wanted;
+
+    // Pages that dropped off the list don't need to stay in memory
+    for (auto it = m_images.begin(); it != m_images.end();) {
+        if (m_wanted.contains(it.key())) ++it;
+        else it = m_images.erase(it);
+    }
+    if (missing.isEmpty()) return;
+
+    const QString dir = m_dir;
+    QMetaObject::invokeMethod(m_worker, [this, dir, missing]() {
+        for (const QString& key : missing) {
+            QFile file(dir + "/" + key + ".jpg");
+            if (!file.open(QIODevice::ReadOnly)) continue;
+            const QByteArray jpeg = file.readAll();
+            const qint64 capturedAt = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+            QMetaObject::invokeMethod(this, [this, key, jpeg, capturedAt]() { store(key, jpeg, capturedAt); },
+                                      Qt::QueuedConnection);
+        }
+    });
+}
+
+void ThumbnailCache::capture(QWebEngineView* view)
+{
+    const QString key = keyFor(view->url().toString());
+    if (!m_wanted.contains(key)) return;
+    if (QDateTime::currentMSecsSinceEpoch() - m_capturedAt.value(key, 0) < MAX_AGE_MS) return;
+
+    // Give the page a moment to finish painting; only a visible view has pixels
+    QPointer<QWebEngineView> guard(view);
+    QTimer::singleShot(CAPTURE_DELAY_MS, this, [this, guard, key]() {
+        if (!guard || !guard->isVisible() || keyFor(guard->url().toString()) != key) return;
+        const QImage image = guard->grab().toImage();
+        if (image.isNull()) return;
+        const qint64 now = QDateTime::currentMSecsSinceEpoch();
+        m_capturedAt.insert(key, now);
+
+        const QString dir = m_dir;
+        QMetaObject::invokeMethod(m_worker, [this, dir, key, image, now]() {
+            const QImage scaled = image.scaled(WIDTH, HEIGHT, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation)
+                                       .copy(0, 0, WIDTH, HEIGHT);
+            QByteArray jpeg;
+            QBuffer buffer(&jpeg);
+            buffer.open(QIODevice::WriteOnly);
+            if (!scaled.save(&buffer, "JPEG", JPEG_QUALITY)) return;
+
+            QDir().mkpath(dir);
+            QSaveFile file(dir + "/" + key + ".jpg");
+            if (!file.open(QIODevice::WriteOnly) || file.write(jpeg) != jpeg.size() || !file.commit()) {
+                qWarning("ThumbnailCache: cannot write %s", qPrintable(file.fileName()));
+            }
+            QMetaObject::invokeMethod(this, [this, key, jpeg, now]() { store(key, jpeg, now); },
+                                      Qt::QueuedConnection);
+        });
+    });
+}
+
+void ThumbnailCache::remove(const QStringList& urls)
+{
+    QStringList keys;
+    for (const QString& url : urls) {
+        const QString key = keyFor(url);
+        // A capture still on the worker must not bring it back into memory
+        m_wanted.remove(key);
+        m_images.remove(key);
+        m_capturedAt.remove(key);
+        keys.append(key);
+    }
+
+    // Queued behind any pending write of the same file
+    const QString dir = m_dir;
+    QMetaObject::invokeMethod(m_worker, [dir, keys]() {
+        for (const QString& key : keys) QFile::remove(dir + "/" + key + ".jpg");
+    });
+}
+
+void ThumbnailCache::clear()
+{
+    m_wanted.clear();
+    m_images.clear();
+    m_capturedAt.clear();
+
+    const QString dir = m_dir;
+    QMetaObject::invokeMethod(m_worker, [dir]() { QDir(dir).removeRecursively(); });
+}
+
+void ThumbnailCache::store(const QString& key, const QByteArray& jpeg, qint64 capturedAt)
+{
+    m_capturedAt.insert(key, capturedAt);
+    if (!m_wanted.contains(key)) return;
+    m_images.insert(key, jpeg);
+    emit thumbnailReady(key);
+}
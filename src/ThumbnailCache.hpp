@@ -0,0 +1,65 @@
+/**
+ * ThumbnailCache - Page thumbnails for the new tab page
+ *
+ * Only pages the new tab page shows are captured ("wanted"), at most once a
+ * day each. The view is grabbed on the GUI thread; scaling, JPEG encoding
+ * and the write to thumbnails/<key>.jpg happen on a worker thread, as does
+ * reading the wanted thumbnails back in. Encoded bytes stay in memory so
+ * serving them costs nothing. Thumbnails follow history: deleting a page
+ * from it, or clearing it, deletes their files too.
+ */
+
+#ifndef THUMBNAILCACHE_HPP
+#define THUMBNAILCACHE_HPP
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+class QWebEngineView;
+
+class ThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ThumbnailCache(QObject* parent = nullptr);
+    ~ThumbnailCache();
+
+    // Stable file/URL-safe key for a page URL
+    static QString keyFor(const QString& url);
+
+    // Replaces the set of pages worth capturing and loads their thumbnails
+    void setWanted(const QStringList& urls);
+    // Grabs the view shortly after it loads, if its page is wanted and due
+    void capture(QWebEngineView* view);
+    // Forgets the pages and deletes their files
+    void remove(const QStringList& urls);
+    void clear();
+
+    // Encoded JPEG, or empty if not in memory
+    QByteArray thumbnail(const QString& key) const { return m_images.value(key); }
+
+signals:
+    void thumbnailReady(const QString& key);
+
+private:
+    void store(const QString& key, const QByteArray& jpeg, qint64 capturedAt);
+
+    QString m_dir;
+    QSet<QString> m_wanted;                 // keys
+    QHash<QString, QByteArray> m_images;    // key -> JPEG, wanted pages only
+    QHash<QString, qint64> m_capturedAt;    // key -> ms since epoch
+    QThread m_thread;
+    QObject* m_worker;
+    static constexpr int WIDTH = 320;
+    static constexpr int HEIGHT = 200;
+    static constexpr int CAPTURE_DELAY_MS = 1500;
+    static constexpr qint64 MAX_AGE_MS = 24 * 60 * 60 * 1000;
+};
+
+#endif // THUMBNAILCACHE_HPP
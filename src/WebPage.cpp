@@ -0,0 +1,78 @@
+/**
+ * WebPage implementation
+ */
+
+#include "WebPage.hpp"
+#include "AdBlocker.hpp"
+#include "ContentPolicy.hpp"
+#include <QWebEngineProfile>
+#include <QWebEngineUrlRequestInterceptor>
+
+namespace {
+
+// Per page, so blocked requests can be counted against their tab
+class RequestInterceptor : public QWebEngineUrlRequestInterceptor
+{
+public:
+    explicit RequestInterceptor(WebPage* page)
+        : QWebEngineUrlRequestInterceptor(page)
+        , m_page(page)
+    {
+    }
+
+    void interceptRequest(QWebEngineUrlRequestInfo& info) override
+    {
+        // Site rules first: they aren't ads and don't count as such
+        if (ContentPolicy::instance()->shouldBlock(info)) {
+            info.block(true);
+        } else if (AdBlocker::instance()->shouldBlock(info)) {
+            info.block(true);
+            m_page->noteBlockedRequest();
+        }
+    }
+
+private:
+    WebPage* m_page;
+};
+
+} // namespace
+
+WebPage::WebPage(QObject* parent)
+    : WebPage(QWebEngineProfile::defaultProfile(), parent)
+{
+}
+
+WebPage::WebPage(QWebEngineProfile* profile, QObject* parent)
+    : QWebEnginePage(profile, parent)
+{
+    setUrlRequestInterceptor(new RequestInterceptor(this));
+}
+
+void WebPage::deferNextNavigation(std::function<void(const QUrl&)> onDeferred)
+{
+    m_onDeferred = std::move(onDeferred);
+}
+
+bool WebPage::acceptNavigationRequest(const QUrl& url, NavigationType type, bool isMainFrame)
+{
+    if (isMainFrame && m_onDeferred) {
+        // One-shot: the callback may well navigate this page itself
+        const auto onDeferred = std::move(m_onDeferred);
+        m_onDeferred = nullptr;
+        onDeferred(url);
+        return false;
+    }
+    const bool accepted = QWebEnginePage::acceptNavigationRequest(url, type, isMainFrame);
+    if (!accepted || !isMainFrame) return accepted;
+    ContentPolicy::instance()->apply(settings(), url.host());
+    if (m_blockedCount > 0) {
+        m_blockedCount = 0;
+        emit blockedCountChanged(0);
+    }
+    return accepted;
+}
+
+void WebPage::noteBlockedRequest()
+{
+    emit blockedCountChanged(++m_blockedCount);
+}
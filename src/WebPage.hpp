@@ -0,0 +1,44 @@
+/**
+ * WebPage - QWebEnginePage with the browser's navigation hooks
+ *
+ * deferNextNavigation() refuses the page's next main-frame navigation
+ * before anything is fetched and hands its URL to a callback instead. Used
+ * for background tabs opened from links, which become placeholders that
+ * load later.
+ *
+ * Every page filters its requests through ContentPolicy and AdBlocker and
+ * keeps a count of the ads blocked since its last main-frame navigation,
+ * at which point the site's content policy is applied to its settings.
+ */
+
+#ifndef WEBPAGE_HPP
+#define WEBPAGE_HPP
+
+#include <QWebEnginePage>
+#include <functional>
+
+class WebPage : public QWebEnginePage
+{
+    Q_OBJECT
+
+public:
+    explicit WebPage(QObject* parent = nullptr);
+    WebPage(QWebEngineProfile* profile, QObject* parent);
+
+    void deferNextNavigation(std::function<void(const QUrl&)> onDeferred);
+
+    int blockedCount() const { return m_blockedCount; }
+    void noteBlockedRequest();
+
+signals:
+    void blockedCountChanged(int count);
+
+protected:
+    bool acceptNavigationRequest(const QUrl& url, NavigationType type, bool isMainFrame) override;
+
+private:
+    std::function<void(const QUrl&)> m_onDeferred;
+    int m_blockedCount = 0;
+};
+
+#endif // WEBPAGE_HPP
@@ -3,12 +3,19 @@
  */
 
 #include "WebView.hpp"
-#include <QWebEnginePage>
+#include "WebPage.hpp"
+#include <QWebEngineProfile>
 
 WebView::WebView(QWidget* parent)
+    : WebView(QWebEngineProfile::defaultProfile(), parent)
+{
+}
+
+WebView::WebView(QWebEngineProfile* profile, QWidget* parent)
     : QWebEngineView(parent)
     , m_createTabCallback(nullptr)
 {
+    setPage(new WebPage(profile, this));
     connect(page(), &QWebEnginePage::urlChanged,
             this, &WebView::onUrlChanged);
     connect(this, &QWebEngineView::loadProgress,
@@ -17,18 +24,18 @@ WebView::WebView(QWidget* parent)
             this, &WebView::onTitleChanged);
 }
 
-void WebView::setCreateTabCallback(std::function<QWebEngineView*()> callback)
+void WebView::setCreateTabCallback(std::function<QWebEngineView*(QWebEnginePage::WebWindowType)> callback)
 {
     m_createTabCallback = callback;
 }
 
 // Called when page requests new window (e.g., target="_blank" link)
-// Returns the view to use - MainWindow creates new tab and returns its WebView
+// Returns the view to use - MainWindow creates a tab or window for the
+// requested type and returns its WebView
 QWebEngineView* WebView::createWindow(QWebEnginePage::WebWindowType type)
 {
-    Q_UNUSED(type);
     if (m_createTabCallback) {
-        return m_createTabCallback();
+        return m_createTabCallback(type);
     }
     return nullptr;
 }
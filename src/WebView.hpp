@@ -5,6 +5,8 @@
  * - URL change notifications for address bar sync
  * - Load progress for status/UI feedback
  * - Title updates for tab display
+ * - A WebPage, so the browser can intercept navigations
+ * - Any profile, for container windows
  */
 
 #ifndef WEBVIEW_HPP
@@ -20,9 +22,12 @@ class WebView : public QWebEngineView
 
 public:
     explicit WebView(QWidget* parent = nullptr);
+    // A page in another profile (see ContainerManager)
+    WebView(QWebEngineProfile* profile, QWidget* parent);
 
-    // Set callback for opening links in new tab (target="_blank", etc.)
-    void setCreateTabCallback(std::function<QWebEngineView*()> callback);
+    // Set callback for opening links in new tab/window (target="_blank",
+    // middle-click, window.open); it gets the kind of window requested
+    void setCreateTabCallback(std::function<QWebEngineView*(QWebEnginePage::WebWindowType)> callback);
 
     // Override to handle link navigation (e.g., open in new tab)
     QWebEngineView* createWindow(QWebEnginePage::WebWindowType type) override;
@@ -38,7 +43,7 @@ private slots:
     void onTitleChanged(const QString& title);
 
 private:
-    std::function<QWebEngineView*()> m_createTabCallback;
+    std::function<QWebEngineView*(QWebEnginePage::WebWindowType)> m_createTabCallback;
 };
 
 #endif // WEBVIEW_HPP
@@ -0,0 +1,107 @@
+/**
+ * WebViewPool implementation
+ */
+
+#include "WebViewPool.hpp"
+#include "WebView.hpp"
+#include "Settings.hpp"
+#include "TabLifecycleManager.hpp"
+#include <QApplication>
+#include <QWebEngineHistory>
+#include <QWebEnginePage>
+#include <memory>
+
+namespace {
+
+const QUrl WARMUP_URL("about:blank");
+
+} // namespace
+
+WebViewPool* WebViewPool::instance()
+{
+    static WebViewPool* pool = nullptr;
+    if (!pool) pool = new WebViewPool(qApp);
+    return pool;
+}
+
+WebViewPool::WebViewPool(QObject* parent)
+    : QObject(parent)
+    , m_size(qBound(0, Settings::instance()->value("webViewPoolSize", 1).toInt(), MAX_SIZE))
+{
+    m_refillTimer.setSingleShot(true);
+    m_refillTimer.setInterval(REFILL_DELAY_MS);
+    connect(&m_refillTimer, &QTimer::timeout, this, &WebViewPool::refill);
+
+    connect(TabLifecycleManager::instance(), &TabLifecycleManager::pressureChanged, this, [this]() {
+        trim();
+        if (m_spares.size() < targetSize()) m_refillTimer.start();
+    });
+    // Spares have no parent; they must go before the WebEngine profile does
+    connect(qApp, &QCoreApplication::aboutToQuit, this, &WebViewPool::clear);
+}
+
+WebView* WebViewPool::take(QWidget* parent)
+{
+    if (!m_refillTimer.isActive()) m_refillTimer.start();
+    if (m_spares.isEmpty()) return new WebView(parent);
+
+    WebView* view = m_spares.takeLast();
+    view->setParent(parent);
+
+    // Restoring a saved history replaces the warm-up entry anyway; after a
+    // plain navigation it would be left behind as a Back target
+    auto connection = std::make_shared<QMetaObject::Connection>();
+    *connection = connect(view->page(), &QWebEnginePage::urlChanged, view, [view, connection](const QUrl& url) {
+        if (url == WARMUP_URL) return;
+        QWebEngineHistory* history = view->history();
+        if (history->count() == 2 && history->currentItemIndex() == 1 && history->itemAt(0).url() == WARMUP_URL) {
+            history->clear();
+        }
+        QObject::disconnect(*connection);
+    });
+    return view;
+}
+
+void WebViewPool::prewarm()
+{
+    if (m_spares.size() < targetSize()) m_refillTimer.start();
+}
+
+void WebViewPool::setSize(int size)
+{
+    m_size = qBound(0, size, MAX_SIZE);
+    Settings::instance()->setValue("webViewPoolSize", m_size);
+    trim();
+    prewarm();
+}
+
+int WebViewPool::targetSize() const
+{
+    const TabLifecycleManager* lifecycle = TabLifecycleManager::instance();
+    if (lifecycle->pressure() != TabLifecycleManager::Pressure::None) return 0;
+    const int floor = qMax(lifecycle->discardBelowPercent(), 10);
+    if (lifecycle->availableMemoryPercent() < 2.0 * floor) return qMin(m_size, 1);
+    return m_size;
+}
+
+void WebViewPool::refill()
+{
+    if (m_spares.size() >= targetSize()) return;
+    WebView* view = new WebView;
+    view->setUrl(WARMUP_URL);
+    m_spares.append(view);
+    if (m_spares.size() < targetSize()) m_refillTimer.start();
+}
+
+void WebViewPool::trim()
+{
+    const int target = targetSize();
+    while (m_spares.size() > target) m_spares.takeLast()->deleteLater();
+}
+
+void WebViewPool::clear()
+{
+    m_refillTimer.stop();
+    qDeleteAll(m_spares);
+    m_spares.clear();
+}
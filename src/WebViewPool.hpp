@@ -0,0 +1,56 @@
+/**
+ * WebViewPool - Spare WebViews with a renderer already running
+ *
+ * Spawning a renderer process is most of the cost of a new tab. The pool
+ * keeps a few hidden views that have loaded about:blank, hands one out per
+ * new tab, and refills a while later, one view per step, so the refill never
+ * competes with the tab being opened.
+ *
+ * The configured size is a ceiling: with less than twice the discard
+ * threshold of memory free only one spare is kept, and under any memory
+ * pressure (see TabLifecycleManager) the pool empties.
+ */
+
+#ifndef WEBVIEWPOOL_HPP
+#define WEBVIEWPOOL_HPP
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+class QWidget;
+class WebView;
+
+class WebViewPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    static WebViewPool* instance();
+
+    // A spare view reparented to parent, or a fresh one if none is ready.
+    // The warm-up entry is dropped from its history once it navigates.
+    WebView* take(QWidget* parent);
+
+    // Fills the pool in the background (called once startup is done)
+    void prewarm();
+
+    int size() const { return m_size; }
+    void setSize(int size);
+    int targetSize() const;
+
+private:
+    explicit WebViewPool(QObject* parent = nullptr);
+
+    void refill();
+    void trim();
+    void clear();
+
+    QVector<WebView*> m_spares;
+    int m_size;
+    QTimer m_refillTimer;
+    static constexpr int MAX_SIZE = 4;
+    static constexpr int REFILL_DELAY_MS = 1000;
+};
+
+#endif // WEBVIEWPOOL_HPP
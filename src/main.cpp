@@ -2,34 +2,135 @@
  * Arch Browser - Native Chromium-based web browser for Arch Linux
  *
  * Entry point: Initializes Qt application and Chromium engine (via QtWebEngine),
- * then launches the main window. Supports multiple application instances for
- * multi-window operation.
+ * then launches the main window. Only one browser process runs per user: later
+ * launches forward their URL to it (see SingleInstance) and exit with only a
+ * QCoreApplication, before the GUI or WebEngine starts.
  */
 
 #include <QApplication>
+#include <QTimer>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QUrl>
 #include <QWebEngineSettings>
 #include <QWebEngineProfile>
 #include <QStandardPaths>
-#include <QSettings>
 #include <QIcon>
 #include "MainWindow.hpp"
+#include "ContainerManager.hpp"
+#include "DownloadManager.hpp"
+#include "NewTabPage.hpp"
+#include "PerformanceProfile.hpp"
+#include "Settings.hpp"
+#include "BrowserData.hpp"
+#include "SessionStore.hpp"
+#include "SingleInstance.hpp"
+#include "StartupTrace.hpp"
+#include "StorageManager.hpp"
+#include "WebViewPool.hpp"
+#include "AdBlocker.hpp"
+#include "ContentPolicy.hpp"
+#include "HttpsUpgrader.hpp"
+
+namespace {
+
+// Long enough for the restored tabs to have loaded
+const int PROFILE_MEASURE_DELAY_MS = 60 * 1000;
+// Well clear of startup; the walk competes for disk with page loads
+const int STORAGE_SCAN_DELAY_MS = 5 * 60 * 1000;
+
+// A URL forwarded from another launch: new tab in the most recently used
+// window unless a new window was asked for (or there is none)
+void openForwarded(const QString& url, bool newWindow)
+{
+    const QString target = url.isEmpty() ? Settings::instance()->homePage() : url;
+    MainWindow* window = qobject_cast<MainWindow*>(QApplication::activeWindow());
+    if (!window) {
+        for (QWidget* w : QApplication::topLevelWidgets()) {
+            MainWindow* candidate = qobject_cast<MainWindow*>(w);
+            if (candidate && candidate->isVisible()) window = candidate;
+        }
+    }
+    if (newWindow || !window) {
+        window = new MainWindow(target);
+        window->show();
+    } else {
+        window->openInNewTab(target);
+    }
+    window->raise();
+    window->activateWindow();
+}
+
+} // namespace
 
 int main(int argc, char* argv[])
 {
     // High DPI scaling for modern displays
     QApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
     QApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
+    // Chromium reads its switches once, when QtWebEngine starts
+    PerformanceProfile::applyEngineFlags();
+    NewTabPage::registerScheme();
+
+    // Hand off to a running browser before anything heavy is initialized;
+    // parsing and forwarding need no display, so a core application will do
+    SingleInstance singleInstance;
+    QString url;
+    bool traceEnabled = false;
+    {
+        QCoreApplication core(argc, argv);
+        core.setApplicationName("Arch Browser");
+        core.setApplicationVersion("1.0.0");
+
+        QCommandLineParser parser;
+        parser.setApplicationDescription("Arch Browser");
+        parser.addHelpOption();
+        parser.addVersionOption();
+        QCommandLineOption newWindowOption("new-window", "Open the URL in a new window of the running browser.");
+        QCommandLineOption newTabOption("new-tab", "Open the URL in a new tab of the running browser (default with a URL).");
+        parser.addOption(newWindowOption);
+        parser.addOption(newTabOption);
+        QCommandLineOption traceOption("startup-trace", "Print how long each phase of startup took.");
+        parser.addOption(traceOption);
+        parser.addPositionalArgument("url", "Page to open, or text to search for.", "[url]");
+        parser.process(core);
+        url = parser.positionalArguments().value(0);
+        traceEnabled = parser.isSet(traceOption);
+
+        // A relative path means nothing to a browser started in another directory
+        const QFileInfo file(url);
+        if (!url.isEmpty() && file.exists()) url = QUrl::fromLocalFile(file.absoluteFilePath()).toString();
+
+        // A bare second launch asks for a new window, like other browsers
+        const bool newWindow = parser.isSet(newWindowOption) || (url.isEmpty() && !parser.isSet(newTabOption));
+        if (singleInstance.forward(url, newWindow)) return 0;
+    }
 
     QApplication app(argc, argv);
     app.setApplicationName("Arch Browser");
     app.setApplicationVersion("1.0.0");
     app.setOrganizationName("ArchBrowser");
     app.setWindowIcon(QIcon::fromTheme("arch-browser"));
+    StartupTrace* trace = StartupTrace::instance();
+    trace->mark(StartupTrace::ApplicationReady);
+
+    singleInstance.listen();
+    QObject::connect(&singleInstance, &SingleInstance::openRequested, &openForwarded);
+    trace->setReportEnabled(traceEnabled);
+
+    // Load settings once; everything after this reads them from memory
+    Settings::instance();
 
     // Persistent storage for cookies, local storage, cache (keeps login sessions)
     QString dataPath = QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/arch-browser";
+    // Evictions chosen by the last storage scan, while nothing has the files open
+    StorageManager::instance()->start(dataPath, dataPath + "/cache");
     QWebEngineProfile::defaultProfile()->setPersistentStoragePath(dataPath);
     QWebEngineProfile::defaultProfile()->setCachePath(dataPath + "/cache");
+    ContainerManager::instance()->setUp(QWebEngineProfile::defaultProfile());
+    StorageManager::instance()->applyTo(QWebEngineProfile::defaultProfile());
+    // Before any window, so no download request goes unanswered
+    DownloadManager::instance();
 
     // Global Chromium/WebEngine settings - enables HTTPS, JavaScript, etc.
     QWebEngineSettings::defaultSettings()->setAttribute(
@@ -40,19 +141,36 @@ int main(int argc, char* argv[])
         QWebEngineSettings::PluginsEnabled, true);
     QWebEngineSettings::defaultSettings()->setAttribute(
         QWebEngineSettings::AutoLoadImages, true);
+    // Maps the compiled filters, so the first page is already filtered
+    AdBlocker::instance();
+    ContentPolicy::instance();
+    trace->mark(StartupTrace::ProfileReady);
 
-    // Create and show main window (empty or with URL from command line / home page)
-    MainWindow* mainWindow = new MainWindow();
-    mainWindow->show();
-
-    QSettings settings("ArchBrowser", "arch-browser");
-    const QString homePage = settings.value("homePage", "https://google.com").toString();
-
-    if (argc > 1) {
-        mainWindow->navigateTo(QString::fromUtf8(argv[1]));
+    // Reopen the last session if wanted; a URL from the command line then
+    // gets its own tab instead of replacing a restored one. Either way the
+    // first tab is created with its final URL, so nothing loads twice.
+    MainWindow* mainWindow = nullptr;
+    if (Settings::instance()->restoreSession()) {
+        mainWindow = MainWindow::restoreSession(url);
     } else {
-        mainWindow->navigateTo(homePage);
+        BrowserData::instance()->session()->reset();
     }
+    if (!mainWindow) {
+        mainWindow = new MainWindow(url);
+        mainWindow->show();
+    }
+
+    // Bookmarks, history and spare views aren't needed for the first paint;
+    // at startup the window's only live view is its current tab
+    trace->watchWindow(mainWindow, []() {
+        BrowserData::instance()->loadDeferred();
+        WebViewPool::instance()->prewarm();
+        AdBlocker::instance()->updateLists();
+        HttpsUpgrader::instance()->updatePreloadList();
+        QTimer::singleShot(PROFILE_MEASURE_DELAY_MS, &PerformanceProfile::recordRun);
+        QTimer::singleShot(STORAGE_SCAN_DELAY_MS, StorageManager::instance(), &StorageManager::scan);
+    });
+    if (QWebEngineView* view = mainWindow->findChild<QWebEngineView*>()) trace->watchPage(view->page());
 
     return app.exec();
 }